@@ -0,0 +1,54 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+class NPC;
+
+/* Every NPC moves and updates on every tick, but the expensive decisions in NPC::Decide are
+handed out by urgency. NPCs in a fight always get to decide, then moving and working ones.
+Sleeping and idle NPCs only decide every so often. Whatever is left over when the per tick budget
+runs out (the aiBudget cvar, in microseconds, 0 for no limit) waits for the next tick, and
+anything that has waited for too long is treated as urgent */
+class AIScheduler {
+public:
+	enum Urgency {
+		COMBAT,
+		MOVING,
+		WORKING,
+		SLEEPING,
+		IDLE,
+		URGENCY_COUNT
+	};
+
+	static AIScheduler* Inst();
+	static void Reset();
+
+	//The NPC has a decision pending this tick
+	void Schedule(const boost::shared_ptr<NPC>&);
+	void Run();
+
+private:
+	AIScheduler();
+	static AIScheduler* instance;
+
+	std::vector<boost::shared_ptr<NPC> > queues[URGENCY_COUNT];
+
+	static Urgency Classify(NPC*);
+	static bool LongestWaiting(const boost::shared_ptr<NPC>&, const boost::shared_ptr<NPC>&);
+};
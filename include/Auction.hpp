@@ -0,0 +1,33 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <vector>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+struct AuctionCandidate {
+	int object;
+	int value;
+};
+
+/* Auction algorithm for sparse assignment problems. Every bidder only bids on its own list of
+candidates, and staying unassigned is always worth 0 to it. prices is read as the starting prices
+(so the previous solution can warm-start this one) and holds the final prices afterwards.
+Returns the object won by each bidder, or -1. If the deadline passes complete is set to false and
+the assignment so far is returned, it's consistent but some bidders might be left without an object
+that would have gotten one. */
+std::vector<int> FindAuctionAssignment(const std::vector<std::vector<AuctionCandidate> >& candidates,
+	std::vector<int>& prices, boost::posix_time::ptime deadline, bool& complete);
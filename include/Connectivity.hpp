@@ -0,0 +1,57 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <vector>
+
+#include "Coordinate.hpp"
+
+/* Region labels of the cached map, so that a path request to somewhere that can't be
+reached is rejected without running a search over everything that can.
+Tiles that open up are merged into their neighbours' regions right away, tiles that close
+only cause a relabel if they could have split a region. Flyers don't need labels,
+everything is connected for them. */
+class Connectivity {
+public:
+	enum Class {
+		WALKING,
+		HANDLESS, //Can't open doors
+		CLASS_COUNT
+	};
+
+	Connectivity(int width, int height);
+
+	void TileChanged(const Coordinate&, bool walkable, bool door);
+	void Update();
+
+	/* False only if both ends are known to be in different regions. If the goal itself is
+	impassable there's nothing to tell, and a blocked start uses the regions around it */
+	bool Connected(const Coordinate& from, const Coordinate& to, Class) const;
+
+private:
+	int width, height;
+	std::vector<bool> passable[CLASS_COUNT];
+	std::vector<int> labels[CLASS_COUNT];
+	mutable std::vector<int> parent[CLASS_COUNT]; //Union-find over labels
+	bool relabel[CLASS_COUNT];
+
+	int Find(Class, int label) const;
+	int Region(Class, const Coordinate&) const;
+	void Open(Class, const Coordinate&);
+	void Close(Class, const Coordinate&);
+	bool MaySplit(Class, const Coordinate&) const;
+	void Relabel(Class);
+};
@@ -127,6 +127,9 @@ protected:
 	void UpdateWallGraphic(bool recurse = true, bool self = true);
 	bool flammable;
 	int smoke;
+	bool spawnScheduled;
+	static bool SpawnEvent(boost::weak_ptr<Construction>);
+	void SpawnCreatures();
 	boost::weak_ptr<Job> repairJob;
 	Map* map;
 public:
@@ -0,0 +1,168 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <vector>
+#include <iterator>
+#include <utility>
+#include <boost/shared_ptr.hpp>
+
+/* Holds the entities of one kind by uid. Lookups go through an array indexed by uid and the
+entities themselves sit next to each other in one array, so iterating over them doesn't chase
+tree nodes around. Erasing leaves a hole that is skipped over and reused by the next insert, which
+means erasing or inserting during iteration doesn't invalidate other iterators. Uids are never
+handed out twice, so a slot is always checked against the uid it was looked up with.
+Reads like a std::map<int, boost::shared_ptr<T> >, except that iteration isn't in uid order and
+references into it don't survive an insert */
+template <class T>
+class EntityMap {
+public:
+	typedef int key_type;
+	typedef boost::shared_ptr<T> mapped_type;
+	typedef std::pair<int, boost::shared_ptr<T> > value_type;
+	typedef std::size_t size_type;
+
+private:
+	typedef std::vector<value_type> Slots;
+	enum { NONE = -1 }; //Not a static const, index.resize takes it by reference
+
+	Slots slots; //first is NONE for holes
+	std::vector<int> index; //uid -> slot
+	std::vector<int> holes;
+	size_type live;
+	mapped_type none;
+	mapped_type discard; //What operator[] hands out for uids that can't be stored
+
+public:
+	template <class V, class S>
+	class basic_iterator : public std::iterator<std::forward_iterator_tag, V> {
+		friend class EntityMap;
+		template <class, class> friend class basic_iterator;
+		S* slots;
+		std::size_t slot;
+		void Skip() { while (slot < slots->size() && (*slots)[slot].first == NONE) ++slot; }
+	public:
+		basic_iterator() : slots(0), slot(0) {}
+		basic_iterator(S* nslots, std::size_t nslot) : slots(nslots), slot(nslot) { Skip(); }
+		template <class V2, class S2>
+		basic_iterator(const basic_iterator<V2, S2>& other) : slots(other.slots), slot(other.slot) {}
+		V& operator*() const { return (*slots)[slot]; }
+		V* operator->() const { return &(*slots)[slot]; }
+		basic_iterator& operator++() { ++slot; Skip(); return *this; }
+		basic_iterator operator++(int) { basic_iterator old = *this; ++*this; return old; }
+		template <class V2, class S2>
+		bool operator==(const basic_iterator<V2, S2>& other) const { return slot == other.slot; }
+		template <class V2, class S2>
+		bool operator!=(const basic_iterator<V2, S2>& other) const { return slot != other.slot; }
+	};
+	typedef basic_iterator<value_type, Slots> iterator;
+	typedef basic_iterator<const value_type, const Slots> const_iterator;
+
+	EntityMap() : live(0) {}
+
+	iterator begin() { return iterator(&slots, 0); }
+	iterator end() { return iterator(&slots, slots.size()); }
+	const_iterator begin() const { return const_iterator(&slots, 0); }
+	const_iterator end() const { return const_iterator(&slots, slots.size()); }
+	size_type size() const { return live; }
+	bool empty() const { return live == 0; }
+
+	iterator find(int uid) {
+		int slot = Slot(uid);
+		return slot == NONE ? end() : iterator(&slots, slot);
+	}
+	const_iterator find(int uid) const {
+		int slot = Slot(uid);
+		return slot == NONE ? end() : const_iterator(&slots, slot);
+	}
+	size_type count(int uid) const { return Slot(uid) == NONE ? 0 : 1; }
+
+	//Null if there's no such uid, unlike operator[] this never inserts
+	const mapped_type& Get(int uid) const {
+		int slot = Slot(uid);
+		return slot == NONE ? none : slots[slot].second;
+	}
+
+	mapped_type& operator[](int uid) {
+		if (uid < 0) {
+			discard.reset();
+			return discard;
+		}
+		return insert(value_type(uid, mapped_type())).first->second;
+	}
+
+	std::pair<iterator, bool> insert(const value_type& value) {
+		int slot = Slot(value.first);
+		if (slot != NONE) return std::make_pair(iterator(&slots, slot), false);
+		if (value.first < 0) return std::make_pair(end(), false);
+
+		if (holes.empty()) {
+			slot = static_cast<int>(slots.size());
+			slots.push_back(value);
+		} else {
+			slot = holes.back();
+			holes.pop_back();
+			slots[slot] = value;
+		}
+		if (static_cast<std::size_t>(value.first) >= index.size()) index.resize(value.first + 1, NONE);
+		index[value.first] = slot;
+		++live;
+		return std::make_pair(iterator(&slots, slot), true);
+	}
+
+	template <class InputIterator>
+	void insert(InputIterator first, InputIterator last) {
+		for (; first != last; ++first) insert(value_type(first->first, first->second));
+	}
+
+	size_type erase(int uid) {
+		int slot = Slot(uid);
+		if (slot == NONE) return 0;
+		Release(slot);
+		return 1;
+	}
+
+	//Returns the next entity, like std::map::erase does in C++11
+	iterator erase(iterator it) {
+		Release(it.slot);
+		return ++it;
+	}
+
+	void clear() {
+		//Entities being destroyed may look themselves up, so they go only after the map is empty
+		Slots doomed;
+		doomed.swap(slots);
+		index.clear();
+		holes.clear();
+		live = 0;
+	}
+
+private:
+	int Slot(int uid) const {
+		if (uid < 0 || static_cast<std::size_t>(uid) >= index.size()) return NONE;
+		int slot = index[uid];
+		return (slot != NONE && slots[slot].first == uid) ? slot : NONE;
+	}
+
+	void Release(std::size_t slot) {
+		mapped_type doomed;
+		doomed.swap(slots[slot].second);
+		index[slots[slot].first] = NONE;
+		slots[slot].first = NONE;
+		holes.push_back(static_cast<int>(slot));
+		--live;
+	}
+};
@@ -29,10 +29,16 @@ private:
 	Map *map;
 	std::vector<int> hostileSpawningMonsters;
 	int timeSinceHostileSpawn;
+	bool safe;
 	std::vector<int> peacefulAnimals;
 	std::vector<int> migratingAnimals;
 	std::vector<int> immigrants;
 	std::vector<boost::weak_ptr<NPC> > existingImmigrants;
+	//Rare events are on the game's timers instead of rolling for them every tick
+	bool HostileSpawnEvent();
+	bool BenignFaunaEvent();
+	bool ImmigrantEvent();
+	bool MigrationEvent();
 public:
 	Events(Map*);
 	void Update(bool safe = false);
@@ -0,0 +1,45 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <vector>
+
+#include "Coordinate.hpp"
+
+class Map;
+
+/* Which tiles around a point can be seen from it, by symmetric recursive shadowcasting over
+the light blocking tiles of the map. Covers the square of the given radius around the origin */
+class FieldOfView {
+public:
+	FieldOfView();
+
+	//Tall viewers see over everything, there's nothing to cast then
+	void Compute(Map*, const Coordinate& origin, int radius, bool seeOverWalls = false);
+	bool Visible(const Coordinate&) const;
+
+	Coordinate Origin() const;
+	int Radius() const;
+
+private:
+	Coordinate origin;
+	int radius, side;
+	bool everything;
+	std::vector<bool> visible;
+
+	void CastLight(Map*, int row, float start, float end, int octant);
+	void Mark(const Coordinate&);
+};
@@ -0,0 +1,69 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "Coordinate.hpp"
+
+class Map;
+class NPC;
+
+/* Shared distance fields for popular destinations (stockpiles, the camp center, water).
+Once enough NPCs have asked for a path to the same tile a reverse Dijkstra is run from it
+over the area around it, after which every NPC in that area just walks downhill instead of
+running its own search. Fields depend on everything NPC specific in the walk cost, so they're
+kept per faction (traps) and per having hands (doors). */
+class FlowFieldCache {
+public:
+	static const int FIELD_RADIUS = 96;
+	static const unsigned int POPULARITY = 3; //Requests for the same destination before a field is built
+	static const unsigned int MAX_FIELDS = 32;
+
+	FlowFieldCache(Map*);
+
+	//Called by the pathing workers with the cache read lock held, returns false if there's no field to use
+	bool FindPath(const Coordinate& start, const Coordinate& goal, NPC*, std::vector<Coordinate>& path);
+	//Called with the cache write lock held
+	void TileChanged(const Coordinate&);
+
+private:
+	struct Key {
+		Coordinate target;
+		bool hands;
+		int faction;
+		bool operator==(const Key&) const;
+	};
+	friend std::size_t hash_value(const Key&);
+
+	struct Field {
+		Coordinate origin, extent;
+		std::vector<float> dist;
+		unsigned int uses;
+	};
+
+	Map* map;
+	boost::mutex mutex;
+	boost::unordered_map<Key, boost::shared_ptr<Field> > fields;
+	boost::unordered_map<Key, unsigned int> requests;
+
+	boost::shared_ptr<Field> Build(const Coordinate& target, NPC*) const;
+	bool Descend(const Field&, const Coordinate& start, const Coordinate& goal, NPC*, std::vector<Coordinate>& path) const;
+};
@@ -33,6 +33,8 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include "Job.hpp"
 #include "Fire.hpp"
 #include "Spell.hpp"
+#include "TimerWheel.hpp"
+#include "EntityMap.hpp"
 #include "GCamp.hpp"
 
 #include "MapRenderer.hpp"
@@ -67,7 +69,7 @@ class Game {
 	friend class TCODMapRenderer;
 	friend class TilesetRenderer;
 	friend class NPCDialog;
-	friend void StartNewGame();
+	friend void StartNewGame(uint32_t seed);
 
 	Game();
 	static Game* instance;
@@ -83,18 +85,21 @@ class Game {
 	int safeMonths;
 	bool refreshStockpiles;
 	static bool devMode;
+	static bool headless;
 	Coordinate marks[12];
 
 	boost::shared_ptr<Events> events;
 
-	std::list<std::pair<int, boost::function<void()> > > delays;
+	TimerWheel timers;
 
 	boost::shared_ptr<MapRenderer> renderer;
 	bool gameOver;
 
-	std::map<int, boost::shared_ptr<Construction> > staticConstructionList;
-	std::map<int, boost::shared_ptr<Construction> > dynamicConstructionList;
-	std::map<int, boost::shared_ptr<NPC> > npcList;
+	EntityMap<Construction> staticConstructionList;
+	EntityMap<Construction> dynamicConstructionList;
+	EntityMap<NPC> npcList;
+	std::vector<NPC*> npcSnapshot; //npcList for the parallel part of the NPC updates
+	std::vector<std::vector<NPCCommand> > npcCommands; //One buffer per part
 
 	static bool initializedOnce;
 
@@ -103,8 +108,12 @@ public:
 	~Game();
 	static bool LoadGame(const std::string&);
 	static bool SaveGame(const std::string&);
+	static void SaveGameInBackground(const std::string&, bool journal, boost::function<void(bool)> done);
+	static std::string SaveSummary(const std::string&); //Empty if the save has none
 	static void ToMainMenu(bool);
 	static bool ToMainMenu();
+	static void Headless(bool); //No window, no dialogs, no autosaves. Set before the first Inst()
+	static bool Headless();
 	void Running(bool);
 	bool Running();
 	static void Reset();
@@ -207,7 +216,7 @@ public:
 		boost::shared_ptr<Container> = boost::shared_ptr<Container>());
 	void RemoveItem(boost::weak_ptr<Item>);
 	boost::weak_ptr<Item> GetItem(int);
-	std::map<int,boost::shared_ptr<Item> > itemList;
+	EntityMap<Item> itemList;
 	void ItemContained(boost::weak_ptr<Item>, bool contained);
 	std::set<boost::weak_ptr<Item> > freeItems; //Free as in not contained
 	std::set<boost::weak_ptr<Item> > flyingItems; //These need to be updated
@@ -222,7 +231,7 @@ public:
 	void GatherItems(Coordinate a, Coordinate b);
 
 	/*      NATURE      NATURE      NATURE      */
-	std::map<int, boost::shared_ptr<NatureObject> > natureList;
+	EntityMap<NatureObject> natureList;
 	std::list<boost::weak_ptr<WaterNode> > waterList;
 	void CreateWater(Coordinate);
 	void CreateWater(Coordinate,int,int=0);
@@ -266,6 +275,8 @@ public:
 	void TriggerMigration();
 
 	void AddDelay(int delay, boost::function<void()>);
+	void AddRandomEvent(int chance, boost::function<bool()>); //A one in chance per tick, until it returns false
+	TimerWheel* Timers();
 
 	std::list<boost::weak_ptr<FireNode> > fireList;
 	void CreateFire(Coordinate);
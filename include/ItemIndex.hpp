@@ -0,0 +1,78 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <map>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "Coordinate.hpp"
+
+class Item;
+typedef int ItemType;
+typedef int ItemCategory;
+
+/* Every item stored in a stockpile, by category and by type. Within each, items are filed in
+square buckets by position so a nearest item search only looks at the buckets that could still
+beat the best item found so far, and ordered by how soon they decay for MOSTDECAYED searches.
+Stockpiles keep it current through their ItemAdded/ItemRemoved hooks. Reservations change too
+often to track here, reserved items are skipped when searching instead */
+class ItemIndex {
+public:
+	static const int BUCKET_SIZE = 16;
+
+	static ItemIndex* Inst();
+	static void Reset();
+
+	void Add(const boost::shared_ptr<Item>&);
+	void Remove(const boost::shared_ptr<Item>&);
+	void DecayPassed(); //Every decaying item just got one step closer
+
+	//Takes the same flags as Stockpile::FindItemByCategory
+	boost::weak_ptr<Item> FindByCategory(ItemCategory, const Coordinate& target, int flags = 0, int value = 0);
+	boost::weak_ptr<Item> FindByType(ItemType, const Coordinate& target, int flags = 0, int value = 0);
+
+private:
+	ItemIndex();
+	static ItemIndex* instance;
+
+	typedef std::map<int, boost::weak_ptr<Item> > Bucket; //By uid, so ties always go the same way
+
+	struct Index {
+		boost::unordered_map<Coordinate, Bucket> buckets; //Only ones with items in them
+		std::map<std::pair<int, int>, boost::weak_ptr<Item> > byDecay; //By decay key and uid, items that don't decay come first with -1
+	};
+
+	struct Entry {
+		ItemType type;
+		Coordinate bucket;
+		int decayKey;
+	};
+
+	std::vector<Index> categories, types;
+	boost::unordered_map<int, Entry> entries; //By item uid
+	int decayPasses; //Decay keys are counters offset by this, so they don't need updating as items decay
+
+	static void Insert(Index&, int uid, const boost::weak_ptr<Item>&, const Entry&);
+	static void Erase(Index&, int uid, const Entry&);
+	void Remove(int uid);
+	boost::weak_ptr<Item> Find(std::vector<Index>&, int key, const Coordinate& target, int flags, int value);
+	boost::weak_ptr<Item> FindNearest(Index&, const Coordinate& target, int flags, int value, std::vector<int>& expired);
+	boost::weak_ptr<Item> FindMostDecayed(Index&, int flags, int value, std::vector<int>& expired);
+	static bool Suitable(const boost::shared_ptr<Item>&, int flags, int value);
+};
@@ -15,6 +15,10 @@ You should have received a copy of the GNU General Public License
 along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #pragma once
 
+#include <map>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/unordered_map.hpp>
+
 #include "Job.hpp"
 #include "data/Serialization.hpp"
 
@@ -29,6 +33,28 @@ class JobManager {
 	std::vector<int> expertNPCsWaiting;
 	std::vector<std::vector<boost::weak_ptr<Job> > > toolJobs;
 	std::list<boost::shared_ptr<Job> > failList;
+
+	/* Every job in availableList or waitingList has an entry here, so it can be found and taken
+	off its list without walking the lists. The buckets are those of its task targets as they were
+	when it was listed */
+	struct IndexEntry {
+		int list; //Priority, or PRIORITY_COUNT for the waiting list
+		std::list<boost::shared_ptr<Job> >::iterator position;
+		std::vector<Coordinate> buckets;
+	};
+	boost::unordered_map<Job*, IndexEntry> jobIndex;
+	boost::unordered_map<Coordinate, std::vector<Job*> > jobGrid;
+
+	std::list<boost::shared_ptr<Job> >& List(int);
+	void Insert(boost::shared_ptr<Job>, int list);
+	std::list<boost::shared_ptr<Job> >::iterator Erase(std::list<boost::shared_ptr<Job> >::iterator);
+	bool Erase(boost::shared_ptr<Job>);
+	void Reindex();
+
+	std::map<boost::weak_ptr<Job>, int> jobPrices; //Prices from auctions that ran out of time, to warm-start the next try
+	bool auctionResumed[PRIORITY_COUNT * 2]; //Menial and expert auction per priority
+
+	void Auction(std::vector<boost::shared_ptr<Job> >&, std::vector<int>& npcsWaiting, int auction, boost::posix_time::ptime deadline);
 public:
 	static JobManager* Inst();
 	static void Reset();
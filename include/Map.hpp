@@ -17,6 +17,7 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 
 #include <utility>
 #include <list>
+#include <vector>
 
 #include <boost/thread/shared_mutex.hpp>
 #include <boost/multi_array.hpp>
@@ -29,12 +30,21 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 
 class MapMarker;
 class Weather;
+class PathGraph;
+class Connectivity;
+class FlowFieldCache;
+class PathCache;
+class WaterChunks;
+class NPCGrid;
+class Visibility;
+namespace Random { struct Generator; }
 
 #define TERRITORY_OVERLAY (1 << 0)
 #define TERRAIN_OVERLAY (2 << 0)
 
 class Map : public ITCODPathCallback {
 	GC_SERIALIZABLE_CLASS
+	friend class PathGraph;
 	
 	Map();
 	static Map* instance;
@@ -46,6 +56,12 @@ class Map : public ITCODPathCallback {
 	std::list< std::pair<unsigned int, MapMarker> > mapMarkers;
 	unsigned int markerids;
 	boost::unordered_set<Coordinate> changedTiles;
+	int deferredCacheUpdates;
+	std::vector<unsigned char> waterTerrain;
+	std::vector<WaterNode*> waterNodes;
+
+	void UpdateWaterTerrain(const Coordinate&);
+	void LoadTiles(InputArchive&);
 
 	inline const Tile& tile(const Coordinate& p) const {
 		return tileMap[p.X()][p.Y()];
@@ -64,6 +80,13 @@ public:
 	typedef std::list<std::pair<unsigned int, MapMarker> >::const_iterator MarkerIterator;
 
 	TCODHeightMap *heightMap;
+	PathGraph *pathGraph;
+	Connectivity *connectivity;
+	FlowFieldCache *flowFields;
+	PathCache *pathCache;
+	WaterChunks *waterChunks;
+	NPCGrid *npcGrid;
+	Visibility *visibility;
 	static Map* Inst();
 	~Map();
 	static void Reset();
@@ -74,6 +97,7 @@ public:
 	bool IsWalkable(const Coordinate&) const;
 	bool IsWalkable(const Coordinate&,void*) const;
 	void SetWalkable(const Coordinate&,bool);
+	bool IsReachable(const Coordinate& from, const Coordinate& to, void*) const;
 	
 	Coordinate Extent();
 	int Width();
@@ -93,6 +117,22 @@ public:
 	int GetConstruction(const Coordinate&) const;
 	boost::weak_ptr<WaterNode> GetWater(const Coordinate&);
 	void SetWater(const Coordinate&,boost::shared_ptr<WaterNode>);
+
+	/* Flowing water looks at all of its neighbours every update, so what it needs is also kept
+	in flat per tile arrays. Only valid for tiles inside the map */
+	enum WaterTerrainFlag {
+		WATER_LOW = 1 << 0,
+		WATER_BLOCKED = 1 << 1,
+		WATER_SHORE = 1 << 2, //Makes water next to it coastal
+		WATER_RIVERBED = 1 << 3
+	};
+	inline unsigned char WaterTerrain(const Coordinate& p) const {
+		return waterTerrain[p.Y() * extent.X() + p.X()];
+	}
+	inline WaterNode* WaterAt(const Coordinate& p) const {
+		return waterNodes[p.Y() * extent.X() + p.X()];
+	}
+
 	bool IsLow(const Coordinate&) const;
 	void SetLow(const Coordinate&,bool);
 	bool BlocksWater(const Coordinate&) const;
@@ -117,7 +157,7 @@ public:
 	void Mark(const Coordinate&);
 	void Unmark(const Coordinate&);
 	bool GroundMarked(const Coordinate&);
-	int GetMoveModifier(const Coordinate&);
+	int GetMoveModifier(const Coordinate&, Random::Generator&); //Runs in NPC::UpdateState, hence the generator
 	float GetWaterlevel();
 	void WalkOver(const Coordinate&);
 	void Naturify(const Coordinate&);
@@ -158,9 +198,10 @@ public:
 	
 	Coordinate FindRangedAdvantage(const Coordinate&);
 
+	static const int MAX_DEFERRED_CACHE_UPDATES = 5;
 	mutable boost::shared_mutex cacheMutex;
 	void UpdateCache();
 	void TileChanged(const Coordinate&);
 };
 
-BOOST_CLASS_VERSION(Map, 2)
+BOOST_CLASS_VERSION(Map, 3)
@@ -17,6 +17,7 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 
 #include <queue>
 #include <list>
+#include <vector>
 
 #include <boost/thread/thread.hpp>
 #include <boost/multi_array.hpp>
@@ -32,10 +33,13 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include "StatusEffect.hpp"
 #include "Squad.hpp"
 #include "Attack.hpp"
+#include "Pathfinder.hpp"
+#include "Random.hpp"
 
 #include "data/Serialization.hpp"
 
 #define LOS_DISTANCE 12
+#define FOV_REFRESH 5 //Ticks the constructions and fire seen are reused for, unless the view changes
 #define MAXIMUM_JOB_ATTEMPTS 5
 
 #define THIRST_THRESHOLD (UPDATES_PER_SECOND * 60 * 10)
@@ -47,6 +51,24 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 typedef int NPCType;
 
 class Faction;
+class FieldOfView;
+class NPC;
+
+/* Something an NPC's parallel update can't do by itself, carried out afterwards on the game thread */
+struct NPCCommand {
+	enum Type {
+		HANDLETHIRST,
+		HANDLEHUNGER,
+		HANDLEWEARINESS,
+		DIEOFTHIRST,
+		DIEOFHUNGER
+	};
+
+	NPCCommand(NPC* npc, Type type) : npc(npc), type(type) {}
+
+	NPC* npc;
+	Type type;
+};
 
 enum Trait {
 	FRESH,
@@ -107,7 +129,8 @@ class NPC : public Entity {
 	friend class Game;
 	friend class NPCListener;
 	friend class Faction;
-	friend void tFindPath(TCODPath*, int, int, int, int, NPC*, bool);
+	friend class PathWorker;
+	friend class AIScheduler;
 	
 	NPC(Coordinate = Coordinate(0,0),
 		boost::function<bool(boost::shared_ptr<NPC>)> findJob = boost::function<bool(boost::shared_ptr<NPC>)>(),
@@ -118,8 +141,8 @@ class NPC : public Entity {
 	int taskIndex;
 	int orderIndex;
 
-	boost::mutex pathMutex;
-	TCODPath *path;
+	boost::shared_ptr<PathRequest> pathRequest;
+	std::vector<Coordinate> path;
 	int pathIndex;
 	bool nopath;
 	bool findPathWorking;
@@ -171,6 +194,19 @@ class NPC : public Entity {
 	int effectiveStats[STAT_COUNT];
 	int baseResistances[RES_COUNT];
 	int effectiveResistances[RES_COUNT];
+	//Stats and resistances with the status effects, armor and camp disease modifier applied
+	int cachedStats[STAT_COUNT];
+	int cachedResistances[RES_COUNT];
+	bool statsChanged; //Effects or base stats changed since the cache was filled
+	int cachedDiseaseModifier, cachedArmor;
+	bool effectTimersChanged; //A damaging effect was added and needs a timer
+	int lastEffectTimer;
+	void ScheduleEffectDamage();
+	static void EffectDamage(boost::weak_ptr<NPC>, int effectType, int timer);
+	bool randomEventsScheduled;
+	void ScheduleRandomEvents();
+	static bool FilthEvent(boost::weak_ptr<NPC>);
+	static bool CrackedSkullEvent(boost::weak_ptr<NPC>);
 	bool aggressive, coward;
 	boost::weak_ptr<NPC> aggressor;
 	bool dead;
@@ -182,22 +218,33 @@ class NPC : public Entity {
 	bool Escaped() const;
 	void Escape();
 	void DestroyAllItems();
-	void UpdateStatusEffects();
+	void UpdateStatusEffects(std::vector<NPCCommand>&);
+	void HandleStatusEffects();
 
 	static std::map<std::string, NPCType> NPCTypeNames;
 
 	void UpdateVelocity();
 	int addedTasksToCurrentJob;
+	int decisionWait; //Ticks a pending decision has been held back by the AIScheduler
 
 	bool hasMagicRangedAttacks;
 
 	void ScanSurroundings(bool onlyHostiles=false);
 	Coordinate threatLocation;
 	bool seenFire;
+	boost::shared_ptr<const FieldOfView> fov;
+	int fovTimer;
+	Coordinate fireLocation; //Closest fire seen when the field of view was last computed
+
+	bool inGrid;
+	Coordinate gridPos;
+	int gridFaction;
+	void FileInGrid(const Coordinate&);
 
 	std::set<Trait> traits;
 	int damageDealt, damageReceived;
 	bool statusEffectsChanged;
+	Random::Generator rng; //For UpdateState, which can't use the shared one
 
 	void UpdateHealth();
 	boost::shared_ptr<Faction> factionPtr;
@@ -218,8 +265,12 @@ public:
 	virtual void Position(const Coordinate&);
 	void Position(const Coordinate&, bool firstTime);
 	SkillSet Skills;
-	void Think();
+	void UpdateState(std::vector<NPCCommand>&);
+	void Apply(const NPCCommand&);
 	void Update();
+	void Think();
+	bool DecisionPending() const;
+	void Decide(bool catchUp = true);
 	void Draw(Coordinate, TCODConsole*);
 	virtual void GetTooltip(int x, int y, Tooltip *tooltip);
 	void speed(unsigned int);
@@ -236,7 +287,7 @@ public:
 	boost::weak_ptr<Entity> currentEntity() const;
 	void TaskFinished(TaskResult, std::string = "");
 	TaskResult Move(TaskResult);
-	void findPath(Coordinate);
+	void findPath(Coordinate, bool synchronous = false);
 	bool IsPathWalkable();
 	void StartJob(boost::shared_ptr<Job>);
 	void AddEffect(StatusEffectType);
@@ -289,9 +340,6 @@ public:
 	static void PlayerNPCReact(boost::shared_ptr<NPC>);
 	static void AnimalReact(boost::shared_ptr<NPC>);
 	
-	static unsigned int pathingThreadCount;
-	static boost::mutex threadCountMutex;
-
 	void AddTrait(Trait);
 	void RemoveTrait(Trait);
 	bool HasTrait(Trait) const;
@@ -311,5 +359,3 @@ public:
 };
 
 BOOST_CLASS_VERSION(NPC, 1)
-
-void tFindPath(TCODPath*, int, int, int, int, NPC*, bool);
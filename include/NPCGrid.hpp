@@ -0,0 +1,42 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+#include "Coordinate.hpp"
+
+class NPC;
+
+/* NPCs by faction and map square, so finding who's around a tile only looks at the squares
+in range, and friendly factions can be skipped as a whole */
+class NPCGrid {
+public:
+	static const int BUCKET_SIZE = 8;
+
+	void Add(NPC*, const Coordinate&, int faction);
+	void Remove(NPC*, const Coordinate&, int faction);
+	void Move(NPC*, const Coordinate& from, int fromFaction, const Coordinate& to, int toFaction);
+
+	int Factions() const;
+	//Appends the faction's NPCs in the rectangle between low and high, inclusive
+	void Find(int faction, const Coordinate& low, const Coordinate& high, std::vector<NPC*>&) const;
+
+private:
+	typedef boost::unordered_map<Coordinate, std::vector<NPC*> > Buckets;
+	std::vector<Buckets> factions;
+};
@@ -0,0 +1,83 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <list>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "Coordinate.hpp"
+
+class Map;
+class NPC;
+
+/* Recently computed long paths, so the next goblin hauling from the same spot to the same
+stockpile reuses the route instead of searching again. A hit only needs a short local search
+from the NPC onto the start of the cached path.
+Every path remembers which map clusters it crosses and the map version it was found at, a
+cost change in any of those clusters makes it stale. */
+class PathCache {
+public:
+	static const int REGION_SIZE = 8; //Starts within the same square share entries
+	static const int SPLICE_AHEAD = 8; //How far along the cached path the local search joins it
+	static const unsigned int MIN_LENGTH = 32; //Shorter paths are cheap enough to just recompute
+	static const unsigned int CAPACITY = 256;
+
+	struct Stats {
+		unsigned int hits, misses, stale, entries;
+	};
+
+	PathCache(Map*, int width, int height);
+
+	//Called by the pathing workers with the cache read lock held
+	bool FindPath(const Coordinate& start, const Coordinate& goal, NPC*, std::vector<Coordinate>& path);
+	void Store(const Coordinate& start, const Coordinate& goal, NPC*, const std::vector<Coordinate>& path);
+	//Called with the cache write lock held
+	void TileChanged(const Coordinate&);
+
+	Stats GetStats();
+
+private:
+	struct Key {
+		Coordinate region, goal;
+		bool hands;
+		int faction;
+		bool operator==(const Key&) const;
+	};
+	friend std::size_t hash_value(const Key&);
+
+	struct Entry {
+		Key key;
+		std::vector<Coordinate> path;
+		std::vector<int> clusters;
+		unsigned int version;
+	};
+
+	Map* map;
+	int width;
+	std::vector<unsigned int> clusterVersion;
+	unsigned int version;
+
+	boost::mutex mutex;
+	std::list<Entry> entries; //Most recently used first
+	boost::unordered_map<Key, std::list<Entry>::iterator> index;
+	unsigned int hits, misses, stale;
+
+	Key MakeKey(const Coordinate& start, const Coordinate& goal, NPC*) const;
+	int ClusterAt(const Coordinate&) const;
+};
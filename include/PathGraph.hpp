@@ -0,0 +1,86 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <vector>
+
+#include "Coordinate.hpp"
+
+class Map;
+
+/* Hierarchical (HPA*) view of the cached map, used for long NPC routes.
+The map is split into square clusters, entrances are placed along the walkable stretches
+of every cluster border and the costs between the entrances of each cluster are
+precomputed. A long search then only has to cross this small graph, after which the
+route is refined one cluster at a time.
+The graph uses the NPC-agnostic tile costs, refinement uses the real ones. It's read by the
+pathing workers under the cache read lock and repaired by Map::UpdateCache under the write lock. */
+class PathGraph {
+public:
+	static const int CLUSTER_SIZE = 16;
+
+	PathGraph(Map*, int width, int height);
+
+	void TileChanged(const Coordinate&);
+	void Update();
+
+	/* Fills path the same way TCODPath would (start excluded, goal included).
+	Returns false if the graph can't help, the caller should fall back to a full search */
+	bool FindPath(const Coordinate& start, const Coordinate& goal, void* npc, std::vector<Coordinate>& path) const;
+	//A* with the NPC's own costs that never leaves the given rectangle, appends the steps after from up to and including to
+	bool LocalSearch(const Coordinate& origin, const Coordinate& extent, const Coordinate& from, const Coordinate& to, void* npc, std::vector<Coordinate>& path) const;
+
+private:
+	struct Entrance {
+		Coordinate a, b; //a is on the west/north side of the border, b on the east/south side
+		bool operator==(const Entrance& other) const { return a == other.a && b == other.b; }
+	};
+	struct Link {
+		int node;
+		float cost;
+	};
+	struct Node {
+		Coordinate pos;
+		int cluster;
+		int index; //Into the cluster's entrances
+		std::vector<Link> links; //To nodes in neighbouring clusters
+	};
+	struct Cluster {
+		Coordinate origin, extent;
+		std::vector<Coordinate> entrances;
+		std::vector<float> costs; //entrances^2, from row to column
+		int firstNode;
+		bool dirty;
+	};
+
+	Map* map;
+	int width, height;
+	int clustersX, clustersY;
+	std::vector<Cluster> clusters;
+	std::vector<std::vector<Entrance> > eastBorders, southBorders; //Indexed by the west/north cluster
+	std::vector<Node> nodes;
+	bool dirty, linksDirty;
+
+	int ClusterAt(const Coordinate&) const;
+	float Cost(const Coordinate&, void* npc = 0) const;
+
+	bool ScanBorder(int cluster, bool east);
+	void GatherEntrances(int cluster);
+	void ComputeCosts(Cluster&);
+	void BuildNodes();
+
+	void Flood(const Cluster&, const Coordinate&, bool reverse, std::vector<float>& dist) const;
+};
@@ -0,0 +1,93 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "Coordinate.hpp"
+
+class NPC;
+class PathWorker;
+
+/* A single path search. The game thread creates one per NPC::findPath call and polls
+it from NPC::Move, a worker fills in the result. Requests are never shared between NPCs. */
+class PathRequest {
+	friend class Pathfinder;
+	friend class PathWorker;
+
+	NPC* npc;
+	Coordinate start, goal;
+
+	boost::mutex stateMutex; //Guards everything below except the search itself
+	boost::mutex computeMutex; //Held by a worker for as long as it is touching npc
+	bool cancelled;
+	bool done;
+
+	bool nopath;
+	bool dangerous;
+	std::vector<Coordinate> result;
+
+public:
+	PathRequest(NPC*, const Coordinate& start, const Coordinate& goal);
+
+	//Returns immediately, a worker that already started will just throw its result away
+	void Cancel();
+	//Cancels and waits until no worker is using the request's NPC anymore
+	void CancelAndWait();
+
+	/* Moves the finished path into the given arguments and returns true.
+	Returns false without blocking if the search hasn't finished yet */
+	bool Collect(std::vector<Coordinate>& path, bool& nopath, bool& dangerous);
+};
+
+/* Fixed size pool of pathing threads. Each worker owns a request queue and a reusable
+TCODPath buffer; idle workers steal from the back of other workers' queues so a burst
+of requests from one part of the camp is spread over all the cores. */
+class Pathfinder {
+	Pathfinder();
+	static Pathfinder* instance;
+
+	std::vector<PathWorker*> workers;
+	boost::thread_group threads;
+	PathWorker* gameThreadWorker; //Used for synchronous requests
+
+	boost::mutex wakeMutex;
+	boost::condition_variable wake;
+	unsigned int pending;
+	unsigned int nextWorker;
+	bool stopping;
+
+	void Run(unsigned int index);
+	boost::shared_ptr<PathRequest> Steal(unsigned int thief);
+
+public:
+	static Pathfinder* Inst();
+	~Pathfinder();
+
+	//Queues the request, NPC::Move picks up the result once it's done
+	void Submit(boost::shared_ptr<PathRequest>);
+	//Computes the request on the calling thread, for code that needs the path right away
+	void Compute(boost::shared_ptr<PathRequest>);
+
+	unsigned int WorkerCount() const;
+	unsigned int Pending();
+};
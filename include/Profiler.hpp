@@ -0,0 +1,49 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <ostream>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+/* Wall clock time spent in each part of Game::Update, for tracking down what slows a game down.
+Game::Update marks the end of each subsystem's share of the tick with Lap(), which does nothing
+unless the profiler has been enabled */
+class Profiler {
+public:
+	static Profiler* Inst();
+
+	void Enable(bool);
+	bool Enabled() const;
+	void StartTick();
+	void Lap(const char* subsystem); //The time since the previous lap goes to the subsystem
+	void Report(std::ostream&) const;
+
+private:
+	Profiler();
+	static Profiler* instance;
+
+	struct Subsystem {
+		const char* name;
+		boost::posix_time::time_duration total, longest;
+	};
+
+	bool enabled;
+	unsigned int ticks;
+	boost::posix_time::ptime tickStart, lapStart;
+	boost::posix_time::time_duration total, longestTick;
+	std::vector<Subsystem> subsystems; //In the order they first ran
+};
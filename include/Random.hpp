@@ -42,6 +42,7 @@ namespace Random {
 		int Generate(int, int);
 		int Generate(int);
 		double Generate();
+		int Geometric(int);
 		short Sign();
 		bool GenerateBool();
 		Coordinate ChooseInExtent(const Coordinate& origin, const Coordinate& extent);
@@ -54,10 +55,11 @@ namespace Random {
 		unsigned int seed;
 	};
 	
-	void Init();
+	void Init(unsigned int seed = 0);
 	int Generate(int, int);
 	int Generate(int);
 	double Generate();
+	int Geometric(int);
 	short Sign();
 	bool GenerateBool();
 	
@@ -92,8 +92,9 @@ public:
 	int cooldownDefault;
 	double statChanges[STAT_COUNT]; //These are percentage values of the original value (100% = no change)
 	double resistanceChanges[RES_COUNT]; //These are percentage values of the original value (100% = no change)
-	std::pair<int,int> damage; //First - counter, second - damage amount
+	std::pair<int,int> damage; //First - ticks between hits, second - damage amount
 	int damageType;
+	int damageTimer; //Id of the TimerWheel timer doing the damage, 0 while there's none. Not saved
 	bool visible;
 	bool negative; //Is this a negative effect? ie. one the creature wants to get rid of
 	int contagionChance; //How contagious (if at all) is this effect?
@@ -0,0 +1,72 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <map>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "Coordinate.hpp"
+
+class Stockpile;
+typedef int ItemType;
+typedef int ItemCategory;
+
+/* The stockpiles that allow each item category, filed in square buckets by their center so
+Game::StockpileItem only looks at the ones near the item that would take it, nearest first.
+Whether a stockpile is full depends on the tiles around it as well as its contents, so that's
+still asked from the stockpile, but a full answer is remembered until the stockpile changes or
+a second passes */
+class StockpileDirectory {
+public:
+	static const int BUCKET_SIZE = 32;
+
+	static StockpileDirectory* Inst();
+	static void Reset();
+
+	void Add(const boost::shared_ptr<Stockpile>&);
+	void Remove(int uid);
+	void Refile(Stockpile*); //Allowed categories or size changed
+	void Changed(int uid); //Contents or reservations changed
+
+	//The closest stockpile that allows the type and has room for it
+	boost::shared_ptr<Stockpile> FindNearest(ItemType, const Coordinate&);
+	//The one with the most demand for the category, closest first if that's a tie
+	boost::shared_ptr<Stockpile> FindByDemand(ItemType, ItemCategory demandCategory, const Coordinate&);
+
+private:
+	StockpileDirectory();
+	static StockpileDirectory* instance;
+
+	typedef std::map<int, boost::weak_ptr<Stockpile> > Bucket; //By uid, so ties always go the same way
+	typedef boost::unordered_map<Coordinate, Bucket> Buckets;
+
+	struct Entry {
+		boost::weak_ptr<Stockpile> stockpile;
+		Coordinate bucket;
+		std::vector<ItemCategory> categories;
+		std::map<ItemType, int> fullSince; //Tick a type was last found not to fit
+	};
+
+	std::vector<Buckets> categories;
+	boost::unordered_map<int, Entry> entries; //By stockpile uid
+
+	void File(int uid, Entry&, Stockpile*);
+	void Unfile(int uid, Entry&);
+	bool Full(Entry&, Stockpile*, ItemType);
+};
@@ -0,0 +1,65 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <deque>
+#include <map>
+#include <set>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+class Item;
+class Stockpile;
+typedef int ItemCategory;
+
+/* Loose items waiting to be taken to a stockpile. Items get queued when they come to rest
+somewhere outside a container: created, dropped, landed after flying, or handed to the player.
+A few are tried every tick. Ones no stockpile can take wait with a growing delay, and are
+tried again early when a stockpile allowing their category gets room or the player changes
+the stockpiles */
+class StockpileQueue {
+public:
+	static StockpileQueue* Inst();
+	static void Reset();
+
+	void Push(const boost::shared_ptr<Item>&);
+	void PushLater(const boost::shared_ptr<Item>&); //Starts out waiting, for items that just failed to get stored
+	void Update();
+	void Wake(Stockpile*); //The stockpile has room again
+	void WakeAll();
+
+private:
+	StockpileQueue();
+	static StockpileQueue* instance;
+
+	struct Entry {
+		boost::weak_ptr<Item> item;
+		int attempts;
+		bool parked;
+		std::set<ItemCategory> categories; //Parked under each of these, -1 for none
+		unsigned int ticket; //Tells apart the retry timer that's still current
+	};
+
+	boost::unordered_map<int, Entry> entries; //By item uid
+	std::deque<int> ready;
+	std::map<ItemCategory, std::set<int> > parked;
+	unsigned int tickets;
+
+	void Park(int uid, Entry&, const boost::shared_ptr<Item>&);
+	void Unpark(int uid);
+	static void Retry(int uid, unsigned int ticket);
+};
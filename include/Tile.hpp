@@ -113,23 +113,27 @@ public:
 
 BOOST_CLASS_VERSION(Tile, 0)
 
+/* What the pathing threads see of a tile. The move cost is worked out when the tile changes,
+so only the parts that depend on the NPC are left for the searches */
 class CacheTile {
+	short moveCost; //0 or less if unwalkable
+	unsigned char flags;
+
 public:
-	bool walkable;
-	int moveCost;
-	bool construction;
-	bool door;
-	bool trap;
-	bool bridge;
-	int moveSpeedModifier;
-	int waterDepth;
-	int npcCount;
-	bool fire;
-	int x;
-	int y;
+	enum Flag {
+		WALKABLE = 1 << 0,
+		CONSTRUCTION = 1 << 1,
+		DOOR = 1 << 2,
+		TRAP = 1 << 3,
+		FIRE = 1 << 4
+	};
 
 	CacheTile();
 	CacheTile& operator=(const Tile&);
 	int GetMoveCost() const;
-	int GetMoveCost(void*) const;
+	int GetMoveCost(const Coordinate&, void*) const;
+	bool IsWalkable() const;
+	bool HasDoor() const;
+	bool HasTrap() const;
+	bool OnFire() const;
 };
@@ -0,0 +1,61 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <vector>
+#include <boost/function.hpp>
+
+/* Callbacks to run a number of ticks from now. The next SLOTS ticks each have their own slot, so
+a tick only looks at its own timers. Timers further out wait in a coarser ring with a slot per
+SLOTS ticks, and get moved down into the fine one when their stretch of ticks comes up. Anything
+beyond that sits in an overflow list that gets sorted out once per lap of the coarse ring.
+Timers due on the same tick run in the order they were scheduled in */
+class TimerWheel {
+public:
+	typedef boost::function<void()> Callback;
+	typedef boost::function<bool()> Recurring; //Returns false when it shouldn't fire again
+	static const int SLOTS = 256;
+
+	TimerWheel();
+
+	void Schedule(int delay, const Callback&); //Delays under a tick run on the next one
+	/* For rare events that used to roll a one in chance on every tick. The wait until the next
+	time is drawn once instead, which gives the same odds */
+	void ScheduleRandom(int chance, const Recurring&);
+	void Advance();
+	void Clear();
+
+	int Now() const;
+	unsigned int Size() const;
+
+private:
+	struct Timer {
+		int due;
+		unsigned int sequence;
+		Callback callback;
+		bool operator<(const Timer&) const;
+	};
+
+	std::vector<std::vector<Timer> > ticks; //One slot per tick
+	std::vector<std::vector<Timer> > laps; //One slot per SLOTS ticks
+	std::vector<Timer> overflow;
+	int now;
+	unsigned int count;
+	unsigned int sequence;
+
+	void Place(const Timer&);
+	void FireRandom(int chance, Recurring);
+};
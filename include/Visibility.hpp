@@ -0,0 +1,51 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "Coordinate.hpp"
+#include "FieldOfView.hpp"
+
+class Map;
+
+/* Fields of view shared between everyone standing in the same small cell, so a group of goblins
+standing together doesn't each cast their own. A view is kept until a tile within its radius
+starts or stops blocking light. The views also answer what a whole faction can see, going
+through the faction's NPCs near the point in question */
+class Visibility {
+public:
+	static const int CELL_SIZE = 3;
+
+	Visibility(Map*);
+
+	/* The view from the centre of p's cell, it covers LOS_DISTANCE around any tile in the cell.
+	If the centre is a wall or can't be seen from p, p gets a view of its own instead */
+	boost::shared_ptr<const FieldOfView> View(const Coordinate& p, bool seeOverWalls = false);
+	bool FactionSees(int faction, const Coordinate& p);
+
+	//Called when p starts or stops blocking light
+	void TileChanged(const Coordinate& p);
+
+private:
+	typedef boost::unordered_map<Coordinate, boost::shared_ptr<FieldOfView> > Views;
+
+	Map* map;
+	Views views[2]; //Indexed by seeOverWalls
+	Views ownViews; //By position, for tiles that can't share their cell's view
+};
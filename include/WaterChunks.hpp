@@ -0,0 +1,59 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include "Coordinate.hpp"
+
+class WaterNode;
+
+/* Keeps track of which parts of the map have water that's still moving. The map is split into
+chunks, every awake chunk gets all of its water updated once per UPDATE_INTERVAL ticks, with the
+chunks spread over the ticks in between. A chunk that has stayed the same for a few updates goes
+to sleep, and is woken up by new water or by any tile changing in or next to it. Sleeping chunks
+still get an occasional update so puddles can dry out. */
+class WaterChunks {
+public:
+	static const int CHUNK_SIZE = 16;
+	static const int UPDATE_INTERVAL = 50;
+	static const int SLEEP_INTERVAL = 20; //Sleeping chunks update once every this many intervals
+	static const int QUIET_UPDATES = 3; //Updates without change before a chunk sleeps
+
+	WaterChunks(int width, int height);
+
+	void Add(boost::shared_ptr<WaterNode>);
+	void Wake(const Coordinate&); //Wakes the chunks the tile or any of its neighbours are in
+	void Update(); //Water that dries up is taken off the map, but not out of Game::waterList
+
+private:
+	struct Chunk {
+		std::vector<boost::weak_ptr<WaterNode> > nodes;
+		bool awake, scheduled;
+		int quiet;
+	};
+
+	int width, height, chunksX, chunksY;
+	std::vector<Chunk> chunks;
+	std::vector<std::vector<int> > schedule; //Chunks with water by the tick they update on
+	unsigned int tick;
+
+	int ChunkAt(const Coordinate&) const;
+	void WakeChunk(int);
+	void UpdateChunk(int);
+};
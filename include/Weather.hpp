@@ -40,7 +40,10 @@ class Weather {
 	int changePosition;
 	int currentTemperature;
 	int currentSeason;
+	bool scheduled;
 	void SeasonChange();
+	bool WindEvent();
+	bool WeatherEvent();
 
 public:
 	Weather(Map* map = 0);
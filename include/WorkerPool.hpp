@@ -0,0 +1,54 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#pragma once
+
+#include <exception>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+/* Fixed set of threads for work that has to be done before the tick can go on. Run hands out
+the parts to the workers and the calling thread alike, and returns once they're all done */
+class WorkerPool {
+public:
+	static WorkerPool* Inst();
+	~WorkerPool();
+
+	/* Calls job(part) once for every part in [0, parts). If any part throws, the other parts
+	still run and the first exception is rethrown once they're done */
+	void Run(const boost::function<void(unsigned int)>& job, unsigned int parts);
+	//Counting the calling thread
+	unsigned int Threads() const;
+
+private:
+	WorkerPool();
+	static WorkerPool* instance;
+
+	boost::thread_group threads;
+	unsigned int threadCount;
+
+	boost::mutex mutex; //Guards everything below
+	boost::condition_variable wake, done;
+	boost::function<void(unsigned int)> job;
+	unsigned int parts, nextPart, unfinished;
+	unsigned int generation;
+	std::exception_ptr failure; //Thrown by a part of the current job
+	bool stopping;
+
+	void Loop();
+	void Work(boost::unique_lock<boost::mutex>&);
+};
@@ -17,14 +17,16 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 
 #include <cstdint>
 #include <ctime>
+#include <boost/function.hpp>
 
 namespace Data {
 	// saves
 	struct Save {
 		std::string filename, size, date;
+		std::string summary; // empty for saves that don't have one
 		time_t timestamp; // for sorting
 		
-		Save(const std::string&, std::uintmax_t, time_t);
+		Save(const std::string&, std::uintmax_t, time_t, const std::string&);
 	};
 	
 	// http://www.sgi.com/tech/stl/LessThanComparable.html
@@ -45,6 +47,7 @@ namespace Data {
 	unsigned CountSavedGames();
 	bool LoadGame(const std::string&);
 	bool SaveGame(const std::string&, bool=true);
+	void SaveGameInBackground(const std::string&, bool, boost::function<void(bool)>);
 	
 	// font, config
 	void LoadConfig();
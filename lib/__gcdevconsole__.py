@@ -37,3 +37,13 @@ def out(expr):
 	
 	# TODO: expose console width (cvars expose only absolute width)
 	print(textwrap.fill(expr, 80))
+
+def pathstats():
+	'''
+		Prints path cache statistics.
+	'''
+	stats = gcamp.getPathCacheStats()
+	lookups = stats['hits'] + stats['misses']
+	rate = 100.0 * stats['hits'] / lookups if lookups else 0.0
+	print('hits: {hits}  misses: {misses} (stale: {stale})  entries: {entries}'.format(**stats))
+	print('hit rate: {0:.1f}%'.format(rate))
@@ -28,3 +28,9 @@ isDevMode.__doc__ = 'Returns True if running in a devmode'
 
 delay = _gcampapi.delay
 delay.__doc__ = 'Run a function after a delay'
+
+scheduleRandom = _gcampapi.scheduleRandom
+scheduleRandom.__doc__ = 'Run a function with a one in chance probability every tick, until it returns False'
+
+getPathCacheStats = _gcampapi.getPathCacheStats
+getPathCacheStats.__doc__ = 'Returns a dict with the path cache hit, miss and stale counts and its current size'
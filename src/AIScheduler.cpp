@@ -0,0 +1,106 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "AIScheduler.hpp"
+#include "NPC.hpp"
+#include "GCamp.hpp"
+#include "data/Config.hpp"
+
+namespace {
+	const int SLEEP_INTERVAL = UPDATES_PER_SECOND; //Sleepers catch up on everything when they do decide
+	const int IDLE_INTERVAL = UPDATES_PER_SECOND / 2; //Idlers only make the one decision
+	const int MAX_WAIT = UPDATES_PER_SECOND * 2;
+}
+
+AIScheduler* AIScheduler::instance = 0;
+
+AIScheduler* AIScheduler::Inst() {
+	if (!instance) instance = new AIScheduler();
+	return instance;
+}
+
+void AIScheduler::Reset() {
+	delete instance;
+	instance = new AIScheduler();
+}
+
+AIScheduler::AIScheduler() {}
+
+bool AIScheduler::LongestWaiting(const boost::shared_ptr<NPC>& a, const boost::shared_ptr<NPC>& b) {
+	return a->decisionWait > b->decisionWait;
+}
+
+AIScheduler::Urgency AIScheduler::Classify(NPC* npc) {
+	if (npc->aggressor.lock() || npc->threatLocation != undefined ||
+		npc->HasEffect(PANIC) || npc->HasEffect(BURNING)) return COMBAT;
+	if (npc->jobs.empty() || npc->jobs.front()->name == "Idle") return IDLE;
+
+	Task* task = npc->currentTask();
+	if (!task) return WORKING;
+	switch (task->action) {
+	case KILL:
+		return COMBAT;
+
+	case MOVE:
+	case MOVEADJACENT:
+	case MOVENEAR:
+	case FLEEMAP:
+		return MOVING;
+
+	case SLEEP:
+		return SLEEPING;
+
+	default:
+		return WORKING;
+	}
+}
+
+void AIScheduler::Schedule(const boost::shared_ptr<NPC>& npc) {
+	Urgency urgency = Classify(npc.get());
+	if (npc->decisionWait >= MAX_WAIT) {
+		urgency = COMBAT;
+	} else if ((urgency == SLEEPING && npc->decisionWait < SLEEP_INTERVAL) ||
+		(urgency == IDLE && npc->decisionWait < IDLE_INTERVAL)) {
+		++npc->decisionWait;
+		return;
+	}
+	queues[urgency].push_back(npc);
+}
+
+void AIScheduler::Run() {
+	int budget = Config::GetCVar<int>("aiBudget");
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+	for (int urgency = 0; urgency < URGENCY_COUNT; ++urgency) {
+		std::vector<boost::shared_ptr<NPC> >& queue = queues[urgency];
+		std::stable_sort(queue.begin(), queue.end(), LongestWaiting);
+		for (std::vector<boost::shared_ptr<NPC> >::iterator npci = queue.begin(); npci != queue.end(); ++npci) {
+			NPC* npc = npci->get();
+			if (urgency != COMBAT && budget > 0 &&
+				(boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() > budget) {
+				++npc->decisionWait;
+				continue;
+			}
+			if (!npc->Dead()) npc->Decide(urgency != IDLE);
+			npc->decisionWait = 0;
+		}
+		queue.clear();
+	}
+}
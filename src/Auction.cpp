@@ -0,0 +1,75 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <deque>
+
+#include "Auction.hpp"
+
+namespace {
+	/* Minimum bid increment. The result is within bidders * EPSILON of the best possible total,
+	which for job assignment values measured in tiles is plenty */
+	const int EPSILON = 2;
+	const unsigned int DEADLINE_CHECK_INTERVAL = 64;
+}
+
+std::vector<int> FindAuctionAssignment(const std::vector<std::vector<AuctionCandidate> >& candidates,
+	std::vector<int>& prices, boost::posix_time::ptime deadline, bool& complete) {
+	std::vector<int> assignment(candidates.size(), -1);
+	std::vector<int> owner(prices.size(), -1);
+
+	std::deque<int> unassigned;
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		if (!candidates[i].empty()) unassigned.push_back(i);
+	}
+
+	complete = true;
+	unsigned int rounds = 0;
+	while (!unassigned.empty()) {
+		if (++rounds % DEADLINE_CHECK_INTERVAL == 0 && boost::posix_time::microsec_clock::universal_time() > deadline) {
+			complete = false;
+			break;
+		}
+
+		int bidder = unassigned.front();
+		unassigned.pop_front();
+
+		//Staying unassigned is the implicit alternative worth 0
+		int best = -1, bestValue = 0, secondValue = 0;
+		for (std::vector<AuctionCandidate>::const_iterator candidate = candidates[bidder].begin();
+			candidate != candidates[bidder].end(); ++candidate) {
+			int value = candidate->value - prices[candidate->object];
+			if (value > bestValue) {
+				secondValue = bestValue;
+				bestValue = value;
+				best = candidate->object;
+			} else if (value > secondValue) {
+				secondValue = value;
+			}
+		}
+		if (best < 0) continue; //Everything got too expensive, this bidder sits out
+
+		prices[best] += bestValue - secondValue + EPSILON;
+		if (owner[best] >= 0) {
+			assignment[owner[best]] = -1;
+			unassigned.push_back(owner[best]);
+		}
+		owner[best] = bidder;
+		assignment[bidder] = best;
+	}
+
+	return assignment;
+}
@@ -0,0 +1,169 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <deque>
+
+#include "Connectivity.hpp"
+
+namespace {
+	//The 8 neighbours in order around the tile, so consecutive entries are adjacent
+	const int ringX[8] = { -1, 0, 1, 1, 1, 0, -1, -1 };
+	const int ringY[8] = { -1, -1, -1, 0, 1, 1, 1, 0 };
+}
+
+Connectivity::Connectivity(int width, int height) : width(width), height(height) {
+	//A new map is all grass, so every class starts out as one region
+	for (int c = 0; c < CLASS_COUNT; ++c) {
+		passable[c].assign(width * height, true);
+		labels[c].assign(width * height, 0);
+		parent[c].assign(1, 0);
+		relabel[c] = false;
+	}
+}
+
+int Connectivity::Find(Class c, int label) const {
+	while (parent[c][label] != label) {
+		parent[c][label] = parent[c][parent[c][label]];
+		label = parent[c][label];
+	}
+	return label;
+}
+
+int Connectivity::Region(Class c, const Coordinate& p) const {
+	int label = labels[c][p.Y() * width + p.X()];
+	return label < 0 ? -1 : Find(c, label);
+}
+
+void Connectivity::TileChanged(const Coordinate& p, bool walkable, bool door) {
+	bool open[CLASS_COUNT] = { walkable, walkable && !door };
+	for (int i = 0; i < CLASS_COUNT; ++i) {
+		Class c = static_cast<Class>(i);
+		if (open[c] == passable[c][p.Y() * width + p.X()]) continue;
+		if (open[c]) Open(c, p);
+		else Close(c, p);
+	}
+}
+
+void Connectivity::Open(Class c, const Coordinate& p) {
+	int index = p.Y() * width + p.X();
+	passable[c][index] = true;
+	if (relabel[c]) return; //Labels are recomputed anyway
+
+	int region = -1;
+	for (int i = 0; i < 8; ++i) {
+		Coordinate n = p + Coordinate(ringX[i], ringY[i]);
+		if (!n.insideExtent(zero, Coordinate(width, height))) continue;
+		int other = Region(c, n);
+		if (other < 0) continue;
+		if (region < 0) region = other;
+		else if (other != region) parent[c][other] = region;
+	}
+	if (region < 0) {
+		region = parent[c].size();
+		parent[c].push_back(region);
+	}
+	labels[c][index] = region;
+}
+
+void Connectivity::Close(Class c, const Coordinate& p) {
+	int index = p.Y() * width + p.X();
+	passable[c][index] = false;
+	labels[c][index] = -1;
+	if (!relabel[c] && MaySplit(c, p)) relabel[c] = true;
+}
+
+/* Removing a tile can only split its region if the passable tiles around it aren't connected
+to each other without it. Walls built in the open or extended lengthwise never trigger a relabel */
+bool Connectivity::MaySplit(Class c, const Coordinate& p) const {
+	bool open[8];
+	int count = 0;
+	for (int i = 0; i < 8; ++i) {
+		Coordinate n = p + Coordinate(ringX[i], ringY[i]);
+		open[i] = n.insideExtent(zero, Coordinate(width, height)) && passable[c][n.Y() * width + n.X()];
+		if (open[i]) ++count;
+	}
+	if (count <= 1) return false;
+
+	/* Count the runs of passable tiles around the ring. Diagonal moves are allowed, so a corner
+	tile links to its side neighbours, and two side tiles link through a blocked corner as well */
+	int runs = 0;
+	for (int i = 0; i < 8; ++i) {
+		if (!open[i]) continue;
+		int prev = (i + 7) % 8;
+		bool linked = open[prev] || (i % 2 == 1 && !open[prev] && open[(i + 6) % 8]);
+		if (!linked) ++runs;
+	}
+	return runs > 1;
+}
+
+void Connectivity::Relabel(Class c) {
+	labels[c].assign(width * height, -1);
+	parent[c].clear();
+
+	std::deque<int> open;
+	for (int start = 0; start < width * height; ++start) {
+		if (!passable[c][start] || labels[c][start] >= 0) continue;
+		int region = parent[c].size();
+		parent[c].push_back(region);
+		labels[c][start] = region;
+		open.push_back(start);
+		while (!open.empty()) {
+			int current = open.front();
+			open.pop_front();
+			int x = current % width, y = current / width;
+			for (int i = 0; i < 8; ++i) {
+				int nx = x + ringX[i], ny = y + ringY[i];
+				if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+				int next = ny * width + nx;
+				if (passable[c][next] && labels[c][next] < 0) {
+					labels[c][next] = region;
+					open.push_back(next);
+				}
+			}
+		}
+	}
+	relabel[c] = false;
+}
+
+void Connectivity::Update() {
+	for (int i = 0; i < CLASS_COUNT; ++i) {
+		if (relabel[i]) Relabel(static_cast<Class>(i));
+	}
+}
+
+bool Connectivity::Connected(const Coordinate& from, const Coordinate& to, Class c) const {
+	Coordinate extent(width, height);
+	if (!from.insideExtent(zero, extent) || !to.insideExtent(zero, extent)) return true;
+	if (relabel[c]) return true; //Not up to date, don't guess
+
+	int goal = Region(c, to);
+	if (goal < 0) return true;
+
+	int start = Region(c, from);
+	if (start >= 0) return start == goal;
+
+	bool blocked = true;
+	for (int i = 0; i < 8; ++i) {
+		Coordinate n = from + Coordinate(ringX[i], ringY[i]);
+		if (!n.insideExtent(zero, extent)) continue;
+		int region = Region(c, n);
+		if (region == goal) return true;
+		if (region >= 0) blocked = false;
+	}
+	//Completely walled in, leave it to the pathfinder
+	return blocked;
+}
@@ -87,7 +87,8 @@ Construction::Construction(ConstructionType vtype, const Coordinate& target) : E
 	time(0),
 	built(false),
 	flammable(false),
-	smoke(0)
+	smoke(0),
+	spawnScheduled(false)
 {
 	pos = target;
 	graphic = Construction::Presets[type].graphic;
@@ -824,28 +825,39 @@ void Construction::UpdateWallGraphic(bool recurse, bool self) {
 				Game::Inst()->GetConstruction(consId[i]).lock()->UpdateWallGraphic(false);
 }
 
+bool Construction::SpawnEvent(boost::weak_ptr<Construction> wcons) {
+	boost::shared_ptr<Construction> construct = wcons.lock();
+	if (!construct) return false;
+	if (construct->condition > 0) construct->SpawnCreatures();
+	return true;
+}
+
+void Construction::SpawnCreatures() {
+	NPCType monsterType = Game::Inst()->GetRandomNPCTypeByTag(Construction::Presets[type].spawnCreaturesTag);
+	TCODColor announceColor = NPC::Presets[monsterType].tags.find("friendly") != 
+		NPC::Presets[monsterType].tags.end() ? TCODColor::green : TCODColor::red;
+
+	if (announceColor == TCODColor::red && Config::GetCVar<bool>("pauseOnDanger")) 
+		Game::Inst()->AddDelay(UPDATES_PER_SECOND, boost::bind(&Game::Pause, Game::Inst()));
+
+	int amount = Game::DiceToInt(NPC::Presets[monsterType].group);
+	if (amount == 1) {
+		Announce::Inst()->AddMsg("A "+NPC::NPCTypeToString(monsterType)+" emerges from the "+name+"!", announceColor, Position());
+	} else {
+		Announce::Inst()->AddMsg(NPC::Presets[monsterType].plural+" emerge from the "+name+"!", announceColor, Position());
+	}
+	for (int i = 0; i < amount; ++i) {
+		Game::Inst()->CreateNPC(Position() + ProductionSpot(type), monsterType);
+	}
+}
+
 bool Construction::HasTag(ConstructionTag tag) const { return Construction::Presets[type].tags[tag]; }
 
 void Construction::Update() {
-	if (Construction::Presets[type].spawnCreaturesTag != "" && condition > 0) {
-		if (Random::Generate(Construction::Presets[type].spawnFrequency - 1) == 0) {
-			NPCType monsterType = Game::Inst()->GetRandomNPCTypeByTag(Construction::Presets[type].spawnCreaturesTag);
-			TCODColor announceColor = NPC::Presets[monsterType].tags.find("friendly") != 
-				NPC::Presets[monsterType].tags.end() ? TCODColor::green : TCODColor::red;
-
-			if (announceColor == TCODColor::red && Config::GetCVar<bool>("pauseOnDanger")) 
-				Game::Inst()->AddDelay(UPDATES_PER_SECOND, boost::bind(&Game::Pause, Game::Inst()));
-
-			int amount = Game::DiceToInt(NPC::Presets[monsterType].group);
-			if (amount == 1) {
-				Announce::Inst()->AddMsg("A "+NPC::NPCTypeToString(monsterType)+" emerges from the "+name+"!", announceColor, Position());
-			} else {
-				Announce::Inst()->AddMsg(NPC::Presets[monsterType].plural+" emerge from the "+name+"!", announceColor, Position());
-			}
-			for (int i = 0; i < amount; ++i) {
-				Game::Inst()->CreateNPC(Position() + ProductionSpot(type), monsterType);
-			}
-		}
+	if (!spawnScheduled && Construction::Presets[type].spawnCreaturesTag != "") {
+		spawnScheduled = true;
+		Game::Inst()->Timers()->ScheduleRandom(Construction::Presets[type].spawnFrequency, boost::bind(&Construction::SpawnEvent,
+			boost::weak_ptr<Construction>(boost::static_pointer_cast<Construction>(shared_from_this()))));
 	}
 
 	if (!Construction::Presets[type].passiveStatusEffects.empty() && !map->NPCList(pos)->empty()) {
@@ -16,6 +16,7 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include "stdafx.hpp"
 
 #include <boost/format.hpp>
+#include <boost/bind.hpp>
 #include <boost/algorithm/string.hpp>
 
 #if DEBUG
@@ -35,6 +36,7 @@ Events::Events(Map* vmap) :
 	map(vmap),
 	hostileSpawningMonsters(std::vector<int>()),
 	timeSinceHostileSpawn(0),
+	safe(true),
 	peacefulAnimals(std::vector<int>()),
 	migratingAnimals(std::vector<int>())
 {
@@ -48,40 +50,59 @@ Events::Events(Map* vmap) :
 		if (NPC::Presets[i].tags.find("migratory") != NPC::Presets[i].tags.end())
 			migratingAnimals.push_back(i);
 		}
+
+	//Events are created along with the game, so its timers are already there
+	TimerWheel* timers = Game::Inst()->Timers();
+	timers->ScheduleRandom(UPDATES_PER_SECOND * 60 * 15, boost::bind(&Events::HostileSpawnEvent, this));
+	timers->ScheduleRandom(UPDATES_PER_SECOND * 60 * 2, boost::bind(&Events::BenignFaunaEvent, this));
+	timers->ScheduleRandom(UPDATES_PER_SECOND * 60 * 30 + 1, boost::bind(&Events::ImmigrantEvent, this));
+	timers->ScheduleRandom(UPDATES_PER_SECOND * 60 * 30 + 1, boost::bind(&Events::MigrationEvent, this));
 }
 
 void Events::Update(bool safe) {
+	this->safe = safe;
 	if (!safe) {
 		++timeSinceHostileSpawn;
-		if (Random::Generate(UPDATES_PER_SECOND * 60 * 15 - 1) == 0 || timeSinceHostileSpawn > (UPDATES_PER_SECOND * 60 * 25)) {
+		if (timeSinceHostileSpawn > (UPDATES_PER_SECOND * 60 * 25)) {
 			SpawnHostileMonsters();
 		}
 	}
+}
 
-	if (Random::Generate(UPDATES_PER_SECOND * 60 * 2 - 1) == 0) {
-		SpawnBenignFauna();
-	}
+bool Events::HostileSpawnEvent() {
+	if (!safe) SpawnHostileMonsters();
+	return true;
+}
 
+bool Events::BenignFaunaEvent() {
+	SpawnBenignFauna();
+	return true;
+}
+
+bool Events::ImmigrantEvent() {
 	//Remove immigrants that have left/died
 	for (std::vector<boost::weak_ptr<NPC> >::iterator immi = existingImmigrants.begin(); immi != existingImmigrants.end();) {
 		if (!immi->lock()) immi = existingImmigrants.erase(immi);
 		else ++immi;
 	}
 
-	if (static_cast<int>(existingImmigrants.size()) < Game::Inst()->OrcCount() / 7 && 
-		Random::Generate(UPDATES_PER_SECOND * 60 * 30) == 0) {
-			SpawnImmigrants();
+	if (static_cast<int>(existingImmigrants.size()) < Game::Inst()->OrcCount() / 7) {
+		SpawnImmigrants();
 	}
-	
+	return true;
+}
+
+bool Events::MigrationEvent() {
 	Season cSeason = Game::Inst()->CurrentSeason();
-	if ((cSeason == EarlySpring ||
+	if (cSeason == EarlySpring ||
 		cSeason == Spring ||
 		cSeason == LateSpring ||
 		cSeason == EarlyFall ||
 		cSeason == Fall ||
-		cSeason == LateFall) && Random::Generate(UPDATES_PER_SECOND * 60 * 30) == 0) {
+		cSeason == LateFall) {
 		SpawnMigratingAnimals();
 	}
+	return true;
 }
 
 namespace {
@@ -248,21 +269,21 @@ void Events::SpawnMigratingAnimals() {
 				// Try the right side first
 				x = Map::Inst()->Width() - 1;
 				y = halfMapHeight + Random::Generate(-halfMapHeight, halfMapHeight);
-				firstNPC->findPath(Coordinate(x, y));
+				firstNPC->findPath(Coordinate(x, y), true);
 				if (firstNPC->IsPathWalkable()) break;
 				tries++;
 				
 				// Try the bottom side
 				x = halfMapWidth + Random::Generate(-halfMapWidth, halfMapWidth);
 				y = 0;
-				firstNPC->findPath(Coordinate(x, y));
+				firstNPC->findPath(Coordinate(x, y), true);
 				if(firstNPC->IsPathWalkable()) break;
 				tries++;
 				
 				// Try top
 				x = halfMapWidth + Random::Generate(-halfMapWidth, halfMapWidth);
 				y = Map::Inst()->Height() - 1;
-				firstNPC->findPath(Coordinate(x, y));
+				firstNPC->findPath(Coordinate(x, y), true);
 				if(firstNPC->IsPathWalkable()) break;
 				tries++;
 			}
@@ -272,21 +293,21 @@ void Events::SpawnMigratingAnimals() {
 				// Try the left side first
 				x = 0;
 				y = halfMapHeight + Random::Generate(-halfMapHeight, halfMapHeight);
-				firstNPC->findPath(Coordinate(x, y));
+				firstNPC->findPath(Coordinate(x, y), true);
 				if (firstNPC->IsPathWalkable()) break;
 				tries++;
 				
 				// Try the bottom side
 				x = halfMapWidth + Random::Generate(-halfMapWidth, halfMapWidth);
 				y = 0;
-				firstNPC->findPath(Coordinate(x, y));
+				firstNPC->findPath(Coordinate(x, y), true);
 				if(firstNPC->IsPathWalkable()) break;
 				tries++;
 				
 				// Try top
 				x = halfMapWidth + Random::Generate(-halfMapWidth, halfMapWidth);
 				y = Map::Inst()->Height() - 1;
-				firstNPC->findPath(Coordinate(x, y));
+				firstNPC->findPath(Coordinate(x, y), true);
 				if(firstNPC->IsPathWalkable()) break;
 				tries++;
 			}
@@ -296,21 +317,21 @@ void Events::SpawnMigratingAnimals() {
 				// Try the left side first
 				x = 0;
 				y = halfMapHeight + Random::Generate(-halfMapHeight, halfMapHeight);
-				firstNPC->findPath(Coordinate(x, y));
+				firstNPC->findPath(Coordinate(x, y), true);
 				if (firstNPC->IsPathWalkable()) break;
 				tries++;
 				
 				// Try the right side
 				x = Map::Inst()->Width() - 1;
 				y = halfMapHeight + Random::Generate(-halfMapHeight, halfMapHeight);
-				firstNPC->findPath(Coordinate(x, y));
+				firstNPC->findPath(Coordinate(x, y), true);
 				if (firstNPC->IsPathWalkable()) break;
 				tries++;
 				
 				// Try top
 				x = halfMapWidth + Random::Generate(-halfMapWidth, halfMapWidth);
 				y = Map::Inst()->Height() - 1;
-				firstNPC->findPath(Coordinate(x, y));
+				firstNPC->findPath(Coordinate(x, y), true);
 				if(firstNPC->IsPathWalkable()) break;
 				tries++;
 			}
@@ -320,21 +341,21 @@ void Events::SpawnMigratingAnimals() {
 				// Try the left side first
 				x = 0;
 				y = halfMapHeight + Random::Generate(-halfMapHeight, halfMapHeight);
-				firstNPC->findPath(Coordinate(x, y));
+				firstNPC->findPath(Coordinate(x, y), true);
 				if (firstNPC->IsPathWalkable()) break;
 				tries++;
 				
 				// Try the right side
 				x = Map::Inst()->Width() - 1;
 				y = halfMapHeight + Random::Generate(-halfMapHeight, halfMapHeight);
-				firstNPC->findPath(Coordinate(x, y));
+				firstNPC->findPath(Coordinate(x, y), true);
 				if (firstNPC->IsPathWalkable()) break;
 				tries++;
 				
 				// Try the bottom side
 				x = halfMapWidth + Random::Generate(-halfMapWidth, halfMapWidth);
 				y = 0;
-				firstNPC->findPath(Coordinate(x, y));
+				firstNPC->findPath(Coordinate(x, y), true);
 				if(firstNPC->IsPathWalkable()) break;
 				tries++;
 			}
@@ -28,6 +28,8 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include "Camp.hpp"
 #include "Random.hpp"
 #include "Announce.hpp"
+#include "Map.hpp"
+#include "Visibility.hpp"
 
 #include <boost/serialization/vector.hpp>
 
@@ -76,6 +78,7 @@ void Faction::RemoveMember(boost::weak_ptr<NPC> member) {
 void Faction::TrapDiscovered(Coordinate trapLocation, bool propagate) {
 	boost::unique_lock<boost::shared_mutex> writeLock(trapVisibleMutex);
 	trapVisible[trapLocation] = true;
+	Map::Inst()->TileChanged(trapLocation); //Trap costs depend on visibility
 	//Inform friends
 	if (propagate) {
 		for (std::set<FactionType>::iterator friendi = friends.begin(); friendi != friends.end(); ++friendi) {
@@ -94,6 +97,7 @@ bool Faction::IsTrapVisible(Coordinate trapLocation) {
 void Faction::TrapSet(Coordinate trapLocation, bool visible) {
 	boost::unique_lock<boost::shared_mutex> writeLock(trapVisibleMutex);
 	trapVisible[trapLocation] = visible;
+	Map::Inst()->TileChanged(trapLocation);
 }
 
 FactionType Faction::StringToFactionType(std::string name) {
@@ -148,7 +152,8 @@ namespace {
 		TCODLine::init(p.X(), p.Y(), Camp::Inst()->Center().X(), Camp::Inst()->Center().Y());
 		do {
 			int constructionID = map->GetConstruction(p);
-			if (constructionID >= 0) {
+			//Only go for buildings someone in the faction has actually seen
+			if (constructionID >= 0 && map->visibility->FactionSees(npc->GetFaction(), p)) {
 				construction = Game::Inst()->GetConstruction(constructionID).lock();
 				if (construction && (construction->HasTag(PERMANENT) || 
 					(!construction->HasTag(WORKSHOP) && !construction->HasTag(WALL))))
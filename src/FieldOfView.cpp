@@ -0,0 +1,98 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include "FieldOfView.hpp"
+#include "Map.hpp"
+
+namespace {
+	//Transforms from octant space to map space
+	const int MULTIPLIERS[4][8] = {
+		{1, 0, 0, -1, -1, 0, 0, 1},
+		{0, 1, -1, 0, 0, -1, 1, 0},
+		{0, 1, 1, 0, 0, -1, -1, 0},
+		{1, 0, 0, 1, -1, 0, 0, -1}
+	};
+}
+
+FieldOfView::FieldOfView() : origin(undefined), radius(0), side(0), everything(false) {}
+
+void FieldOfView::Compute(Map* map, const Coordinate& center, int range, bool seeOverWalls) {
+	origin = center;
+	radius = range;
+	side = 2 * radius + 1;
+	everything = seeOverWalls;
+	if (everything) return;
+
+	visible.assign(side * side, false);
+	Mark(origin);
+	for (int octant = 0; octant < 8; ++octant) {
+		CastLight(map, 1, 1.0f, 0.0f, octant);
+	}
+}
+
+bool FieldOfView::Visible(const Coordinate& p) const {
+	int x = p.X() - origin.X() + radius, y = p.Y() - origin.Y() + radius;
+	if (origin == undefined || x < 0 || y < 0 || x >= side || y >= side) return false;
+	return everything || visible[y * side + x];
+}
+
+Coordinate FieldOfView::Origin() const { return origin; }
+int FieldOfView::Radius() const { return radius; }
+
+void FieldOfView::Mark(const Coordinate& p) {
+	visible[(p.Y() - origin.Y() + radius) * side + p.X() - origin.X() + radius] = true;
+}
+
+//Lights one octant row by row from the given row outwards, between the start and end slopes
+void FieldOfView::CastLight(Map* map, int row, float start, float end, int octant) {
+	if (start < end) return;
+	float newStart = 0.0f;
+	for (int distance = row; distance <= radius; ++distance) {
+		bool blocked = false;
+		int dy = -distance;
+		for (int dx = -distance; dx <= 0; ++dx) {
+			float leftSlope = (dx - 0.5f) / (dy + 0.5f);
+			float rightSlope = (dx + 0.5f) / (dy - 0.5f);
+			if (start < rightSlope) continue;
+			if (end > leftSlope) break;
+
+			Coordinate p(origin.X() + dx * MULTIPLIERS[0][octant] + dy * MULTIPLIERS[1][octant],
+				origin.Y() + dx * MULTIPLIERS[2][octant] + dy * MULTIPLIERS[3][octant]);
+			if (!map->IsInside(p)) continue;
+
+			bool opaque = map->BlocksLight(p);
+			/* Walls are seen if any part of them is lit, open tiles only if their centre is. That
+			keeps sight symmetric, a goblin that can see a tile can be seen from it */
+			float centreSlope = static_cast<float>(dx) / dy;
+			if (opaque || (centreSlope <= start && centreSlope >= end)) Mark(p);
+
+			if (blocked) {
+				if (opaque) {
+					newStart = rightSlope;
+				} else {
+					blocked = false;
+					start = newStart;
+				}
+			} else if (opaque && distance < radius) {
+				blocked = true;
+				CastLight(map, distance + 1, start, leftSlope, octant);
+				newStart = rightSlope;
+			}
+		}
+		if (blocked) break;
+	}
+}
@@ -190,9 +190,9 @@ void FireNode::Update() {
 			//Burn plantlife
 			int natureObject = Map::Inst()->GetNatureObject(pos);
 			if (natureObject >= 0 && 
-				!boost::iequals(Game::Inst()->natureList[natureObject]->Name(), "Scorched tree")) {
-					bool tree = Game::Inst()->natureList[natureObject]->Tree();
-					Game::Inst()->RemoveNatureObject(Game::Inst()->natureList[natureObject]);
+				!boost::iequals(Game::Inst()->natureList.Get(natureObject)->Name(), "Scorched tree")) {
+					bool tree = Game::Inst()->natureList.Get(natureObject)->Tree();
+					Game::Inst()->RemoveNatureObject(Game::Inst()->natureList.Get(natureObject));
 					if (tree && Random::Generate(4) == 0) {
 						Game::Inst()->CreateNatureObject(pos, "Scorched tree");
 					}
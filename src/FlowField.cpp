@@ -0,0 +1,179 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <boost/functional/hash.hpp>
+
+#include "FlowField.hpp"
+#include "Map.hpp"
+#include "NPC.hpp"
+
+namespace {
+	const float UNREACHABLE = std::numeric_limits<float>::max();
+	const float DIAGONAL_COST = 1.41f; //Same as TCODPath's default
+}
+
+const int FlowFieldCache::FIELD_RADIUS;
+const unsigned int FlowFieldCache::POPULARITY;
+const unsigned int FlowFieldCache::MAX_FIELDS;
+
+bool FlowFieldCache::Key::operator==(const Key& other) const {
+	return target == other.target && hands == other.hands && faction == other.faction;
+}
+
+std::size_t hash_value(const FlowFieldCache::Key& key) {
+	std::size_t seed = hash_value(key.target);
+	boost::hash_combine(seed, key.hands);
+	boost::hash_combine(seed, key.faction);
+	return seed;
+}
+
+FlowFieldCache::FlowFieldCache(Map* map) : map(map) {}
+
+bool FlowFieldCache::FindPath(const Coordinate& start, const Coordinate& goal, NPC* npc, std::vector<Coordinate>& path) {
+	Key key = { goal, npc->HasHands(), npc->GetFaction() };
+	boost::shared_ptr<Field> field;
+	{
+		boost::lock_guard<boost::mutex> lock(mutex);
+		boost::unordered_map<Key, boost::shared_ptr<Field> >::iterator fieldi = fields.find(key);
+		if (fieldi != fields.end()) {
+			field = fieldi->second;
+			++field->uses;
+		} else if (++requests[key] < POPULARITY) {
+			return false;
+		}
+	}
+
+	if (!field) {
+		//Built outside the lock, another worker might be doing the same but that only wastes a little time
+		field = Build(goal, npc);
+		if (!field) return false;
+
+		boost::lock_guard<boost::mutex> lock(mutex);
+		if (fields.size() >= MAX_FIELDS) {
+			boost::unordered_map<Key, boost::shared_ptr<Field> >::iterator leastUsed = fields.begin();
+			for (boost::unordered_map<Key, boost::shared_ptr<Field> >::iterator fieldi = fields.begin(); fieldi != fields.end(); ++fieldi) {
+				if (fieldi->second->uses < leastUsed->second->uses) leastUsed = fieldi;
+			}
+			fields.erase(leastUsed);
+		}
+		fields[key] = field;
+		requests.erase(key);
+	}
+
+	return Descend(*field, start, goal, npc, path);
+}
+
+void FlowFieldCache::TileChanged(const Coordinate& p) {
+	boost::lock_guard<boost::mutex> lock(mutex);
+	for (boost::unordered_map<Key, boost::shared_ptr<Field> >::iterator fieldi = fields.begin(); fieldi != fields.end();) {
+		/*The destination has to become popular again before the field is rebuilt, otherwise
+		a field next to flowing water would be recomputed on every tick*/
+		if (p.insideExtent(fieldi->second->origin, fieldi->second->extent)) fieldi = fields.erase(fieldi);
+		else ++fieldi;
+	}
+	//Don't let one-off destinations pile up forever
+	if (requests.size() > MAX_FIELDS * 32) requests.clear();
+}
+
+//Reverse Dijkstra from the target over the square around it, using the given NPC's walk costs
+boost::shared_ptr<FlowFieldCache::Field> FlowFieldCache::Build(const Coordinate& target, NPC* npc) const {
+	if (map->getWalkCost(target, target, npc) <= 0) return boost::shared_ptr<Field>();
+
+	boost::shared_ptr<Field> field(new Field());
+	Coordinate low = (target - FIELD_RADIUS).shrinkExtent(zero, map->Extent());
+	Coordinate high = (target + FIELD_RADIUS).shrinkExtent(zero, map->Extent());
+	field->origin = low;
+	field->extent = high - low + 1;
+	field->uses = 0;
+	int w = field->extent.X();
+	field->dist.assign(w * field->extent.Y(), UNREACHABLE);
+
+	typedef std::pair<float, int> OpenEntry;
+	std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry> > open;
+	Coordinate local = target - low;
+	field->dist[local.Y() * w + local.X()] = 0.0f;
+	open.push(OpenEntry(0.0f, local.Y() * w + local.X()));
+
+	while (!open.empty()) {
+		OpenEntry current = open.top();
+		open.pop();
+		if (current.first > field->dist[current.second]) continue;
+
+		Coordinate p = low + Coordinate(current.second % w, current.second / w);
+		float cost = map->getWalkCost(p, p, npc); //Whoever steps here from a neighbour pays for this tile
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				if (dx == 0 && dy == 0) continue;
+				Coordinate prev = p + Coordinate(dx, dy);
+				if (!prev.insideExtent(field->origin, field->extent)) continue;
+				if (map->getWalkCost(prev, prev, npc) <= 0) continue;
+				float dist = current.first + cost * (dx != 0 && dy != 0 ? DIAGONAL_COST : 1.0f);
+				int index = (prev.Y() - low.Y()) * w + prev.X() - low.X();
+				if (dist < field->dist[index]) {
+					field->dist[index] = dist;
+					open.push(OpenEntry(dist, index));
+				}
+			}
+		}
+	}
+	return field;
+}
+
+//Follows the field downhill from start, the path has the same form as TCODPath's (start excluded, goal included)
+bool FlowFieldCache::Descend(const Field& field, const Coordinate& start, const Coordinate& goal, NPC* npc, std::vector<Coordinate>& path) const {
+	if (!start.insideExtent(field.origin, field.extent)) return false;
+
+	path.clear();
+	Coordinate p = start;
+	float current = field.dist[(p.Y() - field.origin.Y()) * field.extent.X() + p.X() - field.origin.X()];
+	while (p != goal) {
+		Coordinate best = undefined;
+		float bestDist = UNREACHABLE;
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				if (dx == 0 && dy == 0) continue;
+				Coordinate next = p + Coordinate(dx, dy);
+				if (!next.insideExtent(field.origin, field.extent)) continue;
+				float dist = field.dist[(next.Y() - field.origin.Y()) * field.extent.X() + next.X() - field.origin.X()];
+				if (dist == UNREACHABLE) continue;
+				dist += map->getWalkCost(next, next, npc) * (dx != 0 && dy != 0 ? DIAGONAL_COST : 1.0f);
+				if (dist < bestDist) {
+					bestDist = dist;
+					best = next;
+				}
+			}
+		}
+		if (best == undefined) {
+			path.clear();
+			return false;
+		}
+		//Every step has to get strictly closer, anything else means the start isn't covered by the field
+		float next = field.dist[(best.Y() - field.origin.Y()) * field.extent.X() + best.X() - field.origin.X()];
+		if (next >= current) {
+			path.clear();
+			return false;
+		}
+		path.push_back(best);
+		p = best;
+		current = next;
+	}
+	return true;
+}
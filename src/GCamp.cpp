@@ -21,6 +21,8 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include <boost/lexical_cast.hpp>
 #include <boost/foreach.hpp>
 #include <cstdlib>
+#include <iostream>
+#include <sstream>
 #include <cmath>
 #include <algorithm>
 #include <functional>
@@ -47,6 +49,9 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include "Weather.hpp"
 #include "StockManager.hpp"
 #include "JobManager.hpp"
+#include "Pathfinder.hpp"
+#include "WorkerPool.hpp"
+#include "Profiler.hpp"
 
 #include "Version.hpp"
 
@@ -57,11 +62,16 @@ void SettingsMenu();
 void KeysMenu();
 void ModsMenu();
 void TilesetsMenu();
+int HeadlessLoop(int ticks, uint32_t seed, const std::string& save);
 
 namespace Globals {
 	bool noDumpMode;
 }
 
+namespace {
+	const int HEADLESS_TICKS = UPDATES_PER_SECOND * 60 * 10;
+}
+
 extern "C" void TCOD_sys_startup(void);
 
 int GCMain(std::vector<std::string>& args) {
@@ -75,6 +85,18 @@ int GCMain(std::vector<std::string>& args) {
 	Config::Init();
 	Script::Init(args);
 	
+	// libtcod can't do without a window, SDL's dummy video driver gives it one that isn't shown.
+	// This has to be decided before SDL starts up.
+	bool headless = std::find(args.begin(), args.end(), "-headless") != args.end();
+	if (headless) {
+		Game::Headless(true);
+		#ifdef WINDOWS
+		_putenv("SDL_VIDEODRIVER=dummy");
+		#else
+		setenv("SDL_VIDEODRIVER", "dummy", 1);
+		#endif
+	}
+	
 	//
 	// Load phase.
 	//
@@ -95,21 +117,39 @@ int GCMain(std::vector<std::string>& args) {
 	
 	bool bootTest = false;
 	Globals::noDumpMode = false;
+	int ticks = HEADLESS_TICKS;
+	uint32_t seed = 0;
+	std::string save;
 	
-	BOOST_FOREACH(std::string arg, args) {
-		if (arg == "-boottest") {
-			bootTest = true;
-		} else if (arg == "-dev") {
-			Game::Inst()->EnableDevMode();
-		} else if (arg == "-nodumps") {
-			Globals::noDumpMode = true;
+	for (size_t i = 0; i < args.size(); ++i) {
+		const std::string& arg = args[i];
+		bool hasValue = i + 1 < args.size();
+		
+		try {
+			if (arg == "-boottest") {
+				bootTest = true;
+			} else if (arg == "-dev") {
+				Game::Inst()->EnableDevMode();
+			} else if (arg == "-nodumps") {
+				Globals::noDumpMode = true;
+			} else if (arg == "-ticks" && hasValue) {
+				ticks = boost::lexical_cast<int>(args[++i]);
+			} else if (arg == "-seed" && hasValue) {
+				seed = boost::lexical_cast<uint32_t>(args[++i]);
+			} else if (arg == "-load" && hasValue) {
+				save = args[++i];
+			}
+		} catch (const boost::bad_lexical_cast&) {
+			LOG("Invalid value for " << arg << ": " << args[i]);
 		}
 	}
 	
-	if (!bootTest) {
-		exitcode = MainMenu();
-	} else {
+	if (bootTest) {
 		LOG("Bootstrap test, going into shutdown.");
+	} else if (headless) {
+		exitcode = HeadlessLoop(ticks, seed, save);
+	} else {
+		exitcode = MainMenu();
 	}
 	
 	//
@@ -126,7 +166,9 @@ int GCMain(std::vector<std::string>& args) {
 		delete Announce::Inst();
 		delete StockManager::Inst();
 		delete JobManager::Inst();
+		delete Pathfinder::Inst();
 		delete Map::Inst();
+		delete WorkerPool::Inst();
 	#endif
 	
 	return exitcode;
@@ -171,11 +213,11 @@ void MainLoop() {
 	Script::Event::GameEnd();
 }
 
-void StartNewGame() {
+void StartNewGame(uint32_t seed) {
 	Game::Reset();
 	Game* game = Game::Inst();
 
-	game->GenerateMap(time(0));
+	game->GenerateMap(seed);
 	game->SetSeason(EarlySpring);
 
 	std::priority_queue<std::pair<int, Coordinate> > spawnCenterCandidates;
@@ -215,7 +257,7 @@ void StartNewGame() {
 		for (int y = spawnTopCorner.Y(); y < spawnBottomCorner.Y(); ++y) {
 			Coordinate p(x,y);
 			if (Map::Inst()->GetNatureObject(p) >= 0 && Random::Generate(2) < 2) {
-				game->RemoveNatureObject(game->natureList[Map::Inst()->GetNatureObject(p)]);
+				game->RemoveNatureObject(game->natureList.Get(Map::Inst()->GetNatureObject(p)));
 			}
 		}
 	}
@@ -246,7 +288,7 @@ void StartNewGame() {
 		game->CreateItem(corpseLoc[c], Item::StringToItemType("stone axe"));
 		game->CreateItem(corpseLoc[c], Item::StringToItemType("shovel"));
 		int corpseuid = game->CreateItem(corpseLoc[c], Item::StringToItemType("corpse"));
-		boost::shared_ptr<Item> corpse = game->itemList[corpseuid];
+		boost::shared_ptr<Item> corpse = game->itemList.Get(corpseuid);
 		corpse->Name("Corpse(Human woodsman)");
 		corpse->Color(TCODColor::white);
 		for (int i = 0; i < 6; ++i)
@@ -264,6 +306,43 @@ void StartNewGame() {
 		Game::Inst()->events->SpawnBenignFauna();
 }
 
+/* Runs the simulation as fast as it goes, without drawing anything or waiting for input, and
+prints how long each part of the update took. Starts from the given save, or from a new game
+on the map generated from the seed. For benchmarks and soak tests. The seed doesn't make runs
+repeatable, pathfinding and the parallel part of the NPC updates still depend on thread timing */
+int HeadlessLoop(int ticks, uint32_t seed, const std::string& save) {
+	Game* game = Game::Inst();
+	if (seed == 0) seed = static_cast<uint32_t>(time(0));
+	Random::Init(seed);
+	
+	if (!save.empty()) {
+		if (!Data::LoadGame(save)) {
+			LOG("Headless: could not load " << save);
+			return 1;
+		}
+	} else {
+		Game::LoadingScreen(boost::bind(&StartNewGame, seed));
+		Script::Event::GameStart();
+	}
+	game->Running(true);
+	
+	LOG("Headless: running " << ticks << " ticks with seed " << seed);
+	Profiler::Inst()->Enable(true);
+	for (int tick = 0; tick < ticks; ++tick) {
+		game->Update();
+		Announce::Inst()->Update();
+	}
+	Profiler::Inst()->Enable(false);
+	
+	std::ostringstream report;
+	Profiler::Inst()->Report(report);
+	LOG("Headless: finished\n" << report.str());
+	std::cout << report.str();
+	
+	Script::Event::GameEnd();
+	return 0;
+}
+
 // XXX: This really needs serious refactoring.
 namespace {
 	struct MainMenuEntry {
@@ -290,7 +369,8 @@ namespace {
 }
 
 void ConfirmStartNewGame() {
-	boost::function<void(void)> run(boost::bind(&Game::LoadingScreen, &StartNewGame));
+	boost::function<void(void)> start(boost::bind(&StartNewGame, static_cast<uint32_t>(time(0))));
+	boost::function<void(void)> run(boost::bind(&Game::LoadingScreen, start));
 	
 	if (Game::Inst()->Running()) {
 		MessageBox::ShowMessageBox(
@@ -428,7 +508,7 @@ void LoadMenu() {
 
 	int width = 59; // 2 for borders, 20 for filename, 2 spacer, 20 for date, 2 spacer, 13 for filesize
 	int edgex = Game::Inst()->ScreenWidth()/2 - width/2;
-	int height = list.size() + 4;
+	int height = list.size() + 6; // 2 more for the summary of the hovered save
 	int edgey = Game::Inst()->ScreenHeight()/2 - height/2;
 	int selected = -1;
 
@@ -472,6 +552,12 @@ void LoadMenu() {
 		
 		TCODConsole::root->setDefaultForeground(TCODColor::white);
 		TCODConsole::root->setDefaultBackground(TCODColor::black);
+		
+		if (selected < static_cast<int>(list.size()) && selected >= 0) {
+			TCODConsole::root->setAlignment(TCOD_CENTER);
+			TCODConsole::root->print(edgex + (width / 2), edgey + height - 2, "%s", list[selected].summary.c_str());
+			TCODConsole::root->setAlignment(TCOD_LEFT);
+		}
 
 		TCODConsole::root->flush();
 
@@ -68,6 +68,13 @@ namespace py = boost::python;
 #include "tileRenderer/TileSetLoader.hpp"
 #include "tileRenderer/TileSetRenderer.hpp"
 #include "MathEx.hpp"
+#include "WaterChunks.hpp"
+#include "AIScheduler.hpp"
+#include "WorkerPool.hpp"
+#include "ItemIndex.hpp"
+#include "StockpileDirectory.hpp"
+#include "StockpileQueue.hpp"
+#include "Profiler.hpp"
 
 int Game::ItemTypeCount = 0;
 int Game::ItemCatCount = 0;
@@ -76,6 +83,7 @@ bool Game::initializedOnce = false;
 Game* Game::instance = 0;
 
 bool Game::devMode = false;
+bool Game::headless = false;
 
 Game::Game() :
 screenWidth(0),
@@ -243,6 +251,7 @@ ContinuePlaceStockpile:
 		Game::Inst()->dynamicConstructionList.insert(std::pair<int,boost::shared_ptr<Construction> >(newSp->Uid(),static_cast<boost::shared_ptr<Construction> >(newSp)));
 	} else {
 		Game::Inst()->staticConstructionList.insert(std::pair<int,boost::shared_ptr<Construction> >(newSp->Uid(),static_cast<boost::shared_ptr<Construction> >(newSp)));
+		StockpileDirectory::Inst()->Add(newSp);
 	}
 
 	Game::Inst()->RefreshStockpiles();
@@ -386,17 +395,17 @@ int Game::CreateNPC(Coordinate target, NPCType type) {
 			if (categories.find(Item::StringToItemCategory("weapon")) != categories.end()
 				&& !npc->Wielding().lock()) {
 					int itemUid = CreateItem(npc->Position(), itemType, false, npc->GetFaction(), std::vector<boost::weak_ptr<Item> >(), npc->inventory);
-					boost::shared_ptr<Item> item = itemList[itemUid];
+					boost::shared_ptr<Item> item = itemList.Get(itemUid);
 					npc->mainHand = item;
 			} else if (categories.find(Item::StringToItemCategory("armor")) != categories.end()
 				&& !npc->Wearing().lock()) {
 					int itemUid = CreateItem(npc->Position(), itemType, false, npc->GetFaction(), std::vector<boost::weak_ptr<Item> >(), npc->inventory);
-					boost::shared_ptr<Item> item = itemList[itemUid];
+					boost::shared_ptr<Item> item = itemList.Get(itemUid);
 					npc->armor = item;
 			} else if (categories.find(Item::StringToItemCategory("quiver")) != categories.end()
 				&& !npc->quiver.lock()) {
 					int itemUid = CreateItem(npc->Position(), itemType, false, npc->GetFaction(), std::vector<boost::weak_ptr<Item> >(), npc->inventory);
-					boost::shared_ptr<Item> item = itemList[itemUid];
+					boost::shared_ptr<Item> item = itemList.Get(itemUid);
 					npc->quiver = boost::static_pointer_cast<Container>(item); //Quivers = containers
 			} else if (categories.find(Item::StringToItemCategory("ammunition")) != categories.end()
 				&& npc->quiver.lock() && npc->quiver.lock()->empty()) {
@@ -423,17 +432,8 @@ void Game::GoblinCount(int add) { goblinCount += add; }
 
 //Moves the entity to a valid walkable tile
 void Game::BumpEntity(int uid) {
-	boost::shared_ptr<Entity> entity;
-
-	std::map<int,boost::shared_ptr<NPC> >::iterator npc = npcList.find(uid);
-	if (npc != npcList.end()) {
-		entity = npc->second;
-	} else {
-		std::map<int,boost::shared_ptr<Item> >::iterator item = itemList.find(uid);
-		if (item != itemList.end()) {
-			entity = item->second;
-		}
-	}
+	boost::shared_ptr<Entity> entity = npcList.Get(uid);
+	if (!entity) entity = itemList.Get(uid);
 
 	if (entity) {
 		if (!Map::Inst()->IsWalkable(entity->Position())) {
@@ -515,6 +515,11 @@ void Game::ProgressScreen(boost::function<void(void)> blockingCall, bool isLoadi
 	// locking Game::loadingScreenMutex first!
 	//
 	// XXX heavily experimental
+	if (headless) {
+		blockingCall();
+		return;
+	}
+	
 	boost::promise<void> promise;
 	boost::unique_future<void> future(promise.get_future());
 	
@@ -544,6 +549,8 @@ void Game::ProgressScreen(boost::function<void(void)> blockingCall, bool isLoadi
 }
 
 void Game::ErrorScreen() {
+	if (headless) exit(255); //Nobody to press a key
+	
 	boost::lock_guard<boost::mutex> lock(loadingScreenMutex);
 	
 	Game *game = Game::Inst();
@@ -583,6 +590,11 @@ void Game::Init(bool firstTime) {
 
 	//Enabling TCOD_RENDERER_GLSL can cause GCamp to crash on exit, apparently it's because of an ATI driver issue.
 	TCOD_renderer_t renderer_type = static_cast<TCOD_renderer_t>(Config::GetCVar<int>("renderer"));
+	//SDL's dummy video driver has no OpenGL
+	if (headless) {
+		renderer_type = TCOD_RENDERER_SDL;
+		fullscreen = false;
+	}
 	if (firstTime) TCODConsole::initRoot(screenWidth, screenHeight, "Goblin Camp", fullscreen, renderer_type);
 	TCODMouse::showCursor(true);
 //	TCODConsole::setKeyboardRepeat(500, 10);
@@ -655,11 +667,9 @@ void Game::DismantleConstruction(Coordinate a, Coordinate b) {
 }
 
 boost::weak_ptr<Construction> Game::GetConstruction(int uid) {
-	if (staticConstructionList.find(uid) != staticConstructionList.end()) 
-		return staticConstructionList[uid];
-	else if (dynamicConstructionList.find(uid) != dynamicConstructionList.end())
-		return dynamicConstructionList[uid];
-	return boost::weak_ptr<Construction>();
+	if (const boost::shared_ptr<Construction>& construction = staticConstructionList.Get(uid))
+		return construction;
+	return dynamicConstructionList.Get(uid);
 }
 
 int Game::CreateItem(Coordinate pos, ItemType type, bool store, int ownerFaction, 
@@ -688,6 +698,7 @@ int Game::CreateItem(Coordinate pos, ItemType type, bool store, int ownerFaction
 				if ( newItem != 0 ) { // No null pointers in freeItems please..
 					freeItems.insert(newItem);
 					Map::Inst()->ItemList(newItem->Position())->insert(newItem->Uid());
+					StockpileQueue::Inst()->Push(newItem);
 				} else {
 					return -1;
 				}
@@ -732,14 +743,14 @@ void Game::RemoveItem(boost::weak_ptr<Item> witem) {
 }
 
 boost::weak_ptr<Item> Game::GetItem(int uid) {
-	if (itemList.find(uid) != itemList.end()) return itemList[uid];
-	return boost::weak_ptr<Item>();
+	return itemList.Get(uid);
 }
 
 void Game::ItemContained(boost::weak_ptr<Item> item, bool con) {
 	if (!con) {
 		freeItems.insert(item);
 		Map::Inst()->ItemList(item.lock()->Position())->insert(item.lock()->Uid());
+		StockpileQueue::Inst()->Push(item.lock());
 	}
 	else {
 		freeItems.erase(item);
@@ -788,47 +799,15 @@ void Game::CreateWaterFromNode(boost::shared_ptr<WaterNode> water) {
 }
 
 int Game::DistanceNPCToCoordinate(int uid, Coordinate pos) {
-	return Distance(npcList[uid]->Position(), pos);
+	return Distance(npcList.Get(uid)->Position(), pos);
 }
 
-// TODO this currently checks every stockpile.  We could maintain some data structure that allowed us to check the closest stockpile(s)
-// first.
 boost::weak_ptr<Item> Game::FindItemByCategoryFromStockpiles(ItemCategory category, Coordinate target, int flags, int value) {
-	int nearestDistance = std::numeric_limits<int>::max();
-	boost::weak_ptr<Item> nearest = boost::weak_ptr<Item>();
-	for (std::map<int, boost::shared_ptr<Construction> >::iterator consIter = staticConstructionList.begin(); consIter != staticConstructionList.end(); ++consIter) {
-		if (consIter->second->stockpile && !consIter->second->farmplot) {
-			boost::weak_ptr<Item> item(boost::static_pointer_cast<Stockpile>(consIter->second)->FindItemByCategory(category, flags, value));
-			if (item.lock() && !item.lock()->Reserved()) {
-				int distance = (flags & MOSTDECAYED ? item.lock()->GetDecay() : Distance(item.lock()->Position(), target));
-				if(distance < nearestDistance) {
-					nearestDistance = distance;
-					nearest = item;
-				}
-			}
-		}
-	}
-	return nearest;
+	return ItemIndex::Inst()->FindByCategory(category, target, flags, value);
 }
 
-// TODO this currently checks every stockpile.  We could maintain some data structure that allowed us to check the closest stockpile(s)
-// first.
 boost::weak_ptr<Item> Game::FindItemByTypeFromStockpiles(ItemType type, Coordinate target, int flags, int value) {
-	int nearestDistance = std::numeric_limits<int>::max();
-	boost::weak_ptr<Item> nearest = boost::weak_ptr<Item>();
-	for (std::map<int, boost::shared_ptr<Construction> >::iterator consIter = staticConstructionList.begin(); consIter != staticConstructionList.end(); ++consIter) {
-		if (consIter->second->stockpile && !consIter->second->farmplot) {
-			boost::weak_ptr<Item> item(boost::static_pointer_cast<Stockpile>(consIter->second)->FindItemByType(type, flags, value));
-			if (item.lock() && !item.lock()->Reserved()) {
-				int distance = (flags & MOSTDECAYED ? item.lock()->GetDecay() : Distance(item.lock()->Position(), target));
-				if(distance < nearestDistance) {
-					nearestDistance = distance;
-					nearest = item;
-				}
-			}
-		}
-	}
-	return nearest;
+	return ItemIndex::Inst()->FindByType(type, target, flags, value);
 }
 
 // Spawns items distributed randomly within the rectangle defined by corner1 & corner2
@@ -903,7 +882,30 @@ Coordinate Game::FindWater(Coordinate pos) {
 	return closest;
 }
 
+namespace {
+	void AutosaveDone(bool success) {
+		if (success)
+			Announce::Inst()->AddMsg("Autosaved");
+		else
+			Announce::Inst()->AddMsg("Failed to autosave! Refer to the logfile", TCODColor::red);
+	}
+
+	const unsigned int PARALLEL_NPC_THRESHOLD = 64; //Below this it's not worth waking up the workers
+	const unsigned int PARTS_PER_THREAD = 4;
+
+	//Each part is a contiguous run of NPCs, so reading the buffers in order keeps the commands in NPC order
+	void UpdateNPCStates(const std::vector<NPC*>& npcs, std::vector<std::vector<NPCCommand> >& commands, unsigned int part) {
+		size_t begin = npcs.size() * part / commands.size();
+		size_t end = npcs.size() * (part + 1) / commands.size();
+		for (size_t i = begin; i < end; ++i) {
+			npcs[i]->UpdateState(commands[part]);
+		}
+	}
+}
+
 void Game::Update() {
+	Profiler* profiler = Profiler::Inst();
+	profiler->StartTick();
 	++time;
 
 	if (time >= MONTH_LENGTH) {
@@ -912,9 +914,9 @@ void Game::Update() {
 
 		if (safeMonths > 0) --safeMonths;
 
-		for (std::map<int, boost::shared_ptr<Construction> >::iterator cons = staticConstructionList.begin();
+		for (EntityMap<Construction>::iterator cons = staticConstructionList.begin();
 			cons != staticConstructionList.end(); ++cons) { cons->second->SpawnRepairJob(); }
-		for (std::map<int, boost::shared_ptr<Construction> >::iterator cons = dynamicConstructionList.begin();
+		for (EntityMap<Construction>::iterator cons = dynamicConstructionList.begin();
 			cons != dynamicConstructionList.end(); ++cons) { cons->second->SpawnRepairJob(); }
 
 		if (season < LateWinter) season = (Season)((int)season + 1);
@@ -924,12 +926,9 @@ void Game::Update() {
 		case EarlySpring:
 			Announce::Inst()->AddMsg("Spring has begun");
 			++age;
-			if (Config::GetCVar<bool>("autosave")) {
+			if (Config::GetCVar<bool>("autosave") && !headless) {
 				std::string saveName = "autosave" + std::string(age % 2 ? "1" : "2");
-				if (Data::SaveGame(saveName, false))
-					Announce::Inst()->AddMsg("Autosaved");
-				else
-					Announce::Inst()->AddMsg("Failed to autosave! Refer to the logfile", TCODColor::red);
+				Data::SaveGameInBackground(saveName, Config::GetCVar<bool>("journalAutosaves"), &AutosaveDone);
 			}
 		case Spring:
 		case LateSpring:
@@ -963,23 +962,18 @@ void Game::Update() {
 		default: break;
 		}
 	}
+	profiler->Lap("calendar");
 
-	//This actually only updates every 50th waternode. This is due to 2 things: updating one water tile actually also
-	//updates all its neighbours. Also, by updating only every 50th one, the load on the cpu is less, but you need to
-	//remember that Update gets called 25 times a second, and given the nature of rand() this means that each waternode
-	//will be updated once every 2 seconds. It turns out that from the player's viewpoint this is just fine
-	
-	// nextWati removed because list<> complained about invalidated iterators -pl
-	for (auto watIt = waterList.begin(); watIt != waterList.end(); ) {
-		if (auto water = watIt->lock()) {
-			if (Random::Generate(49) == 0 && water->Update()) {
-				RemoveWater(water->Position(), false);
-				watIt = waterList.erase(watIt);
-			} else {
-				++watIt;
-			}
-		} else {
-			watIt = waterList.erase(watIt);
+	//Each waternode that's still moving gets updated once every 2 seconds, a chunk of the map at a time.
+	//Updating one water tile actually also updates all its neighbours, so from the player's viewpoint this
+	//is just fine. Settled water isn't updated until something changes next to it, see WaterChunks
+	Map::Inst()->waterChunks->Update();
+
+	//Dried up water is only taken off the map, clear it out of the list every now and then
+	if (time % (UPDATES_PER_SECOND * 10) == 0) {
+		for (std::list<boost::weak_ptr<WaterNode> >::iterator wati = waterList.begin(); wati != waterList.end();) {
+			if (!wati->lock()) wati = waterList.erase(wati);
+			else ++wati;
 		}
 	}
 	
@@ -997,28 +991,63 @@ void Game::Update() {
 			wati = nextwati;
 		}
 	}
+	profiler->Lap("water");
 	
-	std::list<boost::weak_ptr<NPC> > npcsWaitingForRemoval;
-	for (std::map<int,boost::shared_ptr<NPC> >::iterator npci = npcList.begin(); npci != npcList.end(); ++npci) {
+	timers.Advance();
+	profiler->Lap("timers");
+
+	//What the NPCs do to themselves is worked out in parallel, what that does to everything else is applied after
+	npcSnapshot.clear();
+	for (EntityMap<NPC>::iterator npci = npcList.begin(); npci != npcList.end(); ++npci) {
+		npcSnapshot.push_back(npci->second.get());
+	}
+	npcCommands.resize(npcSnapshot.size() < PARALLEL_NPC_THRESHOLD ? 1 : WorkerPool::Inst()->Threads() * PARTS_PER_THREAD);
+	WorkerPool::Inst()->Run(boost::bind(UpdateNPCStates, boost::cref(npcSnapshot), boost::ref(npcCommands), _1), npcCommands.size());
+	for (size_t part = 0; part < npcCommands.size(); ++part) {
+		for (std::vector<NPCCommand>::iterator commandi = npcCommands[part].begin(); commandi != npcCommands[part].end(); ++commandi) {
+			commandi->npc->Apply(*commandi);
+		}
+		npcCommands[part].clear();
+	}
+	profiler->Lap("npc states");
+
+	//Everyone moves every tick, the decisions are left to the AIScheduler
+	for (EntityMap<NPC>::iterator npci = npcList.begin(); npci != npcList.end(); ++npci) {
 		npci->second->Update();
-		if (!npci->second->Dead()) npci->second->Think();
+		if (!npci->second->Dead()) {
+			npci->second->Think();
+			if (npci->second->DecisionPending()) AIScheduler::Inst()->Schedule(npci->second);
+		}
+	}
+	profiler->Lap("npcs");
+	AIScheduler::Inst()->Run();
+	profiler->Lap("ai");
+
+	std::list<boost::weak_ptr<NPC> > npcsWaitingForRemoval;
+	for (EntityMap<NPC>::iterator npci = npcList.begin(); npci != npcList.end(); ++npci) {
 		if (npci->second->Dead() || npci->second->Escaped()) npcsWaitingForRemoval.push_back(npci->second);
 	}
+	profiler->Lap("npc removal");
 	JobManager::Inst()->AssignJobs();
+	profiler->Lap("job assignment");
 	
 	for (std::list<boost::weak_ptr<NPC> >::iterator remNpci = npcsWaitingForRemoval.begin(); remNpci != npcsWaitingForRemoval.end(); ++remNpci) {
 		RemoveNPC(*remNpci);
 	}
+	profiler->Lap("npc removal");
 	
-	for (std::map<int,boost::shared_ptr<Construction> >::iterator consi = dynamicConstructionList.begin(); consi != dynamicConstructionList.end(); ++consi) {
+	for (EntityMap<Construction>::iterator consi = dynamicConstructionList.begin(); consi != dynamicConstructionList.end(); ++consi) {
 		consi->second->Update();
 	}
+	profiler->Lap("constructions");
 
 	for (std::list<boost::weak_ptr<Item> >::iterator itemi = stoppedItems.begin(); itemi != stoppedItems.end();) {
 		flyingItems.erase(*itemi);
 		if (boost::shared_ptr<Item> item = itemi->lock()) {
 			if (item->condition == 0) { //The impact has destroyed the item
 				RemoveItem(item);
+			} else if (!item->ContainedIn().lock()) {
+				StockpileQueue::Inst()->Push(item);
 			}
 		}
 		itemi = stoppedItems.erase(itemi);
@@ -1027,29 +1056,15 @@ void Game::Update() {
 	for (std::set<boost::weak_ptr<Item> >::iterator itemi = flyingItems.begin(); itemi != flyingItems.end(); ++itemi) {
 		if (boost::shared_ptr<Item> item = itemi->lock()) item->UpdateVelocity();
 	}
+	profiler->Lap("items");
 
-	/*Constantly checking our free item list for items that can be stockpiled is overkill, so it's done once every
-	5 seconds, on average, or immediately if a new stockpile is built or a stockpile's allowed items are changed.
-	To further reduce load when very many free items exist, only a quarter of them will be checked*/
-	if (Random::Generate(UPDATES_PER_SECOND * 5 - 1) == 0 || refreshStockpiles) {
+	//A new stockpile or changed allowed items might take anything that's waiting
+	if (refreshStockpiles) {
 		refreshStockpiles = false;
-		if (freeItems.size() < 100) {
-			for (std::set<boost::weak_ptr<Item> >::iterator itemi = freeItems.begin(); itemi != freeItems.end(); ++itemi) {
-				if (boost::shared_ptr<Item> item = itemi->lock()) {
-					if (!item->Reserved() && item->GetFaction() == PLAYERFACTION && item->GetVelocity() == 0) 
-						StockpileItem(item);
-				}
-			}
-		} else {
-			for (size_t i = 0; i < std::max(static_cast<size_t>(100), freeItems.size()/4); ++i) {
-				std::set<boost::weak_ptr<Item> >::iterator itemi = boost::next(freeItems.begin(), Random::ChooseIndex(freeItems));
-				if (boost::shared_ptr<Item> item = itemi->lock()) {
-					if (!item->Reserved() && item->GetFaction() == PLAYERFACTION && item->GetVelocity() == 0) 
-						StockpileItem(item);
-				}
-			}
-		}
+		StockpileQueue::Inst()->WakeAll();
 	}
+	StockpileQueue::Inst()->Update();
+	profiler->Lap("stockpiling");
 
 	//Squads needen't update their member rosters ALL THE TIME
 	if (time % (UPDATES_PER_SECOND * 1) == 0) {
@@ -1057,34 +1072,33 @@ void Game::Update() {
 			squadi->second->UpdateMembers();
 		}
 	}
+	profiler->Lap("squads");
 
 	if (time % (UPDATES_PER_SECOND * 1) == 0) StockManager::Inst()->Update();
+	profiler->Lap("stock");
 
 	if (time % (UPDATES_PER_SECOND * 1) == 0) JobManager::Inst()->Update();
+	profiler->Lap("jobs");
 
 	events->Update(safeMonths > 0);
+	profiler->Lap("events");
 
 	Map::Inst()->Update();
+	profiler->Lap("map");
 
 	if (time % (UPDATES_PER_SECOND * 1) == 0) Camp::Inst()->Update();
 
-	for (std::list<std::pair<int, boost::function<void()> > >::iterator delit = delays.begin(); delit != delays.end();) {
-		if (--delit->first <= 0) {
-			try {
-				delit->second();
-			} catch (const py::error_already_set&) {
-				Script::LogException();
-			}
-			delit = delays.erase(delit);
-		} else ++delit;
-	}
-
 	if (!gameOver && orcCount == 0 && goblinCount == 0) {
 		gameOver = true;
-		//Game over, display stats
-		DisplayStats();
-		MessageBox::ShowMessageBox("Do you wish to keep watching?", NULL, "Keep watching", boost::bind(&Game::GameOver, Game::Inst()), "Quit");
+		if (headless) {
+			LOG("Game over in year " << age << ", the simulation keeps running");
+		} else {
+			//Game over, display stats
+			DisplayStats();
+			MessageBox::ShowMessageBox("Do you wish to keep watching?", NULL, "Keep watching", boost::bind(&Game::GameOver, Game::Inst()), "Quit");
+		}
 	}
+	profiler->Lap("camp");
 
 	for (std::list<boost::weak_ptr<FireNode> >::iterator fireit = fireList.begin(); fireit != fireList.end();) {
 		if (boost::shared_ptr<FireNode> fire = fireit->lock()) {
@@ -1097,6 +1111,7 @@ void Game::Update() {
 			fireit = fireList.erase(fireit);
 		}
 	}
+	profiler->Lap("fire");
 
 	for (std::list<boost::shared_ptr<Spell> >::iterator spellit = spellList.begin(); spellit != spellList.end();) {
 		if ((*spellit)->IsDead()) {
@@ -1107,17 +1122,17 @@ void Game::Update() {
 		}
 	}
 
+	profiler->Lap("spells");
+
 	for (size_t i = 1; i < Faction::factions.size(); ++i) {
 		Faction::factions[i]->Update();
 	}
+	profiler->Lap("factions");
 }
 
 boost::shared_ptr<Job> Game::StockpileItem(boost::weak_ptr<Item> witem, bool returnJob, bool disregardTerritory, bool reserveItem) {
 	if (boost::shared_ptr<Item> item = witem.lock()) {
 		if ((!reserveItem || !item->Reserved()) && item->GetFaction() == PLAYERFACTION) {
-			boost::shared_ptr<Stockpile> nearest = boost::shared_ptr<Stockpile>();
-			//first = primary distance, second = secondary
-			std::pair<int, int> nearestDistance = std::make_pair(std::numeric_limits<int>::max(), std::numeric_limits<int>::max());
 			ItemType itemType = item->Type();
 			bool useDemand = false;
 
@@ -1130,33 +1145,10 @@ boost::shared_ptr<Job> Game::StockpileItem(boost::weak_ptr<Item> witem, bool ret
 				}
 			} else if (containerItem) useDemand = true; //Empty containers are stored based on demand
 
-			for (std::map<int,boost::shared_ptr<Construction> >::iterator stocki = staticConstructionList.begin(); stocki != staticConstructionList.end(); ++stocki) {
-				if (stocki->second->stockpile) {
-					boost::shared_ptr<Stockpile> sp(boost::static_pointer_cast<Stockpile>(stocki->second));
-					if (sp->Allowed(Item::Presets[itemType].specificCategories) && !sp->Full(itemType)) {
-
-						//Found a stockpile that both allows the item, and has space
-						//Assuming that containers only have one specific category
-						ItemCategory category = *Item::Presets[item->Type()].specificCategories.begin();
-						int distance = useDemand
-							? (std::numeric_limits<int>::max() - 2) - sp->GetDemand(category)
-							: Distance(sp->Center(), item->Position());
-
-						if (distance < nearestDistance.first) {
-							nearestDistance.first = distance;
-							nearest = sp;
-							if (useDemand) nearestDistance.second = Distance(sp->Center(), item->Position());
-						} else if (useDemand && distance == nearestDistance.first) {
-							int realDistance = Distance(sp->Center(), item->Position());
-							if (nearestDistance.second > realDistance) {
-								nearestDistance.first = distance;
-								nearest = sp;
-								nearestDistance.second = realDistance;
-							}
-						}
-					}
-				}
-			}
+			//Assuming that containers only have one specific category
+			boost::shared_ptr<Stockpile> nearest = useDemand
+				? StockpileDirectory::Inst()->FindByDemand(itemType, *Item::Presets[item->Type()].specificCategories.begin(), item->Position())
+				: StockpileDirectory::Inst()->FindNearest(itemType, item->Position());
 
 			if(nearest) {
 				JobPriority priority;
@@ -1257,7 +1249,7 @@ void Game::FlipBuffer() {
 Season Game::CurrentSeason() { return season; }
 
 void Game::SpawnTillageJobs() {
-	for (std::map<int,boost::shared_ptr<Construction> >::iterator consi = dynamicConstructionList.begin(); consi != dynamicConstructionList.end(); ++consi) {
+	for (EntityMap<Construction>::iterator consi = dynamicConstructionList.begin(); consi != dynamicConstructionList.end(); ++consi) {
 		if (consi->second->farmplot) {
 			boost::shared_ptr<Job> tillJob(new Job("Till farmplot"));
 			tillJob->tasks.push_back(Task(MOVE, consi->second->Position()));
@@ -1268,7 +1260,7 @@ void Game::SpawnTillageJobs() {
 }
 
 void Game::DeTillFarmPlots() {
-	for (std::map<int,boost::shared_ptr<Construction> >::iterator consi = dynamicConstructionList.begin(); consi != dynamicConstructionList.end(); ++consi) {
+	for (EntityMap<Construction>::iterator consi = dynamicConstructionList.begin(); consi != dynamicConstructionList.end(); ++consi) {
 		if (consi->second->farmplot) {
 			boost::static_pointer_cast<FarmPlot>(consi->second)->tilled = false;
 		}
@@ -1451,7 +1443,7 @@ void Game::FellTree(Coordinate a, Coordinate b) {
 		for (int y = a.Y(); y <= b.Y(); ++y) {
 			int natUid = Map::Inst()->GetNatureObject(Coordinate(x,y));
 			if (natUid >= 0) {
-				boost::shared_ptr<NatureObject> natObj = Game::Inst()->natureList[natUid];
+				boost::shared_ptr<NatureObject> natObj = Game::Inst()->natureList.Get(natUid);
 				if (natObj && natObj->Tree() && !natObj->Marked()) {
 					natObj->Mark();
 					boost::shared_ptr<Job> fellJob(new Job("Fell tree", MED, 0, true));
@@ -1473,7 +1465,7 @@ void Game::DesignateTree(Coordinate a, Coordinate b) {
 		for (int y = a.Y(); y <= b.Y(); ++y) {
 			int natUid = Map::Inst()->GetNatureObject(Coordinate(x,y));
 			if (natUid >= 0) {
-				boost::shared_ptr<NatureObject> natObj = Game::Inst()->natureList[natUid];
+				boost::shared_ptr<NatureObject> natObj = Game::Inst()->natureList.Get(natUid);
 				if (natObj && natObj->Tree() && !natObj->Marked()) {
 					//TODO: Implement proper map marker system and change this to use that
 					natObj->Mark();
@@ -1489,7 +1481,7 @@ void Game::HarvestWildPlant(Coordinate a, Coordinate b) {
 		for (int y = a.Y(); y <= b.Y(); ++y) {
 			int natUid = Map::Inst()->GetNatureObject(Coordinate(x,y));
 			if (natUid >= 0) {
-				boost::shared_ptr<NatureObject> natObj = Game::Inst()->natureList[natUid];
+				boost::shared_ptr<NatureObject> natObj = Game::Inst()->natureList.Get(natUid);
 				if (natObj && natObj->Harvestable() && !natObj->Marked()) {
 					natObj->Mark();
 					boost::shared_ptr<Job> harvestJob(new Job("Harvest wild plant"));
@@ -1541,7 +1533,7 @@ void Game::Undesignate(Coordinate a, Coordinate b) {
 			Coordinate p(x,y);
 			int natUid = Map::Inst()->GetNatureObject(p);
 			if (natUid >= 0) {
-				boost::weak_ptr<NatureObject> natObj = Game::Inst()->natureList[natUid];
+				boost::weak_ptr<NatureObject> natObj = Game::Inst()->natureList.Get(natUid);
 				if (natObj.lock() && natObj.lock()->Tree() && natObj.lock()->Marked()) {
 					//TODO: Implement proper map marker system and change this to use that
 					natObj.lock()->Unmark();
@@ -1587,9 +1579,10 @@ std::string Game::SeasonToString(Season season) {
 }
 
 void Game::DecayItems() {
+	ItemIndex::Inst()->DecayPassed();
 	std::list<int> eraseList;
 	std::list<std::pair<ItemType, Coordinate> > creationList;
-	for (std::map<int,boost::shared_ptr<Item> >::iterator itemit = itemList.begin(); itemit != itemList.end(); ) {
+	for (EntityMap<Item>::iterator itemit = itemList.begin(); itemit != itemList.end(); ) {
 
 		if (itemit->second == 0) { // Now, how did we get a null pointer in here..
 			itemit = itemList.erase(itemit); // Get it out of the list!
@@ -1870,7 +1863,7 @@ void Game::RemoveNPC(boost::weak_ptr<NPC> wnpc) {
 int Game::FindMilitaryRecruit() {
 	// Holder for orc with most/full health
 	boost::shared_ptr<NPC> strongest;
-	for (std::map<int, boost::shared_ptr<NPC> >::iterator npci = npcList.begin(); npci != npcList.end(); ++npci) {
+	for (EntityMap<NPC>::iterator npci = npcList.begin(); npci != npcList.end(); ++npci) {
 		if (npci->second->type == NPC::StringToNPCType("orc") && npci->second->faction == PLAYERFACTION ) {
 			// Find the orc with the most/full health to prevent near-dead orcs from getting put in the squad
 			if (!npci->second->squad.lock() && ( !strongest || npci->second->health > strongest->health )) {
@@ -1898,9 +1891,9 @@ void Game::SetSquadTargetEntity(Order order, Coordinate target, boost::shared_pt
 		std::set<int> *npcList = Map::Inst()->NPCList(target);
 		if (!npcList->empty()) {
 			squad->AddOrder(order);
-			squad->AddTargetEntity(Game::Inst()->npcList[*npcList->begin()]);
+			squad->AddTargetEntity(Game::Inst()->npcList.Get(*npcList->begin()));
 			UI::Inst()->CloseMenu();
-			Announce::Inst()->AddMsg((boost::format("[%1%] following %2%") % squad->Name() % Game::Inst()->npcList[*npcList->begin()]->Name()).str(), TCODColor::white, target);
+			Announce::Inst()->AddMsg((boost::format("[%1%] following %2%") % squad->Name() % Game::Inst()->npcList.Get(*npcList->begin())->Name()).str(), TCODColor::white, target);
 		}
 	}
 }
@@ -1921,6 +1914,8 @@ int Game::DiceToInt(TCOD_dice_t dice) {
 
 void Game::ToMainMenu(bool value) { Game::Inst()->toMainMenu = value; }
 bool Game::ToMainMenu() { return Game::Inst()->toMainMenu; }
+void Game::Headless(bool value) { headless = value; }
+bool Game::Headless() { return headless; }
 
 void Game::Running(bool value) { running = value; }
 bool Game::Running() { return running; }
@@ -1930,7 +1925,7 @@ boost::weak_ptr<Construction> Game::FindConstructionByTag(ConstructionTag tag, C
 	int distance = -1;
 	boost::weak_ptr<Construction> foundConstruct;
 
-	for (std::map<int, boost::shared_ptr<Construction> >::iterator stati = staticConstructionList.begin();
+	for (EntityMap<Construction>::iterator stati = staticConstructionList.begin();
 		stati != staticConstructionList.end(); ++stati) {
 			if (!stati->second->Reserved() && stati->second->HasTag(tag)) {
 				if (closeTo.X() == -1)
@@ -1947,7 +1942,7 @@ boost::weak_ptr<Construction> Game::FindConstructionByTag(ConstructionTag tag, C
 
 	if (foundConstruct.lock()) return foundConstruct;
 
-	for (std::map<int, boost::shared_ptr<Construction> >::iterator dynai = dynamicConstructionList.begin();
+	for (EntityMap<Construction>::iterator dynai = dynamicConstructionList.begin();
 		dynai != dynamicConstructionList.end(); ++dynai) {
 			if (!dynai->second->Reserved() && dynai->second->HasTag(tag)) {
 				if (closeTo.X() == -1)
@@ -1980,7 +1975,11 @@ void Game::Reset() {
 
 	Map::Reset();
 	JobManager::Reset();
+	AIScheduler::Reset();
 	StockManager::Reset();
+	ItemIndex::Reset();
+	StockpileDirectory::Reset();
+	StockpileQueue::Reset();
 	Announce::Reset();
 	Camp::Reset();
 	for (size_t i = 0; i < Faction::factions.size(); ++i) {
@@ -2036,18 +2035,19 @@ void Game::ReturnToMark(int i) {
 }
 
 void Game::TranslateContainerListeners() {
-	for (std::map<int,boost::shared_ptr<Item> >::iterator it = itemList.begin(); it != itemList.end(); ++it) {
+	for (EntityMap<Item>::iterator it = itemList.begin(); it != itemList.end(); ++it) {
 		if (boost::dynamic_pointer_cast<Container>(it->second)) {
 			boost::static_pointer_cast<Container>(it->second)->TranslateContainerListeners();
 		}
 	}
-	for (std::map<int, boost::shared_ptr<Construction> >::iterator it = staticConstructionList.begin(); 
+	for (EntityMap<Construction>::iterator it = staticConstructionList.begin(); 
 		it != staticConstructionList.end(); ++it) {
 			if (boost::dynamic_pointer_cast<Stockpile>(it->second)) {
 				boost::static_pointer_cast<Stockpile>(it->second)->TranslateInternalContainerListeners();
+				StockpileDirectory::Inst()->Add(boost::static_pointer_cast<Stockpile>(it->second));
 			}
 	}
-	for (std::map<int, boost::shared_ptr<Construction> >::iterator it = dynamicConstructionList.begin(); 
+	for (EntityMap<Construction>::iterator it = dynamicConstructionList.begin(); 
 		it != dynamicConstructionList.end(); ++it) {
 			if (boost::dynamic_pointer_cast<Stockpile>(it->second)) {
 				boost::static_pointer_cast<Stockpile>(it->second)->TranslateInternalContainerListeners();
@@ -2250,14 +2250,39 @@ void Game::Damage(Coordinate pos) {
 		construction->Damage(&attack);
 	}
 	for (std::set<int>::iterator npcuid = Map::Inst()->NPCList(pos)->begin(); npcuid != Map::Inst()->NPCList(pos)->end(); ++npcuid) {
-			boost::shared_ptr<NPC> npc;
-			if (npcList.find(*npcuid) != npcList.end()) npc = npcList[*npcuid];
+			boost::shared_ptr<NPC> npc = npcList.Get(*npcuid);
 			if (npc) npc->Damage(&attack);
 	}
 }
 
+TimerWheel* Game::Timers() { return &timers; }
+
+namespace {
+	//Scripts hand in callbacks too, a broken one shouldn't take the game down with it
+	void RunDelay(boost::function<void()> callback) {
+		try {
+			callback();
+		} catch (const py::error_already_set&) {
+			Script::LogException();
+		}
+	}
+
+	bool RunRandomEvent(boost::function<bool()> callback) {
+		try {
+			return callback();
+		} catch (const py::error_already_set&) {
+			Script::LogException();
+			return false;
+		}
+	}
+}
+
 void Game::AddDelay(int delay, boost::function<void()> callback) {
-	delays.push_back(std::pair<int, boost::function<void()> >(delay, callback));
+	timers.Schedule(delay, boost::bind(&RunDelay, callback));
+}
+
+void Game::AddRandomEvent(int chance, boost::function<bool()> callback) {
+	timers.ScheduleRandom(chance, boost::bind(&RunRandomEvent, callback));
 }
 
 void Game::GameOver() {
@@ -2314,7 +2339,7 @@ void Game::UpdateFarmPlotSeedAllowances(ItemType type) {
 	for (std::set<ItemCategory>::iterator cati = Item::Presets[type].categories.begin(); cati != Item::Presets[type].categories.end();
 		++cati) {
 			if (boost::iequals(Item::Categories[*cati].name, "seed")) {
-				for (std::map<int, boost::shared_ptr<Construction> >::iterator dynamicConsi = dynamicConstructionList.begin();
+				for (EntityMap<Construction>::iterator dynamicConsi = dynamicConstructionList.begin();
 					dynamicConsi != dynamicConstructionList.end(); ++dynamicConsi) {
 						if (dynamicConsi->second->HasTag(FARMPLOT)) {
 							boost::static_pointer_cast<FarmPlot>(dynamicConsi->second)->AllowedSeeds()->insert(std::pair<ItemType,bool>(type, false));
@@ -2328,8 +2353,7 @@ void Game::UpdateFarmPlotSeedAllowances(ItemType type) {
 void Game::Hungerize(Coordinate pos) {
 	if (Map::Inst()->IsInside(pos)) {
 		for (std::set<int>::iterator npci = Map::Inst()->NPCList(pos)->begin(); npci != Map::Inst()->NPCList(pos)->end(); ++npci) {
-				boost::shared_ptr<NPC> npc;
-				if (npcList.find(*npci) != npcList.end()) npc = npcList[*npci];
+				boost::shared_ptr<NPC> npc = npcList.Get(*npci);
 				if (npc) {
 					npc->hunger = 50000;
 				}
@@ -2340,8 +2364,7 @@ void Game::Hungerize(Coordinate pos) {
 void Game::Tire(Coordinate pos) {
 	if (Map::Inst()->IsInside(pos)) {
 		for (std::set<int>::iterator npci = Map::Inst()->NPCList(pos)->begin(); npci != Map::Inst()->NPCList(pos)->end(); ++npci) {
-				boost::shared_ptr<NPC> npc;
-				if (npcList.find(*npci) != npcList.end()) npc = npcList[*npci];
+				boost::shared_ptr<NPC> npc = npcList.Get(*npci);
 				if (npc) {
 					npc->weariness = (int)(WEARY_THRESHOLD-1);
 				}
@@ -2353,8 +2376,7 @@ void Game::Thirstify(Coordinate pos) {
 	if (Map::Inst()->IsInside(pos)) {
 		for (std::set<int>::iterator npci = Map::Inst()->NPCList(pos)->begin();
 			npci != Map::Inst()->NPCList(pos)->end(); ++npci) {
-				boost::shared_ptr<NPC> npc;
-				if (npcList.find(*npci) != npcList.end()) npc = npcList[*npci];
+				boost::shared_ptr<NPC> npc = npcList.Get(*npci);
 				if (npc) {
 					npc->thirst = THIRST_THRESHOLD + 500;
 				}
@@ -2365,8 +2387,7 @@ void Game::Badsleepify(Coordinate pos) {
 	if (Map::Inst()->IsInside(pos)) {
 		for (std::set<int>::iterator npci = Map::Inst()->NPCList(pos)->begin();
 			npci != Map::Inst()->NPCList(pos)->end(); ++npci) {
-				boost::shared_ptr<NPC> npc;
-				if (npcList.find(*npci) != npcList.end()) npc = npcList[*npci];
+				boost::shared_ptr<NPC> npc = npcList.Get(*npci);
 				if (npc) {
 					npc->AddEffect(BADSLEEP);
 				}
@@ -2378,8 +2399,7 @@ void Game::Diseasify(Coordinate pos) {
 	if (Map::Inst()->IsInside(pos)) {
 		for (std::set<int>::iterator npci = Map::Inst()->NPCList(pos)->begin();
 			npci != Map::Inst()->NPCList(pos)->end(); ++npci) {
-				boost::shared_ptr<NPC> npc;
-				if (npcList.find(*npci) != npcList.end()) npc = npcList[*npci];
+				boost::shared_ptr<NPC> npc = npcList.Get(*npci);
 				if (npc) {
 					npc->AddEffect(COLLYWOBBLES);
 				}
@@ -2416,24 +2436,20 @@ void Game::SetSeason(Season newSeason) {
 }
 
 boost::shared_ptr<NPC> Game::GetNPC(int uid) const {
-	std::map<int, boost::shared_ptr<NPC> >::const_iterator npci = npcList.find(uid);
-	if (npci != npcList.end()) {
-		return npci->second;
-	}
-	return boost::shared_ptr<NPC>();
+	return npcList.Get(uid);
 }
 
 boost::weak_ptr<Construction> Game::GetRandomConstruction() const {
 	if (dynamicConstructionList.empty() || 
 		(Random::GenerateBool() && !staticConstructionList.empty())) {
 		int index = Random::Generate(staticConstructionList.size()-1);
-		for (std::map<int, boost::shared_ptr<Construction> >::const_iterator consi = staticConstructionList.begin();
+		for (EntityMap<Construction>::const_iterator consi = staticConstructionList.begin();
 			consi != staticConstructionList.end(); ++consi) {
 				if (index-- == 0) return consi->second;
 		}
 	} else if (!dynamicConstructionList.empty()) {
 		int index = Random::Generate(dynamicConstructionList.size()-1);
-		for (std::map<int, boost::shared_ptr<Construction> >::const_iterator consi = dynamicConstructionList.begin();
+		for (EntityMap<Construction>::const_iterator consi = dynamicConstructionList.begin();
 			consi != dynamicConstructionList.end(); ++consi) {
 				if (index-- == 0) return consi->second;
 		}
@@ -2490,7 +2506,7 @@ void Game::DisplayStats() {
 
 //Check each stockpile for empty not-needed containers, and see if some other pile needs them
 void Game::RebalanceStockpiles(ItemCategory requiredCategory, boost::shared_ptr<Stockpile> excluded) {
-	for (std::map<int,boost::shared_ptr<Construction> >::iterator stocki = staticConstructionList.begin(); stocki != staticConstructionList.end(); ++stocki) {
+	for (EntityMap<Construction>::iterator stocki = staticConstructionList.begin(); stocki != staticConstructionList.end(); ++stocki) {
 		if (stocki->second->stockpile) {
 			boost::shared_ptr<Stockpile> sp(boost::static_pointer_cast<Stockpile>(stocki->second));
 			if (sp != excluded && sp->GetAmount(requiredCategory) > sp->GetDemand(requiredCategory)) {
@@ -2506,20 +2522,37 @@ void Game::RebalanceStockpiles(ItemCategory requiredCategory, boost::shared_ptr<
 }
 
 void Game::ProvideMap() {
-	for (std::map<int,boost::shared_ptr<Item> >::const_iterator itemIterator = itemList.begin(); itemIterator != itemList.end(); ++itemIterator) {
+	for (EntityMap<Item>::const_iterator itemIterator = itemList.begin(); itemIterator != itemList.end(); ++itemIterator) {
 		itemIterator->second->SetMap(Map::Inst());
 	}
-	for (std::map<int, boost::shared_ptr<NPC> >::const_iterator npcIterator = npcList.begin(); npcIterator != npcList.end(); ++npcIterator) {
+	for (EntityMap<NPC>::const_iterator npcIterator = npcList.begin(); npcIterator != npcList.end(); ++npcIterator) {
 		npcIterator->second->SetMap(Map::Inst());
 	}
-	for (std::map<int, boost::shared_ptr<Construction> >::const_iterator consIterator = staticConstructionList.begin(); consIterator != staticConstructionList.end(); ++consIterator) {
+	for (EntityMap<Construction>::const_iterator consIterator = staticConstructionList.begin(); consIterator != staticConstructionList.end(); ++consIterator) {
 		consIterator->second->SetMap(Map::Inst());
 	}
-	for (std::map<int, boost::shared_ptr<Construction> >::const_iterator consIterator = dynamicConstructionList.begin(); consIterator != dynamicConstructionList.end(); ++consIterator) {
+	for (EntityMap<Construction>::const_iterator consIterator = dynamicConstructionList.begin(); consIterator != dynamicConstructionList.end(); ++consIterator) {
 		consIterator->second->SetMap(Map::Inst());
 	}
 }
 
+namespace {
+	//Entity lists are still saved as the std::maps they used to be, in uid order
+	template <class T>
+	void SaveEntities(OutputArchive& ar, const EntityMap<T>& entities) {
+		const std::map<int, boost::shared_ptr<T> > list(entities.begin(), entities.end());
+		ar & list;
+	}
+
+	template <class T>
+	void LoadEntities(InputArchive& ar, EntityMap<T>& entities) {
+		std::map<int, boost::shared_ptr<T> > list;
+		ar & list;
+		entities.clear();
+		entities.insert(list.begin(), list.end());
+	}
+}
+
 void Game::save(OutputArchive& ar, const unsigned int version) const  {
 	ar.register_type<Container>();
 	ar.register_type<Item>();
@@ -2542,16 +2575,16 @@ void Game::save(OutputArchive& ar, const unsigned int version) const  {
 	ar & camX;
 	ar & camY;
 	ar & Faction::factions;
-	ar & npcList;
+	SaveEntities(ar, npcList);
 	ar & squadList;
 	ar & hostileSquadList;
-	ar & staticConstructionList;
-	ar & dynamicConstructionList;
-	ar & itemList;
+	SaveEntities(ar, staticConstructionList);
+	SaveEntities(ar, dynamicConstructionList);
+	SaveEntities(ar, itemList);
 	ar & freeItems;
 	ar & flyingItems;
 	ar & stoppedItems;
-	ar & natureList;
+	SaveEntities(ar, natureList);
 	ar & waterList;
 	ar & filthList;
 	ar & bloodList;
@@ -2606,19 +2639,23 @@ void Game::load(InputArchive& ar, const unsigned int version) {
 		}
 	}
 	
-	ar & npcList;
+	LoadEntities(ar, npcList);
 	
 	Faction::TranslateMembers(); //Translate uid's into pointers, do this after loading npcs
 	
 	ar & squadList;
 	ar & hostileSquadList;
-	ar & staticConstructionList;
-	ar & dynamicConstructionList;
-	ar & itemList;
+	LoadEntities(ar, staticConstructionList);
+	LoadEntities(ar, dynamicConstructionList);
+	LoadEntities(ar, itemList);
 	ar & freeItems;
+	//The queue isn't saved, everything loose gets another look
+	for (std::set<boost::weak_ptr<Item> >::iterator itemi = freeItems.begin(); itemi != freeItems.end(); ++itemi) {
+		if (boost::shared_ptr<Item> item = itemi->lock()) StockpileQueue::Inst()->Push(item);
+	}
 	ar & flyingItems;
 	ar & stoppedItems;
-	ar & natureList;
+	LoadEntities(ar, natureList);
 	ar & waterList;
 	ar & filthList;
 	ar & bloodList;
@@ -33,6 +33,7 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include "StockManager.hpp"
 #include "Attack.hpp"
 #include "Faction.hpp"
+#include "StockpileQueue.hpp"
 
 std::vector<ItemPreset> Item::Presets = std::vector<ItemPreset>();
 std::vector<ItemCat> Item::Categories = std::vector<ItemCat>();
@@ -154,9 +155,16 @@ Coordinate Item::Position() {
 
 void Item::Reserve(bool value) {
 	reserved = value;
-	if (!reserved && !container.lock() && !attemptedStore) {
-		attemptedStore = true;
-		Game::Inst()->StockpileItem(boost::static_pointer_cast<Item>(shared_from_this()));
+	if (!reserved && !container.lock()) {
+		if (!attemptedStore) {
+			attemptedStore = true;
+			Game::Inst()->StockpileItem(boost::static_pointer_cast<Item>(shared_from_this()));
+			//No stockpile took it, wait for one to get room
+			if (!reserved) StockpileQueue::Inst()->PushLater(boost::static_pointer_cast<Item>(shared_from_this()));
+		} else {
+			//Storing it already failed once, try again after a while instead of right away
+			StockpileQueue::Inst()->PushLater(boost::static_pointer_cast<Item>(shared_from_this()));
+		}
 	}
 }
 
@@ -0,0 +1,195 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include "ItemIndex.hpp"
+#include "Item.hpp"
+#include "Container.hpp"
+#include "Stockpile.hpp"
+#include "StockManager.hpp"
+
+ItemIndex* ItemIndex::instance = 0;
+const int ItemIndex::BUCKET_SIZE;
+
+ItemIndex* ItemIndex::Inst() {
+	if (!instance) instance = new ItemIndex();
+	return instance;
+}
+
+void ItemIndex::Reset() {
+	delete instance;
+	instance = new ItemIndex();
+}
+
+ItemIndex::ItemIndex() : decayPasses(0) {}
+
+void ItemIndex::Insert(Index& index, int uid, const boost::weak_ptr<Item>& item, const Entry& entry) {
+	index.buckets[entry.bucket][uid] = item;
+	index.byDecay[std::make_pair(entry.decayKey, uid)] = item;
+}
+
+void ItemIndex::Erase(Index& index, int uid, const Entry& entry) {
+	boost::unordered_map<Coordinate, Bucket>::iterator bucketi = index.buckets.find(entry.bucket);
+	if (bucketi != index.buckets.end()) {
+		bucketi->second.erase(uid);
+		if (bucketi->second.empty()) index.buckets.erase(bucketi);
+	}
+	index.byDecay.erase(std::make_pair(entry.decayKey, uid));
+}
+
+void ItemIndex::Add(const boost::shared_ptr<Item>& item) {
+	int uid = item->Uid();
+	if (entries.find(uid) != entries.end()) return; //Containers re-add their contents when they're stored
+
+	Entry entry;
+	entry.type = item->Type();
+	entry.bucket = item->Position() / BUCKET_SIZE;
+	entry.decayKey = item->GetDecay() > 0 ? item->GetDecay() + decayPasses : -1;
+	entries[uid] = entry;
+
+	if (static_cast<int>(types.size()) <= entry.type) types.resize(entry.type + 1);
+	Insert(types[entry.type], uid, item, entry);
+	const std::set<ItemCategory>& itemCategories = Item::Presets[entry.type].categories;
+	for (std::set<ItemCategory>::const_iterator cati = itemCategories.begin(); cati != itemCategories.end(); ++cati) {
+		if (static_cast<int>(categories.size()) <= *cati) categories.resize(*cati + 1);
+		Insert(categories[*cati], uid, item, entry);
+	}
+}
+
+void ItemIndex::Remove(const boost::shared_ptr<Item>& item) {
+	Remove(item->Uid());
+}
+
+//Works from the entry alone, the item might be gone already
+void ItemIndex::Remove(int uid) {
+	boost::unordered_map<int, Entry>::iterator entryi = entries.find(uid);
+	if (entryi == entries.end()) return;
+
+	Entry entry = entryi->second;
+	entries.erase(entryi);
+	Erase(types[entry.type], uid, entry);
+	const std::set<ItemCategory>& itemCategories = Item::Presets[entry.type].categories;
+	for (std::set<ItemCategory>::const_iterator cati = itemCategories.begin(); cati != itemCategories.end(); ++cati) {
+		Erase(categories[*cati], uid, entry);
+	}
+}
+
+void ItemIndex::DecayPassed() { ++decayPasses; }
+
+bool ItemIndex::Suitable(const boost::shared_ptr<Item>& item, int flags, int value) {
+	if (item->Reserved()) return false;
+
+	if (flags & NOTFULL && boost::dynamic_pointer_cast<Container>(item)) {
+		boost::shared_ptr<Container> container = boost::static_pointer_cast<Container>(item);
+		//value represents bulk in this case. Needs to check Full() because bulk=value=0 is a possibility
+		if (container->Full() || container->Capacity() < value) return false;
+	}
+
+	if (flags & BETTERTHAN && item->RelativeValue() <= value) return false;
+
+	if (flags & APPLYMINIMUMS && item->IsCategory(Item::StringToItemCategory("Seed"))) {
+		//Don't hand out seeds at or below the set minimum for them
+		if (StockManager::Inst()->TypeQuantity(item->Type()) <= StockManager::Inst()->Minimum(item->Type())) return false;
+	}
+
+	if (flags & EMPTY && boost::dynamic_pointer_cast<Container>(item)) {
+		boost::shared_ptr<Container> container = boost::static_pointer_cast<Container>(item);
+		if (!container->empty() || container->GetReservedSpace() > 0) return false;
+	}
+	return true;
+}
+
+boost::weak_ptr<Item> ItemIndex::FindNearest(Index& index, const Coordinate& target, int flags, int value, std::vector<int>& expired) {
+	//Closest a bucket could possibly have an item to the target, nearest ones first
+	std::vector<std::pair<int, Bucket*> > order;
+	order.reserve(index.buckets.size());
+	for (boost::unordered_map<Coordinate, Bucket>::iterator bucketi = index.buckets.begin(); bucketi != index.buckets.end(); ++bucketi) {
+		Coordinate low = bucketi->first * BUCKET_SIZE;
+		Coordinate high = low + (BUCKET_SIZE - 1);
+		int bound = 0;
+		for (int d = 0; d < 2; ++d) {
+			bound += std::max(0, std::max(low[d] - target[d], target[d] - high[d]));
+		}
+		order.push_back(std::make_pair(bound, &bucketi->second));
+	}
+	std::sort(order.begin(), order.end());
+
+	boost::shared_ptr<Item> nearest;
+	int nearestDistance = std::numeric_limits<int>::max();
+	for (std::vector<std::pair<int, Bucket*> >::iterator bucketi = order.begin(); bucketi != order.end(); ++bucketi) {
+		if (bucketi->first >= nearestDistance) break;
+		for (Bucket::iterator itemi = bucketi->second->begin(); itemi != bucketi->second->end(); ++itemi) {
+			boost::shared_ptr<Item> item = itemi->second.lock();
+			if (!item) {
+				expired.push_back(itemi->first);
+				continue;
+			}
+			if (!Suitable(item, flags, value)) continue;
+			int distance = Distance(item->Position(), target);
+			if (distance < nearestDistance) {
+				nearestDistance = distance;
+				nearest = item;
+			}
+		}
+	}
+	return nearest;
+}
+
+boost::weak_ptr<Item> ItemIndex::FindMostDecayed(Index& index, int flags, int value, std::vector<int>& expired) {
+	boost::shared_ptr<Item> mostDecayed;
+	int lowestDecay = 0;
+	for (std::map<std::pair<int, int>, boost::weak_ptr<Item> >::iterator decayi = index.byDecay.begin(); decayi != index.byDecay.end(); ++decayi) {
+		//The garbage penalty only ever adds, so nothing further along can be closer to decaying
+		if (mostDecayed && decayi->first.first >= 0 && decayi->first.first - decayPasses > lowestDecay) break;
+
+		boost::shared_ptr<Item> item = decayi->second.lock();
+		if (!item) {
+			expired.push_back(decayi->first.second);
+			continue;
+		}
+		if (!Suitable(item, flags, value)) continue;
+		int decay = item->GetDecay();
+		if (flags & AVOIDGARBAGE && item->IsCategory(Item::StringToItemCategory("Garbage"))) decay += 100;
+		if (!mostDecayed || decay < lowestDecay) {
+			lowestDecay = decay;
+			mostDecayed = item;
+		}
+	}
+	return mostDecayed;
+}
+
+boost::weak_ptr<Item> ItemIndex::Find(std::vector<Index>& indices, int key, const Coordinate& target, int flags, int value) {
+	if (key < 0 || key >= static_cast<int>(indices.size())) return boost::weak_ptr<Item>();
+
+	std::vector<int> expired;
+	boost::weak_ptr<Item> item = flags & MOSTDECAYED ? FindMostDecayed(indices[key], flags, value, expired) :
+		FindNearest(indices[key], target, flags, value, expired);
+	for (std::vector<int>::iterator uidi = expired.begin(); uidi != expired.end(); ++uidi) {
+		Remove(*uidi);
+	}
+	return item;
+}
+
+boost::weak_ptr<Item> ItemIndex::FindByCategory(ItemCategory category, const Coordinate& target, int flags, int value) {
+	return Find(categories, category, target, flags, value);
+}
+
+boost::weak_ptr<Item> ItemIndex::FindByType(ItemType type, const Coordinate& target, int flags, int value) {
+	return Find(types, type, target, flags, value);
+}
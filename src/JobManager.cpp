@@ -19,13 +19,54 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/weak_ptr.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <algorithm>
+#include <climits>
 
 #include "JobManager.hpp"
 #include "Game.hpp"
-#include "KuhnMunkres.hpp"
+#include "Auction.hpp"
 #include "StockManager.hpp"
+#include "Map.hpp"
+
+namespace {
+	const boost::posix_time::time_duration ASSIGNMENT_BUDGET = boost::posix_time::microseconds(2000);
+	const size_t AUCTION_CANDIDATES = 12; //Jobs each NPC bids on
+	const int BUCKET_SIZE = 16; //Side of the squares jobs are indexed by
+	const int MAX_JOB_VALUE = 10000;
+
+	Coordinate Bucket(const Coordinate& p) {
+		return p / BUCKET_SIZE;
+	}
+
+	bool HasTarget(boost::shared_ptr<Job> job) {
+		return !job->tasks.empty() && !(job->tasks[0].target.X() == 0 && job->tasks[0].target.Y() == 0);
+	}
+
+	//Closer jobs are worth more, and ones needing a tool the NPC doesn't have a lot less
+	int JobValue(boost::shared_ptr<NPC> npc, boost::shared_ptr<Job> job) {
+		int value = HasTarget(job) ? MAX_JOB_VALUE - Distance(job->tasks[0].target, npc->Position()) : 1;
+		if (job->RequiresTool()) {
+			if (!npc->Wielding().lock() || !npc->Wielding().lock()->IsCategory(job->GetRequiredTool())) {
+				value -= 2000;
+			}
+		}
+		return std::max(1, value);
+	}
+
+	bool HigherValue(const AuctionCandidate& a, const AuctionCandidate& b) {
+		return a.value > b.value;
+	}
+
+	//A job that starts by walking somewhere the NPC can't get to is never worth assigning to it
+	bool CanReach(boost::shared_ptr<NPC> npc, boost::shared_ptr<Job> job) {
+		if (job->tasks.empty() || job->tasks[0].action != MOVE) return true;
+		return Map::Inst()->IsReachable(npc->Position(), job->tasks[0].target, static_cast<void*>(npc.get()));
+	}
+}
 
 JobManager::JobManager() {
+	std::fill(auctionResumed, auctionResumed + PRIORITY_COUNT * 2, false);
 	for (std::vector<ItemCat>::iterator i = Item::Categories.begin(); i != Item::Categories.end(); ++i) {
 		toolJobs.push_back(std::vector<boost::weak_ptr<Job> >());
 	}
@@ -44,11 +85,11 @@ void JobManager::AddJob(boost::shared_ptr<Job> newJob) {
 	}
 
 	if (newJob->PreReqsCompleted()) {
-		availableList[newJob->priority()].push_back(newJob);
+		Insert(newJob, newJob->priority());
 		return;
 	} else {
 		newJob->Paused(true);
-		waitingList.push_back(newJob);
+		Insert(newJob, PRIORITY_COUNT);
 	}
 }
 
@@ -57,17 +98,8 @@ void JobManager::CancelJob(boost::weak_ptr<Job> oldJob, std::string msg, TaskRes
 		job->Assign(-1);
 		job->Paused(true);
 
-		//Push job onto waiting list
-		waitingList.push_back(job);
-
-		//Remove job from availabe list
-		for(std::list<boost::shared_ptr<Job> >::iterator jobi = availableList[job->priority()].begin(); 
-			jobi != availableList[job->priority()].end(); ++jobi) {
-				if ((*jobi) == job) {
-					availableList[job->priority()].erase(jobi);
-					break;
-				}
-		}
+		//Move job onto the waiting list, its tasks might have changed since it was indexed
+		Insert(job, PRIORITY_COUNT);
 
 		//If the job requires a tool, remove it from the toolJobs list
 		if (job->RequiresTool()) {
@@ -146,7 +178,7 @@ void JobManager::Update() {
 	for (std::list<boost::shared_ptr<Job> >::iterator jobIter = waitingList.begin(); jobIter != waitingList.end(); ) {
 
 		if ((*jobIter)->Removable()) {
-			jobIter = waitingList.erase(jobIter);
+			jobIter = Erase(jobIter);
 		} else {
 
 			if (!(*jobIter)->PreReqs()->empty() && (*jobIter)->PreReqsCompleted()) {
@@ -154,8 +186,9 @@ void JobManager::Update() {
 			}
 
 			if (!(*jobIter)->Paused()) {
-				AddJob(*jobIter);
-				jobIter = waitingList.erase(jobIter);
+				boost::shared_ptr<Job> job = *jobIter;
+				jobIter = Erase(jobIter);
+				AddJob(job);
 			} else {
 				if (!(*jobIter)->Parent().lock() && !(*jobIter)->PreReqs()->empty()) {
 					//Job has unfinished prereqs, itsn't removable and is NOT a prereq itself
@@ -178,7 +211,7 @@ void JobManager::Update() {
 		for (std::list<boost::shared_ptr<Job> >::iterator jobi = availableList[i].begin();
 			jobi != availableList[i].end(); ) {
 				if ((*jobi)->Completed() && (*jobi)->PreReqsCompleted()) {
-					jobi = availableList[i].erase(jobi);
+					jobi = Erase(jobi);
 				} else {
 					++jobi;
 				}
@@ -228,19 +261,59 @@ boost::weak_ptr<Job> JobManager::GetJobByListIndex(int index) {
 
 void JobManager::RemoveJob(boost::weak_ptr<Job> wjob) {
 	if (boost::shared_ptr<Job> job = wjob.lock()) {
-		for (int i = 0; i < PRIORITY_COUNT; ++i) {
-			for (std::list<boost::shared_ptr<Job> >::iterator jobi = availableList[i].begin(); jobi != availableList[i].end(); ++jobi) {
-				if (*jobi == job) {
-					jobi = availableList[i].erase(jobi);
-					return;
-				}
-			}
+		Erase(job);
+	}
+}
+
+std::list<boost::shared_ptr<Job> >& JobManager::List(int list) {
+	return list < PRIORITY_COUNT ? availableList[list] : waitingList;
+}
+
+//Appends the job to the given list, taking it off the one it was on before
+void JobManager::Insert(boost::shared_ptr<Job> job, int list) {
+	Erase(job);
+	List(list).push_back(job);
+
+	IndexEntry& entry = jobIndex[job.get()];
+	entry.list = list;
+	entry.position = --List(list).end();
+	for (std::vector<Task>::iterator taski = job->tasks.begin(); taski != job->tasks.end(); ++taski) {
+		Coordinate bucket = Bucket(taski->target);
+		if (std::find(entry.buckets.begin(), entry.buckets.end(), bucket) == entry.buckets.end()) {
+			entry.buckets.push_back(bucket);
+			jobGrid[bucket].push_back(job.get());
 		}
-		for (std::list<boost::shared_ptr<Job> >::iterator jobi = waitingList.begin(); jobi != waitingList.end(); ++jobi) {
-			if (*jobi == job) {
-				jobi = waitingList.erase(jobi);
-				return;
-			}
+	}
+}
+
+std::list<boost::shared_ptr<Job> >::iterator JobManager::Erase(std::list<boost::shared_ptr<Job> >::iterator jobi) {
+	boost::unordered_map<Job*, IndexEntry>::iterator entry = jobIndex.find(jobi->get());
+	for (std::vector<Coordinate>::iterator bucketi = entry->second.buckets.begin(); bucketi != entry->second.buckets.end(); ++bucketi) {
+		std::vector<Job*>& bucket = jobGrid[*bucketi];
+		bucket.erase(std::find(bucket.begin(), bucket.end(), jobi->get()));
+		if (bucket.empty()) jobGrid.erase(*bucketi);
+	}
+	std::list<boost::shared_ptr<Job> >& list = List(entry->second.list);
+	jobIndex.erase(entry);
+	return list.erase(jobi);
+}
+
+bool JobManager::Erase(boost::shared_ptr<Job> job) {
+	boost::unordered_map<Job*, IndexEntry>::iterator entry = jobIndex.find(job.get());
+	if (entry == jobIndex.end()) return false;
+	Erase(entry->second.position);
+	return true;
+}
+
+//Rebuilds the index from the lists, older saves can have the same job listed twice
+void JobManager::Reindex() {
+	jobIndex.clear();
+	jobGrid.clear();
+	for (int i = 0; i <= PRIORITY_COUNT; ++i) {
+		std::list<boost::shared_ptr<Job> > jobs;
+		jobs.swap(List(i));
+		for (std::list<boost::shared_ptr<Job> >::iterator jobi = jobs.begin(); jobi != jobs.end(); ++jobi) {
+			if (jobIndex.find(jobi->get()) == jobIndex.end()) Insert(*jobi, i);
 		}
 	}
 }
@@ -298,12 +371,19 @@ void JobManager::ClearWaitingNpcs() {
 }
 
 void JobManager::AssignJobs() {
+	boost::posix_time::ptime deadline = boost::posix_time::microsec_clock::universal_time() + ASSIGNMENT_BUDGET;
+
 	//It's useless to attempt to assing more tool-required jobs than there are tools 
 	std::vector<int> maxToolJobs(Item::Categories.size());
 	for (unsigned int i = 0; i < Item::Categories.size(); ++i) {
 		maxToolJobs[i] = StockManager::Inst()->CategoryQuantity(ItemCategory(i)) - toolJobs[i].size();
 	}
 
+	for (std::map<boost::weak_ptr<Job>, int>::iterator pricei = jobPrices.begin(); pricei != jobPrices.end();) {
+		if (!pricei->first.lock()) jobPrices.erase(pricei++);
+		else ++pricei;
+	}
+
 	for (int i = 0; i < PRIORITY_COUNT && (!expertNPCsWaiting.empty() || !menialNPCsWaiting.empty()); i++) {
 		if(!availableList[i].empty()) {
 			std::vector<boost::shared_ptr<Job> > menialJobsToAssign;
@@ -311,133 +391,141 @@ void JobManager::AssignJobs() {
 			for (std::list<boost::shared_ptr<Job> >::iterator jobi = availableList[i].begin();
 				 jobi != availableList[i].end(); ++jobi) {
 				if ((*jobi)->Assigned() == -1 && !(*jobi)->Removable()) {
-					/*Limit assigning jobs to 20 at a time, large matrix sizes cause considerable slowdowns.
-					Also, if the job requires a tool only add it to assignables if there are potentially enough
+					/*If the job requires a tool only add it to assignables if there are potentially enough
 					tools for each job*/
 					if (!(*jobi)->RequiresTool() || 
 						((*jobi)->RequiresTool() && maxToolJobs[(*jobi)->GetRequiredTool()] > 0)) {
 						if ((*jobi)->RequiresTool()) --maxToolJobs[(*jobi)->GetRequiredTool()];
-						if ((*jobi)->Menial() && menialJobsToAssign.size() < 20) menialJobsToAssign.push_back(*jobi);
-						else if (!(*jobi)->Menial() && expertJobsToAssign.size() < 20) expertJobsToAssign.push_back(*jobi);
+						if ((*jobi)->Menial()) menialJobsToAssign.push_back(*jobi);
+						else expertJobsToAssign.push_back(*jobi);
 					}
 				}
 			}
-			if(!menialJobsToAssign.empty() || !expertJobsToAssign.empty()) {
-				
-				unsigned int menialMatrixSize = std::max(menialJobsToAssign.size(), menialNPCsWaiting.size());
-				unsigned int expertMatrixSize = std::max(expertJobsToAssign.size(), expertNPCsWaiting.size());
-				boost::numeric::ublas::matrix<int> menialMatrix(menialMatrixSize, menialMatrixSize);
-				boost::numeric::ublas::matrix<int> expertMatrix(expertMatrixSize, expertMatrixSize);
-
-				for(unsigned int x = 0; x < menialMatrixSize; x++) {
-					for(unsigned int y = 0; y < menialMatrixSize; y++) {
-						if(x >= menialNPCsWaiting.size() || y >= menialJobsToAssign.size()) {
-							menialMatrix(x, y) = 1;
-						} else {
-							boost::shared_ptr<Job> job = menialJobsToAssign[y];
-							boost::shared_ptr<NPC> npc = Game::Inst()->GetNPC(menialNPCsWaiting[x]);
-							if(!npc || job->tasks.empty() ||
-								(job->tasks[0].target.X() == 0 && job->tasks[0].target.Y() == 0)) {
-								menialMatrix(x, y) = 1;
-							} else if (npc) {
-								menialMatrix(x, y) = 10000 - Distance(job->tasks[0].target, npc->Position());
-							}
-							if (npc && job->RequiresTool()) {
-								if (!npc->Wielding().lock() || !npc->Wielding().lock()->IsCategory(job->GetRequiredTool())) {
-									menialMatrix(x, y) -= 2000;
-								}
-							}
-						}
-					}
-				}
-				
-				for(unsigned int x = 0; x < expertMatrixSize; x++) {
-					for(unsigned int y = 0; y < expertMatrixSize; y++) {
-						if(x >= expertNPCsWaiting.size() || y >= expertJobsToAssign.size()) {
-							expertMatrix(x, y) = 1;
-						} else {
-							boost::shared_ptr<Job> job = expertJobsToAssign[y];
-							boost::shared_ptr<NPC> npc = Game::Inst()->GetNPC(expertNPCsWaiting[x]);
-							if(!npc || job->tasks.empty() ||
-							   (job->tasks[0].target.X() == 0 && job->tasks[0].target.Y() == 0)) {
-								expertMatrix(x, y) = 1;
-							} else {
-								expertMatrix(x, y) = 10000 - Distance(job->tasks[0].target, npc->Position());
-							}
-							if (npc && job->RequiresTool()) {
-								if (!npc->Wielding().lock() || !npc->Wielding().lock()->IsCategory(job->GetRequiredTool())) {
-									expertMatrix(x, y) -= 2000;
-								}
-							}
-						}
-					}
-				}
-				std::vector<int> menialAssignments = FindBestMatching(menialMatrix);
-				std::vector<int> expertAssignments = FindBestMatching(expertMatrix);
-				
-				for(unsigned int i = 0, n = 0; n < menialNPCsWaiting.size(); i++, n++) {
-					unsigned int jobNum = menialAssignments[i];
-					if(jobNum < menialJobsToAssign.size()) {
-						int npcNum = menialNPCsWaiting[n];
-						boost::shared_ptr<Job> job = menialJobsToAssign[jobNum];
-						boost::shared_ptr<NPC> npc = Game::Inst()->GetNPC(npcNum);
-						if (job && npc) {
-							job->Assign(npcNum);
-							menialNPCsWaiting.erase(menialNPCsWaiting.begin() + n);
-							n--;
-							if (job->RequiresTool())
-								toolJobs[job->GetRequiredTool()].push_back(job);
-							npc->StartJob(job);
-						}
-					}
-				}
+			if (!menialJobsToAssign.empty()) Auction(menialJobsToAssign, menialNPCsWaiting, i * 2, deadline);
+			if (!expertJobsToAssign.empty()) Auction(expertJobsToAssign, expertNPCsWaiting, i * 2 + 1, deadline);
+		}
+	}
+}
 
-				for(unsigned int i = 0, n = 0; n < expertNPCsWaiting.size(); i++, n++) {
-					unsigned int jobNum = expertAssignments[i];
-					if(jobNum < expertJobsToAssign.size()) {
-						int npcNum = expertNPCsWaiting[n];
-						boost::shared_ptr<Job> job = expertJobsToAssign[jobNum];
-						boost::shared_ptr<NPC> npc = Game::Inst()->GetNPC(npcNum);
-						if (job && npc) {
-							job->Assign(npcNum);
-							expertNPCsWaiting.erase(expertNPCsWaiting.begin() + n);
-							n--;
-							if (job->RequiresTool())
-								toolJobs[job->GetRequiredTool()].push_back(job);
-							npc->StartJob(job);
-						}
+/* Assigns the given jobs to the waiting NPCs by auction. Each NPC only bids on the few jobs
+worth the most to it, found by searching outwards from it through the job buckets, so the cost
+grows with the number of NPCs rather than NPCs * jobs */
+void JobManager::Auction(std::vector<boost::shared_ptr<Job> >& jobs, std::vector<int>& npcsWaiting, int auction, boost::posix_time::ptime deadline) {
+	boost::unordered_map<Coordinate, std::vector<int> > grid;
+	std::vector<int> untargeted;
+	Coordinate low(INT_MAX, INT_MAX), high(INT_MIN, INT_MIN);
+	for (size_t y = 0; y < jobs.size(); ++y) {
+		if (HasTarget(jobs[y])) {
+			Coordinate bucket = Bucket(jobs[y]->tasks[0].target);
+			grid[bucket].push_back(y);
+			low = Coordinate::min(low, bucket);
+			high = Coordinate::max(high, bucket);
+		} else {
+			untargeted.push_back(y);
+		}
+	}
+
+	std::vector<boost::shared_ptr<NPC> > bidders;
+	std::vector<std::vector<AuctionCandidate> > candidates;
+	for (std::vector<int>::iterator uid = npcsWaiting.begin(); uid != npcsWaiting.end(); ++uid) {
+		boost::shared_ptr<NPC> npc = Game::Inst()->GetNPC(*uid);
+		if (!npc) continue;
+
+		std::vector<AuctionCandidate> jobValues;
+		Coordinate center = Bucket(npc->Position());
+		int rings = grid.empty() ? -1 : std::max(std::max(center.X() - low.X(), high.X() - center.X()),
+			std::max(center.Y() - low.Y(), high.Y() - center.Y()));
+		for (int ring = 0; ring <= rings; ++ring) {
+			for (int dy = -ring; dy <= ring; ++dy) {
+				//Only the edge of the square, the inside was done on earlier rings
+				int step = (dy == -ring || dy == ring) ? 1 : std::max(1, 2 * ring);
+				for (int dx = -ring; dx <= ring; dx += step) {
+					boost::unordered_map<Coordinate, std::vector<int> >::iterator bucket = grid.find(center + Coordinate(dx, dy));
+					if (bucket == grid.end()) continue;
+					for (std::vector<int>::iterator y = bucket->second.begin(); y != bucket->second.end(); ++y) {
+						if (!CanReach(npc, jobs[*y])) continue;
+						AuctionCandidate candidate = { *y, JobValue(npc, jobs[*y]) };
+						jobValues.push_back(candidate);
 					}
 				}
+			}
 
+			if (jobValues.size() >= AUCTION_CANDIDATES) {
+				std::partial_sort(jobValues.begin(), jobValues.begin() + AUCTION_CANDIDATES, jobValues.end(), HigherValue);
+				jobValues.resize(AUCTION_CANDIDATES);
+				//Jobs on the next ring are at least this far away, stop once none of them can make the cut
+				if (MAX_JOB_VALUE - (ring * BUCKET_SIZE + 1) <= jobValues.back().value) break;
 			}
 		}
+
+		for (std::vector<int>::iterator y = untargeted.begin(); y != untargeted.end() && jobValues.size() < AUCTION_CANDIDATES; ++y) {
+			if (!CanReach(npc, jobs[*y])) continue;
+			AuctionCandidate candidate = { *y, JobValue(npc, jobs[*y]) };
+			jobValues.push_back(candidate);
+		}
+
+		bidders.push_back(npc);
+		candidates.push_back(jobValues);
+	}
+
+	std::vector<int> prices(jobs.size(), 0);
+	for (size_t y = 0; y < jobs.size(); ++y) {
+		std::map<boost::weak_ptr<Job>, int>::iterator pricei = jobPrices.find(jobs[y]);
+		if (pricei != jobPrices.end()) prices[y] = pricei->second;
+	}
+
+	bool complete;
+	std::vector<int> assignments = FindAuctionAssignment(candidates, prices, deadline, complete);
+
+	/* Out of time. Unless this already was a resumed auction, nobody is assigned and the prices
+	are kept so next tick's auction starts close to where this one stopped */
+	if (!complete && !auctionResumed[auction]) {
+		for (size_t y = 0; y < jobs.size(); ++y) {
+			if (prices[y] > 0) jobPrices[jobs[y]] = prices[y];
+		}
+		auctionResumed[auction] = true;
+		return;
+	}
+	auctionResumed[auction] = false;
+
+	for (size_t x = 0; x < bidders.size(); ++x) {
+		if (assignments[x] < 0) continue;
+		boost::shared_ptr<Job> job = jobs[assignments[x]];
+		boost::shared_ptr<NPC> npc = bidders[x];
+		job->Assign(npc->Uid());
+		npcsWaiting.erase(std::find(npcsWaiting.begin(), npcsWaiting.end(), npc->Uid()));
+		if (job->RequiresTool())
+			toolJobs[job->GetRequiredTool()].push_back(job);
+		npc->StartJob(job);
+	}
+
+	for (size_t y = 0; y < jobs.size(); ++y) {
+		jobPrices.erase(jobs[y]);
 	}
 }
 
 void JobManager::RemoveJob(Action action, Coordinate location) {
-	for (int i = 0; i <= PRIORITY_COUNT; ++i) {
-		for (std::list<boost::shared_ptr<Job> >::iterator jobi = (i < PRIORITY_COUNT ? availableList[i].begin() : waitingList.begin()); 
-			jobi != (i < PRIORITY_COUNT ? availableList[i].end() : waitingList.end());) {
-				bool remove = false;
-				for (std::vector<Task>::iterator taski = (*jobi)->tasks.begin(); taski != (*jobi)->tasks.end(); ++taski) {
-					if (taski->action == action && taski->target == location) {
-						remove = true;
-						break;
-					}
-				}
-				if (remove) {
-					(*jobi)->Attempts(0);
-					if ((*jobi)->Assigned() >= 0) {
-						boost::shared_ptr<NPC> npc = Game::Inst()->GetNPC((*jobi)->Assigned());
-						boost::weak_ptr<Job> jobToRemove = *jobi;
-						++jobi; //AbortJob will cancel the job and the invalidate the old iterator
-						if (npc) npc->AbortJob(jobToRemove);
-					} else {
-						jobi = (i < PRIORITY_COUNT ? availableList[i].erase(jobi) : waitingList.erase(jobi));
-					}
-				} else {
-					++jobi;
-				}
+	boost::unordered_map<Coordinate, std::vector<Job*> >::iterator bucket = jobGrid.find(Bucket(location));
+	if (bucket == jobGrid.end()) return;
+
+	//Collected first, aborting or removing a job changes the bucket
+	std::vector<boost::shared_ptr<Job> > matches;
+	for (std::vector<Job*>::iterator jobi = bucket->second.begin(); jobi != bucket->second.end(); ++jobi) {
+		for (std::vector<Task>::iterator taski = (*jobi)->tasks.begin(); taski != (*jobi)->tasks.end(); ++taski) {
+			if (taski->action == action && taski->target == location) {
+				matches.push_back(*jobIndex[*jobi].position);
+				break;
+			}
+		}
+	}
+
+	for (std::vector<boost::shared_ptr<Job> >::iterator jobi = matches.begin(); jobi != matches.end(); ++jobi) {
+		(*jobi)->Attempts(0);
+		if ((*jobi)->Assigned() >= 0) {
+			boost::shared_ptr<NPC> npc = Game::Inst()->GetNPC((*jobi)->Assigned());
+			if (npc) npc->AbortJob(*jobi);
+		} else {
+			Erase(*jobi);
 		}
 	}
 }
@@ -474,4 +562,5 @@ void JobManager::load(InputArchive& ar, const unsigned int version) {
 	ar & expertNPCsWaiting;
 	ar & toolJobs;
 	ar & failList;
+	Reindex();
 }
@@ -20,6 +20,7 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include <boost/serialization/list.hpp>
 #include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/utility.hpp>
+#include <boost/serialization/vector.hpp>
 
 #include "Random.hpp"
 #include "Map.hpp"
@@ -32,21 +33,36 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include "Faction.hpp"
 #include "Weather.hpp"
 #include "GCamp.hpp"
+#include "PathGraph.hpp"
+#include "Connectivity.hpp"
+#include "FlowField.hpp"
+#include "PathCache.hpp"
+#include "WaterChunks.hpp"
+#include "NPCGrid.hpp"
+#include "Visibility.hpp"
 
 static const int HARDCODED_WIDTH = 500;
 static const int HARDCODED_HEIGHT = 500;
 
 Map::Map() :
-overlayFlags(0), markerids(0) {
+overlayFlags(0), markerids(0), deferredCacheUpdates(0) {
 	tileMap.resize(boost::extents[HARDCODED_WIDTH][HARDCODED_HEIGHT]);
 	cachedTileMap.resize(boost::extents[HARDCODED_WIDTH][HARDCODED_HEIGHT]);
 	heightMap = new TCODHeightMap(HARDCODED_WIDTH,HARDCODED_HEIGHT);
+	pathGraph = new PathGraph(this, HARDCODED_WIDTH, HARDCODED_HEIGHT);
+	connectivity = new Connectivity(HARDCODED_WIDTH, HARDCODED_HEIGHT);
+	flowFields = new FlowFieldCache(this);
+	pathCache = new PathCache(this, HARDCODED_WIDTH, HARDCODED_HEIGHT);
+	waterChunks = new WaterChunks(HARDCODED_WIDTH, HARDCODED_HEIGHT);
+	npcGrid = new NPCGrid();
+	visibility = new Visibility(this);
 	extent = Coordinate(HARDCODED_WIDTH, HARDCODED_HEIGHT);
+	waterTerrain.assign(HARDCODED_WIDTH * HARDCODED_HEIGHT, 0);
+	waterNodes.assign(HARDCODED_WIDTH * HARDCODED_HEIGHT, 0);
 	for (int i = 0; i < HARDCODED_WIDTH; ++i) {
 		for (int e = 0; e < HARDCODED_HEIGHT; ++e) {
 			tileMap[i][e].ResetType(TILEGRASS);
-			cachedTileMap[i][e].x = i;
-			cachedTileMap[i][e].y = e;
+			UpdateWaterTerrain(Coordinate(i, e));
 		}
 	}
 	waterlevel = -0.8f;
@@ -55,6 +71,13 @@ overlayFlags(0), markerids(0) {
 
 Map::~Map() {
 	delete heightMap;
+	delete pathGraph;
+	delete connectivity;
+	delete flowFields;
+	delete pathCache;
+	delete waterChunks;
+	delete npcGrid;
+	delete visibility;
 }
 
 Map* Map::instance = 0;
@@ -79,7 +102,7 @@ Coordinate Map::Shrink(const Coordinate& p) const
 
 float Map::getWalkCost(const Coordinate& from, const Coordinate& to, void* ptr) const {
 	if (static_cast<NPC*>(ptr)->IsFlying()) return 1.0f;
-	return (float)cachedTile(to).GetMoveCost(ptr);
+	return (float)cachedTile(to).GetMoveCost(to, ptr);
 }
 float Map::getWalkCost(int fx, int fy, int tx, int ty, void* ptr) const {
 	return Map::getWalkCost(Coordinate(fx,fy),Coordinate(tx,ty),ptr);
@@ -105,6 +128,13 @@ bool Map::IsWalkable(const Coordinate& p, void* ptr) const {
 	return IsWalkable(p);
 }
 
+//Tells whether it's worth searching for a path at all, only uses the cache so it can lag a tick behind
+bool Map::IsReachable(const Coordinate& from, const Coordinate& to, void* ptr) const {
+	NPC* npc = static_cast<NPC*>(ptr);
+	if (npc->IsFlying() || npc->IsTunneler()) return true;
+	return connectivity->Connected(from, to, npc->HasHands() ? Connectivity::WALKING : Connectivity::HANDLESS);
+}
+
 void Map::SetWalkable(const Coordinate &p, bool value) {
 	if (Map::IsInside(p)) {
 		tile(p).SetWalkable(value);
@@ -128,13 +158,17 @@ TileType Map::GetType(const Coordinate& p) {
 
 void Map::ResetType(const Coordinate& p, TileType ntype, float tileHeight) { 
 	if (Map::IsInside(p)) {
+		bool blocked = tile(p).BlocksLight();
 		tile(p).ResetType(ntype, tileHeight);
+		if (tile(p).BlocksLight() != blocked) visibility->TileChanged(p);
+		UpdateWaterTerrain(p);
 		changedTiles.insert(p);
 	}
 }
 void Map::ChangeType(const Coordinate& p, TileType ntype, float tileHeight) { 
 	if (Map::IsInside(p)) {
 		tile(p).ChangeType(ntype, tileHeight);
+		UpdateWaterTerrain(p);
 		changedTiles.insert(p);
 	}
 }
@@ -167,6 +201,8 @@ boost::weak_ptr<WaterNode> Map::GetWater(const Coordinate& p) {
 void Map::SetWater(const Coordinate& p, boost::shared_ptr<WaterNode> value) { 
 	if (Map::IsInside(p)) {
 		tile(p).SetWater(value);
+		waterNodes[p.Y() * extent.X() + p.X()] = value.get();
+		if (value) waterChunks->Add(value);
 		changedTiles.insert(p);
 	}
 }
@@ -175,7 +211,24 @@ bool Map::IsLow(const Coordinate& p) const {
 	return Map::IsInside(p) && tile(p).IsLow();
 }
 void Map::SetLow(const Coordinate& p, bool value) { 
-	if (Map::IsInside(p)) tile(p).SetLow(value); 
+	if (Map::IsInside(p)) {
+		tile(p).SetLow(value);
+		UpdateWaterTerrain(p);
+	}
+}
+
+void Map::UpdateWaterTerrain(const Coordinate& p) {
+	unsigned char flags = 0;
+	TileType type = tile(p).GetType();
+	if (tile(p).IsLow()) flags |= WATER_LOW;
+	if (tile(p).BlocksWater()) flags |= WATER_BLOCKED;
+	if ((type != TILENONE && type != TILEDITCH && type != TILERIVERBED) || tile(p).GetNatureObject() >= 0) flags |= WATER_SHORE;
+	if (type == TILERIVERBED) flags |= WATER_RIVERBED;
+	unsigned char& terrain = waterTerrain[p.Y() * extent.X() + p.X()];
+	if (terrain != flags) {
+		terrain = flags;
+		waterChunks->Wake(p); //Water next to a new ditch or a removed wall has to start moving again
+	}
 }
 
 bool Map::BlocksWater(const Coordinate& p) const { 
@@ -184,6 +237,7 @@ bool Map::BlocksWater(const Coordinate& p) const {
 void Map::SetBlocksWater(const Coordinate& p, bool value) { 
 	if (Map::IsInside(p)) {
 		tile(p).SetBlocksWater(value);
+		UpdateWaterTerrain(p);
 	}
 }
 
@@ -220,6 +274,7 @@ TCODColor Map::GetBackColor(const Coordinate& p) const {
 void Map::SetNatureObject(const Coordinate& p, int val) { 
 	if (Map::IsInside(p)) {
 		tile(p).SetNatureObject(val);
+		UpdateWaterTerrain(p);
 	}
 }
 int Map::GetNatureObject(const Coordinate& p) const { 
@@ -262,7 +317,10 @@ bool Map::BlocksLight(const Coordinate& p) const {
 	return true;
 }
 void Map::SetBlocksLight(const Coordinate& p, bool val) { 
-	if (Map::IsInside(p)) tile(p).SetBlocksLight(val); 
+	if (Map::IsInside(p) && tile(p).BlocksLight() != val) {
+		tile(p).SetBlocksLight(val);
+		visibility->TileChanged(p);
+	}
 }
 
 bool Map::LineOfSight(const Coordinate& a, const Coordinate& b) {
@@ -282,7 +340,7 @@ void Map::Reset() {
 void Map::Mark(const Coordinate& p) { tile(p).Mark(); }
 void Map::Unmark(const Coordinate& p) { tile(p).Unmark(); }
 
-int Map::GetMoveModifier(const Coordinate& p) {
+int Map::GetMoveModifier(const Coordinate& p, Random::Generator& rng) {
 	int modifier = 0;
 
 	boost::shared_ptr<Construction> construction;
@@ -303,7 +361,7 @@ int Map::GetMoveModifier(const Coordinate& p) {
 	if (construction && !bridge) modifier += construction->GetMoveSpeedModifier();
 
 	//Other critters slow down movement
-	if (tile(p).npcList.size() > 0) modifier += 2 + Random::Generate(tile(p).npcList.size() - 1);
+	if (tile(p).npcList.size() > 0) modifier += 2 + rng.Generate(tile(p).npcList.size() - 1);
 
 	return modifier;
 }
@@ -329,11 +387,11 @@ void Map::Corrupt(const Coordinate& pos, int magnitude) {
 
 			if (tile(p).corruption >= 100) {
 				if (tile(p).natureObject >= 0 && 
-					!NatureObject::Presets[Game::Inst()->natureList[tile(p).natureObject]->Type()].evil &&
-					!boost::iequals(Game::Inst()->natureList[tile(p).natureObject]->Name(),"Withering tree") &&
-					!Game::Inst()->natureList[tile(p).natureObject]->IsIce()) {
-						bool createTree = Game::Inst()->natureList[tile(p).natureObject]->Tree();
-						Game::Inst()->RemoveNatureObject(Game::Inst()->natureList[tile(p).natureObject]);
+					!NatureObject::Presets[Game::Inst()->natureList.Get(tile(p).natureObject)->Type()].evil &&
+					!boost::iequals(Game::Inst()->natureList.Get(tile(p).natureObject)->Name(),"Withering tree") &&
+					!Game::Inst()->natureList.Get(tile(p).natureObject)->IsIce()) {
+						bool createTree = Game::Inst()->natureList.Get(tile(p).natureObject)->Tree();
+						Game::Inst()->RemoveNatureObject(Game::Inst()->natureList.Get(tile(p).natureObject));
 						if (createTree && Random::Generate(6) < 1) Game::Inst()->CreateNatureObject(p, "Withering tree");
 				}
 			}
@@ -738,16 +796,36 @@ Coordinate Map::FindRangedAdvantage(const Coordinate& center) {
 }
 
 void Map::UpdateCache() {
-	boost::unique_lock<boost::shared_mutex> writeLock(cacheMutex);
+	/* The pathing threads hold the read lock for a whole search. Rather than wait for them the
+	changes are held back to the next tick, unless that's already been going on for a while */
+	boost::unique_lock<boost::shared_mutex> writeLock(cacheMutex, boost::try_to_lock);
+	if (!writeLock.owns_lock()) {
+		if (++deferredCacheUpdates < MAX_DEFERRED_CACHE_UPDATES) return;
+		writeLock.lock();
+	}
+	deferredCacheUpdates = 0;
+
 	for (boost::unordered_set<Coordinate>::iterator tilei = changedTiles.begin(); tilei != changedTiles.end();) {
-		cachedTile(*tilei) = tile(*tilei);
+		CacheTile old = cachedTile(*tilei);
+		CacheTile& updated = cachedTile(*tilei);
+		updated = tile(*tilei);
+		bool costChanged = updated.GetMoveCost() != old.GetMoveCost();
+		if (costChanged) pathGraph->TileChanged(*tilei);
+		connectivity->TileChanged(*tilei, updated.IsWalkable(), updated.HasDoor());
+		//Doors and traps only cost extra for some NPCs, and trap visibility isn't cached at all
+		if (costChanged || updated.HasDoor() != old.HasDoor() || updated.HasTrap()) {
+			flowFields->TileChanged(*tilei);
+			pathCache->TileChanged(*tilei);
+		}
 		tilei = changedTiles.erase(tilei);
 	}
+	pathGraph->Update();
+	connectivity->Update();
 }
 
 bool Map::IsDangerousCache(const Coordinate& p, int faction) const {
 	if (Map::IsInside(p)) {
-		if (cachedTile(p).fire) return true;
+		if (cachedTile(p).OnFire()) return true;
 		if (faction >= 0 && faction < Faction::factions.size())
 			return Faction::factions[faction]->IsTrapVisible(p);
 	}
@@ -760,37 +838,187 @@ void Map::TileChanged(const Coordinate& p) {
 	}
 }
 
-void Map::save(OutputArchive& ar, const unsigned int version) const {
-	for (size_t x = 0; x < tileMap.size(); ++x) {
-		for (size_t y = 0; y < tileMap[x].size(); ++y) {
-			ar & tileMap[x][y];
+namespace {
+	enum TileFlag {
+		TILE_VIS = 1 << 0,
+		TILE_WALKABLE = 1 << 1,
+		TILE_BUILDABLE = 1 << 2,
+		TILE_LOW = 1 << 3,
+		TILE_BLOCKSWATER = 1 << 4,
+		TILE_MARKED = 1 << 5,
+		TILE_TERRITORY = 1 << 6
+	};
+
+	//Tile fields that are saved as runs of equal values
+	enum TilePlane {
+		PLANE_TYPE,
+		PLANE_FLAGS,
+		PLANE_MOVECOST,
+		PLANE_CONSTRUCTION,
+		PLANE_GRAPHIC,
+		PLANE_NATUREOBJECT,
+		PLANE_WALKEDOVER,
+		PLANE_CORRUPTION,
+		PLANE_BURNT,
+		PLANE_FLOW,
+		PLANE_COUNT
+	};
+
+	//Most of these are the same for long stretches of the map, so they're stored as (length, value) pairs
+	std::vector<int> EncodeRuns(const std::vector<int>& values) {
+		std::vector<int> runs;
+		for (size_t i = 0; i < values.size();) {
+			size_t end = i + 1;
+			while (end < values.size() && values[end] == values[i]) ++end;
+			runs.push_back(static_cast<int>(end - i));
+			runs.push_back(values[i]);
+			i = end;
+		}
+		return runs;
+	}
+
+	void DecodeRuns(const std::vector<int>& runs, std::vector<int>& values) {
+		values.clear();
+		for (size_t i = 0; i + 1 < runs.size(); i += 2) {
+			if (runs[i] <= 0) throw std::runtime_error("Invalid run in map data");
+			values.insert(values.end(), runs[i], runs[i+1]);
+		}
+	}
+
+	//Tiles with a non-empty set, as the index difference from the previous such tile, the set's size and then its contents
+	void EncodeSets(const std::vector<const std::set<int>*>& sets, std::vector<int>& sparse) {
+		int last = 0;
+		for (size_t i = 0; i < sets.size(); ++i) {
+			if (sets[i]->empty()) continue;
+			sparse.push_back(static_cast<int>(i) - last);
+			sparse.push_back(static_cast<int>(sets[i]->size()));
+			sparse.insert(sparse.end(), sets[i]->begin(), sets[i]->end());
+			last = static_cast<int>(i);
+		}
+	}
+
+	template <class T>
+	void SaveNodes(OutputArchive& ar, const std::vector<const boost::shared_ptr<T>*>& nodes) {
+		int count = 0;
+		for (size_t i = 0; i < nodes.size(); ++i) if (*nodes[i]) ++count;
+		ar & count;
+		int last = 0;
+		for (size_t i = 0; i < nodes.size(); ++i) {
+			if (!*nodes[i]) continue;
+			int step = static_cast<int>(i) - last;
+			ar & step;
+			ar & *nodes[i];
+			last = static_cast<int>(i);
+		}
+	}
+
+	template <class T>
+	void LoadNodes(InputArchive& ar, const std::vector<boost::shared_ptr<T>*>& nodes) {
+		int count;
+		ar & count;
+		int index = 0;
+		for (int i = 0; i < count; ++i) {
+			int step;
+			ar & step;
+			index += step;
+			if (index < 0 || index >= static_cast<int>(nodes.size())) throw std::runtime_error("Invalid node position in map data");
+			ar & *nodes[index];
 		}
 	}
+}
+
+/* Tiles are saved a field at a time over the whole map rather than a tile at a time, which keeps
+the archive from having to go through every tile's sets and pointers one by one. Tile order is
+x-major, the same as tileMap */
+void Map::save(OutputArchive& ar, const unsigned int version) const {
 	const int width = extent.X();
 	const int height = extent.Y();
 	ar & width;
 	ar & height;
+
+	const size_t count = static_cast<size_t>(width) * height;
+	std::vector<std::vector<int> > planes(PLANE_COUNT, std::vector<int>(count));
+	std::vector<unsigned char> colors(count * 9);
+	std::vector<const std::set<int>*> npcSets(count), itemSets(count);
+	std::vector<const boost::shared_ptr<WaterNode>*> water(count);
+	std::vector<const boost::shared_ptr<FilthNode>*> filth(count);
+	std::vector<const boost::shared_ptr<BloodNode>*> blood(count);
+	std::vector<const boost::shared_ptr<FireNode>*> fire(count);
+	std::vector<float> heights(count);
+
+	size_t i = 0;
+	for (int x = 0; x < width; ++x) {
+		for (int y = 0; y < height; ++y, ++i) {
+			const Tile& t = tileMap[x][y];
+			planes[PLANE_TYPE][i] = t.type;
+			planes[PLANE_FLAGS][i] = (t.vis ? TILE_VIS : 0) | (t.walkable ? TILE_WALKABLE : 0) |
+				(t.buildable ? TILE_BUILDABLE : 0) | (t.low ? TILE_LOW : 0) | (t.blocksWater ? TILE_BLOCKSWATER : 0) |
+				(t.marked ? TILE_MARKED : 0) | (t.territory ? TILE_TERRITORY : 0);
+			planes[PLANE_MOVECOST][i] = t.moveCost;
+			planes[PLANE_CONSTRUCTION][i] = t.construction;
+			planes[PLANE_GRAPHIC][i] = t.graphic;
+			planes[PLANE_NATUREOBJECT][i] = t.natureObject;
+			planes[PLANE_WALKEDOVER][i] = t.walkedOver;
+			planes[PLANE_CORRUPTION][i] = t.corruption;
+			planes[PLANE_BURNT][i] = t.burnt;
+			planes[PLANE_FLOW][i] = t.flow;
+
+			//One plane per color channel
+			const TCODColor* tileColors[3] = { &t.foreColor, &t.originalForeColor, &t.backColor };
+			for (int c = 0; c < 3; ++c) {
+				colors[(c*3 + 0) * count + i] = tileColors[c]->r;
+				colors[(c*3 + 1) * count + i] = tileColors[c]->g;
+				colors[(c*3 + 2) * count + i] = tileColors[c]->b;
+			}
+
+			npcSets[i] = &t.npcList;
+			itemSets[i] = &t.itemList;
+			water[i] = &t.water;
+			filth[i] = &t.filth;
+			blood[i] = &t.blood;
+			fire[i] = &t.fire;
+			heights[i] = heightMap->getValue(x, y);
+		}
+	}
+
+	for (int plane = 0; plane < PLANE_COUNT; ++plane) {
+		const std::vector<int> runs = EncodeRuns(planes[plane]);
+		ar & runs;
+	}
+	ar & colors;
+	std::vector<int> npcs, items;
+	EncodeSets(npcSets, npcs);
+	EncodeSets(itemSets, items);
+	ar & npcs;
+	ar & items;
+	SaveNodes(ar, water);
+	SaveNodes(ar, filth);
+	SaveNodes(ar, blood);
+	SaveNodes(ar, fire);
+	ar & heights;
+
 	ar & mapMarkers;
 	ar & markerids;
 	ar & weather;
-	for (size_t x = 0; x < tileMap.size(); ++x) {
-		for (size_t y = 0; y < tileMap[x].size(); ++y) {
-			float heightMapValue = heightMap->getValue(x, y);
-			ar & heightMapValue;
-		}
-	}
 }
 
 void Map::load(InputArchive& ar, const unsigned int version) {
-	for (size_t x = 0; x < tileMap.size(); ++x) {
-		for (size_t y = 0; y < tileMap[x].size(); ++y) {
-			ar & tileMap[x][y];
+	if (version < 3) {
+		for (size_t x = 0; x < tileMap.size(); ++x) {
+			for (size_t y = 0; y < tileMap[x].size(); ++y) {
+				ar & tileMap[x][y];
+			}
 		}
 	}
 	int width, height;
 	ar & width;
 	ar & height;
 	extent = Coordinate(width, height);
+	if (version >= 3) {
+		if (width != static_cast<int>(tileMap.size()) || height != static_cast<int>(tileMap[0].size()))
+			throw std::runtime_error("Map size doesn't match");
+		LoadTiles(ar);
+	}
 	ar & mapMarkers;
 	ar & markerids;
 	if (version == 0) {
@@ -800,16 +1028,127 @@ void Map::load(InputArchive& ar, const unsigned int version) {
 	if (version >= 1) {
 		ar & weather;
 	}
-	if (version >= 2) {
+	if (version == 2) {
 		for (size_t x = 0; x < tileMap.size(); ++x) {
 			for (size_t y = 0; y < tileMap[x].size(); ++y) {
 				float heightMapValue;
 				ar & heightMapValue;
 				heightMap->setValue(x, y, heightMapValue);
-
-				//Mark every tile as changed so the cached map gets completely updated on load
+			}
+		}
+	}
+	if (version >= 2) {
+		//Mark every tile as changed so the cached map gets completely updated on load
+		for (size_t x = 0; x < tileMap.size(); ++x) {
+			for (size_t y = 0; y < tileMap[x].size(); ++y) {
 				changedTiles.insert(Coordinate(x,y));
 			}
 		}
 	}
+
+	for (size_t x = 0; x < tileMap.size(); ++x) {
+		for (size_t y = 0; y < tileMap[x].size(); ++y) {
+			Coordinate p(x, y);
+			UpdateWaterTerrain(p);
+			boost::shared_ptr<WaterNode> water = tile(p).GetWater().lock();
+			waterNodes[y * extent.X() + x] = water.get();
+			if (water) waterChunks->Add(water);
+		}
+	}
+}
+
+void Map::LoadTiles(InputArchive& ar) {
+	const int width = extent.X();
+	const int height = extent.Y();
+	const size_t count = static_cast<size_t>(width) * height;
+
+	std::vector<std::vector<int> > planes(PLANE_COUNT);
+	for (int plane = 0; plane < PLANE_COUNT; ++plane) {
+		std::vector<int> runs;
+		ar & runs;
+		DecodeRuns(runs, planes[plane]);
+		if (planes[plane].size() != count) throw std::runtime_error("Map data doesn't cover the map");
+	}
+	std::vector<unsigned char> colors;
+	ar & colors;
+	if (colors.size() != count * 9) throw std::runtime_error("Map colors don't cover the map");
+
+	std::vector<boost::shared_ptr<WaterNode>*> water(count);
+	std::vector<boost::shared_ptr<FilthNode>*> filth(count);
+	std::vector<boost::shared_ptr<BloodNode>*> blood(count);
+	std::vector<boost::shared_ptr<FireNode>*> fire(count);
+	std::vector<std::set<int>*> npcSets(count), itemSets(count);
+
+	size_t i = 0;
+	for (int x = 0; x < width; ++x) {
+		for (int y = 0; y < height; ++y, ++i) {
+			Tile& t = tileMap[x][y];
+			t.type = static_cast<TileType>(planes[PLANE_TYPE][i]);
+			int flags = planes[PLANE_FLAGS][i];
+			t.vis = (flags & TILE_VIS) != 0;
+			t.walkable = (flags & TILE_WALKABLE) != 0;
+			t.buildable = (flags & TILE_BUILDABLE) != 0;
+			t.low = (flags & TILE_LOW) != 0;
+			t.blocksWater = (flags & TILE_BLOCKSWATER) != 0;
+			t.marked = (flags & TILE_MARKED) != 0;
+			t.territory = (flags & TILE_TERRITORY) != 0;
+			t.moveCost = planes[PLANE_MOVECOST][i];
+			t.construction = planes[PLANE_CONSTRUCTION][i];
+			t.graphic = planes[PLANE_GRAPHIC][i];
+			t.natureObject = planes[PLANE_NATUREOBJECT][i];
+			t.walkedOver = planes[PLANE_WALKEDOVER][i];
+			t.corruption = planes[PLANE_CORRUPTION][i];
+			t.burnt = planes[PLANE_BURNT][i];
+			t.flow = static_cast<Direction>(planes[PLANE_FLOW][i]);
+
+			TCODColor* tileColors[3] = { &t.foreColor, &t.originalForeColor, &t.backColor };
+			for (int c = 0; c < 3; ++c) {
+				tileColors[c]->r = colors[(c*3 + 0) * count + i];
+				tileColors[c]->g = colors[(c*3 + 1) * count + i];
+				tileColors[c]->b = colors[(c*3 + 2) * count + i];
+			}
+
+			t.npcList.clear();
+			t.itemList.clear();
+			npcSets[i] = &t.npcList;
+			itemSets[i] = &t.itemList;
+			water[i] = &t.water;
+			filth[i] = &t.filth;
+			blood[i] = &t.blood;
+			fire[i] = &t.fire;
+		}
+	}
+
+	std::vector<int> sparse[2];
+	ar & sparse[0];
+	ar & sparse[1];
+	std::vector<std::set<int>*>* targets[2] = { &npcSets, &itemSets };
+	for (int list = 0; list < 2; ++list) {
+		const std::vector<int>& entries = sparse[list];
+		int index = 0;
+		for (size_t e = 0; e + 1 < entries.size();) {
+			index += entries[e];
+			int size = entries[e+1];
+			e += 2;
+			if (index < 0 || index >= static_cast<int>(count) || size < 0 || e + size > entries.size())
+				throw std::runtime_error("Invalid entity list in map data");
+			(*targets[list])[index]->insert(entries.begin() + e, entries.begin() + e + size);
+			e += size;
+		}
+	}
+
+	LoadNodes(ar, water);
+	LoadNodes(ar, filth);
+	LoadNodes(ar, blood);
+	LoadNodes(ar, fire);
+
+	std::vector<float> heights;
+	ar & heights;
+	if (heights.size() != count) throw std::runtime_error("Height map doesn't cover the map");
+	i = 0;
+	for (int x = 0; x < width; ++x) {
+		for (int y = 0; y < height; ++y, ++i) {
+			heightMap->setValue(x, y, heights[i]);
+		}
+	}
 }
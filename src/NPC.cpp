@@ -16,6 +16,7 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include "stdafx.hpp"
 
 #include <cstdlib>
+#include <climits>
 #include <string>
 #include <boost/serialization/split_member.hpp>
 #include <boost/thread/thread.hpp>
@@ -47,6 +48,9 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include "Stockpile.hpp"
 #include "Faction.hpp"
 #include "Stats.hpp"
+#include "NPCGrid.hpp"
+#include "Visibility.hpp"
+#include "FieldOfView.hpp"
 
 SkillSet::SkillSet() {
 	for (int i = 0; i < SKILLAMOUNT; ++i) { skills[i] = 0; }
@@ -123,15 +127,26 @@ NPC::NPC(Coordinate pos, boost::function<bool(boost::shared_ptr<NPC>)> findJob,
 	escaped(false),
 
 	addedTasksToCurrentJob(0),
+	decisionWait(0),
 
 	hasMagicRangedAttacks(false),
 
 	threatLocation(undefined),
 	seenFire(false),
+	fovTimer(0),
+	fireLocation(undefined),
+	inGrid(false),
+	gridFaction(-1),
 
 	traits(std::set<Trait>()),
 	damageDealt(0), damageReceived(0),
-	statusEffectsChanged(false)
+	statusEffectsChanged(false),
+	rng(Random::Generate(0, INT_MAX - 1)),
+	statsChanged(true),
+	cachedDiseaseModifier(0), cachedArmor(-1),
+	effectTimersChanged(true),
+	lastEffectTimer(0),
+	randomEventsScheduled(false)
 {
 	this->pos = pos;
 	inventory->SetInternal();
@@ -139,23 +154,24 @@ NPC::NPC(Coordinate pos, boost::function<bool(boost::shared_ptr<NPC>)> findJob,
 	thirst = thirst - (THIRST_THRESHOLD / 2) + Random::Generate(THIRST_THRESHOLD - 1);
 	hunger = hunger - (HUNGER_THRESHOLD / 2) + Random::Generate(HUNGER_THRESHOLD - 1);
 	weariness = weariness - (WEARY_THRESHOLD / 2) + Random::Generate(WEARY_THRESHOLD - 1);
+	timeCount = Random::Generate(UPDATES_PER_SECOND - 1); //Spread out the ticks different NPCs think on
 
-	for (int i = 0; i < STAT_COUNT; ++i) {baseStats[i] = 0; effectiveStats[i] = 0;}
-	for (int i = 0; i < RES_COUNT; ++i) {baseResistances[i] = 0; effectiveResistances[i] = 0;}
+	for (int i = 0; i < STAT_COUNT; ++i) {baseStats[i] = 0; effectiveStats[i] = 0; cachedStats[i] = 0;}
+	for (int i = 0; i < RES_COUNT; ++i) {baseResistances[i] = 0; effectiveResistances[i] = 0; cachedResistances[i] = 0;}
 }
 
 NPC::~NPC() {
-	pathMutex.lock(); /* In case a pathing thread is active we need to wait until we can lock the pathMutex,
-					  because it signals that the thread has finished */
+	/* In case a pathing worker is busy with our request we need to wait until it's done,
+	it's using this NPC for the walk cost callbacks */
+	if (pathRequest) pathRequest->CancelAndWait();
+
 	map->NPCList(pos)->erase(uid);
+	if (inGrid) map->npcGrid->Remove(this, gridPos, gridFaction);
 	if (squad.lock()) squad.lock()->Leave(uid);
 
 	if (boost::iequals(NPC::NPCTypeToString(type), "orc")) Game::Inst()->OrcCount(-1);
 	else if (boost::iequals(NPC::NPCTypeToString(type), "goblin")) Game::Inst()->GoblinCount(-1);
 	else if (NPC::Presets[type].tags.find("localwildlife") != NPC::Presets[type].tags.end()) Game::Inst()->PeacefulFaunaCount(-1);
-
-    pathMutex.unlock();
-	delete path;
 }
 
 void NPC::SetMap(Map* map) {
@@ -165,18 +181,25 @@ void NPC::SetMap(Map* map) {
 		pos += Random::ChooseInRadius(1);
 	}
 	Position(pos,true);
-
-	path = new TCODPath(map->Width(), map->Height(), map, static_cast<void*>(this));
 }
 
 void NPC::Position(const Coordinate& p, bool firstTime) {
 	map->MoveTo(p, uid);
 	if (!firstTime)
 		map->MoveFrom(pos, uid);
+	FileInGrid(p);
 	pos = p;
 	inventory->Position(pos);
 }
 
+void NPC::FileInGrid(const Coordinate& p) {
+	if (inGrid) map->npcGrid->Move(this, gridPos, gridFaction, p, faction);
+	else map->npcGrid->Add(this, p, faction);
+	inGrid = true;
+	gridPos = p;
+	gridFaction = faction;
+}
+
 void NPC::Position(const Coordinate& pos) { Position(pos, false); }
 
 Task* NPC::currentTask() const { return jobs.empty() ? 0 : &(jobs.front()->tasks[taskIndex]); }
@@ -353,26 +376,25 @@ void NPC::HandleWeariness() {
 	}
 }
 
-void NPC::Update() {
+/* The part of the update that only touches this NPC, which is run for all of them in parallel.
+Anything that reaches further is left in commands for Apply to do on the game thread. Rolls come
+from the NPC's own generator so the outcome doesn't depend on how the NPCs were split up */
+void NPC::UpdateState(std::vector<NPCCommand>& commands) {
 	if (map->NPCList(pos)->size() > 1) _bgcolor = TCODColor::darkGrey;
 	else _bgcolor = TCODColor::black;
 
-	UpdateStatusEffects();
-	//Apply armor effects if present
-	if (boost::shared_ptr<Item> arm = armor.lock()) {
-		for (int i = 0; i < RES_COUNT; ++i) {
-			effectiveResistances[i] += arm->Resistance(i);
-		}
-	}
+	if (fovTimer > 0) --fovTimer;
 
-	if (Random::Generate(UPDATES_PER_SECOND) == 0) { //Recalculate bulk once a second, items may get unexpectedly destroyed
+	UpdateStatusEffects(commands);
+
+	if (rng.Generate(UPDATES_PER_SECOND) == 0) { //Recalculate bulk once a second, items may get unexpectedly destroyed
 		bulk = 0;
 		for (std::set<boost::weak_ptr<Item> >::iterator itemi = inventory->begin(); itemi != inventory->end(); ++itemi) {
 			if (itemi->lock())
 				bulk += itemi->lock()->GetBulk();
 		}
 	}
-	if (!HasEffect(FLYING) && effectiveStats[MOVESPEED] > 0) effectiveStats[MOVESPEED] = std::max(1, effectiveStats[MOVESPEED]-map->GetMoveModifier(pos));
+	if (!HasEffect(FLYING) && effectiveStats[MOVESPEED] > 0) effectiveStats[MOVESPEED] = std::max(1, effectiveStats[MOVESPEED]-map->GetMoveModifier(pos, rng));
 	if (effectiveStats[MOVESPEED] > 0) effectiveStats[MOVESPEED] = std::max(1, effectiveStats[MOVESPEED]-bulk);
 
 	if (needsNutrition) {
@@ -384,12 +406,12 @@ void NPC::Update() {
 		if (hunger >= HUNGER_THRESHOLD) AddEffect(HUNGER);
 		else RemoveEffect(HUNGER);
 
-		if (thirst > THIRST_THRESHOLD && Random::Generate(UPDATES_PER_SECOND * 5 - 1) == 0) {
-			HandleThirst();
-		} else if (thirst > THIRST_THRESHOLD * 2) Kill(GetDeathMsgThirst());
-		if (hunger > HUNGER_THRESHOLD && Random::Generate(UPDATES_PER_SECOND * 5 - 1) == 0) {
-			HandleHunger();
-		} else if (hunger > 72000) Kill(GetDeathMsgHunger());
+		if (thirst > THIRST_THRESHOLD && rng.Generate(UPDATES_PER_SECOND * 5 - 1) == 0) {
+			commands.push_back(NPCCommand(this, NPCCommand::HANDLETHIRST));
+		} else if (thirst > THIRST_THRESHOLD * 2) commands.push_back(NPCCommand(this, NPCCommand::DIEOFTHIRST));
+		if (hunger > HUNGER_THRESHOLD && rng.Generate(UPDATES_PER_SECOND * 5 - 1) == 0) {
+			commands.push_back(NPCCommand(this, NPCCommand::HANDLEHUNGER));
+		} else if (hunger > 72000) commands.push_back(NPCCommand(this, NPCCommand::DIEOFHUNGER));
 	}
 
 	if (needsSleep) {
@@ -397,7 +419,7 @@ void NPC::Update() {
 
 		if (weariness >= WEARY_THRESHOLD) { 
 			AddEffect(DROWSY);
-			if (weariness > WEARY_THRESHOLD) HandleWeariness(); //Give the npc a chance to find a sleepiness curing item
+			if (weariness > WEARY_THRESHOLD) commands.push_back(NPCCommand(this, NPCCommand::HANDLEWEARINESS)); //Give the npc a chance to find a sleepiness curing item
 		} else RemoveEffect(DROWSY);
 	}
 
@@ -411,21 +433,35 @@ void NPC::Update() {
 		} else { RemoveEffect(SWIM); }
 
 		if (map->GetNatureObject(pos) >= 0 && 
-			Game::Inst()->natureList[map->GetNatureObject(pos)]->IsIce() &&
-			Random::Generate(UPDATES_PER_SECOND*5) == 0) AddEffect(TRIPPED);
+			Game::Inst()->natureList.Get(map->GetNatureObject(pos))->IsIce() &&
+			rng.Generate(UPDATES_PER_SECOND*5) == 0) AddEffect(TRIPPED);
 	}
 
 	for (std::list<Attack>::iterator attacki = attacks.begin(); attacki != attacks.end(); ++attacki) {
 		attacki->Update();
 	}
 
-	if (faction == PLAYERFACTION && Random::Generate(MONTH_LENGTH - 1) == 0) Game::Inst()->CreateFilth(Position());
-
 	if (carried.lock()) {
 		AddEffect(StatusEffect(CARRYING, carried.lock()->GetGraphic(), carried.lock()->Color()));
 	} else RemoveEffect(CARRYING);
+}
+
+void NPC::Apply(const NPCCommand& command) {
+	switch (command.type) {
+	case NPCCommand::HANDLETHIRST: HandleThirst(); break;
+	case NPCCommand::HANDLEHUNGER: HandleHunger(); break;
+	case NPCCommand::HANDLEWEARINESS: HandleWeariness(); break;
+	case NPCCommand::DIEOFTHIRST: Kill(GetDeathMsgThirst()); break;
+	case NPCCommand::DIEOFHUNGER: Kill(GetDeathMsgHunger()); break;
+	}
+}
+
+//What's left of the update after UpdateState, on the game thread
+void NPC::Update() {
+	if (effectTimersChanged) ScheduleEffectDamage();
+	if (!randomEventsScheduled) ScheduleRandomEvents();
+	HandleStatusEffects();
 
-	if (HasTrait(CRACKEDSKULL) && Random::Generate(MONTH_LENGTH * 6) == 0) GoBerserk();
 	if (HasEffect(BURNING)) {
 		if (Random::Generate(UPDATES_PER_SECOND * 3) == 0) {
 			boost::shared_ptr<Spell> spark = Game::Inst()->CreateSpell(Position(), Spell::StringToSpellType("spark"));
@@ -450,7 +486,7 @@ void NPC::Update() {
 	UpdateHealth();
 }
 
-void NPC::UpdateStatusEffects() {
+void NPC::UpdateStatusEffects(std::vector<NPCCommand>& commands) {
 	//Add job related effects
 	if (!jobs.empty()) {
 		for (std::list<StatusEffectType>::iterator stati = jobs.front()->statusEffects.begin();
@@ -459,38 +495,78 @@ void NPC::UpdateStatusEffects() {
 		}
 	}
 
-	for (int i = 0; i < STAT_COUNT; ++i) {
-		effectiveStats[i] = baseStats[i];
-	}
-	for (int i = 0; i < RES_COUNT; ++i) {
-		effectiveResistances[i] = baseResistances[i];
-	}
-	
-	if (factionPtr->IsFriendsWith(PLAYERFACTION)) effectiveResistances[DISEASE_RES] = std::max(0, effectiveResistances[DISEASE_RES] - Camp::Inst()->GetDiseaseModifier());
+	//The effective stats only need working out again when something they depend on has changed
+	int diseaseModifier = factionPtr->IsFriendsWith(PLAYERFACTION) ? Camp::Inst()->GetDiseaseModifier() : 0;
+	boost::shared_ptr<Item> arm = armor.lock();
+	int armorUid = arm ? arm->Uid() : -1;
+	if (statsChanged || diseaseModifier != cachedDiseaseModifier || armorUid != cachedArmor) {
+		statsChanged = false;
+		cachedDiseaseModifier = diseaseModifier;
+		cachedArmor = armorUid;
 
-	++statusGraphicCounter;
-	for (std::list<StatusEffect>::iterator statusEffectI = statusEffects.begin(); statusEffectI != statusEffects.end();) {
-		//Apply effects to stats
 		for (int i = 0; i < STAT_COUNT; ++i) {
-			effectiveStats[i] = (int)(effectiveStats[i] * statusEffectI->statChanges[i]);
+			cachedStats[i] = baseStats[i];
 		}
 		for (int i = 0; i < RES_COUNT; ++i) {
-			effectiveResistances[i] = (int)(effectiveResistances[i] * statusEffectI->resistanceChanges[i]);
+			cachedResistances[i] = baseResistances[i];
 		}
+		if (diseaseModifier != 0) cachedResistances[DISEASE_RES] = std::max(0, cachedResistances[DISEASE_RES] - diseaseModifier);
 
-		if (statusEffectI->damage.second != 0 && --statusEffectI->damage.first <= 0) {
-			statusEffectI->damage.first = UPDATES_PER_SECOND;
-			TCOD_dice_t dice;
-			dice.addsub = (float)statusEffectI->damage.second;
-			dice.multiplier = 1;
-			dice.nb_rolls = 1;
-			dice.nb_faces = std::max(1, (int)dice.addsub / 5);
-			Attack attack;
-			attack.Amount(dice);
-			attack.Type((DamageType)statusEffectI->damageType);
-			Damage(&attack);
+		for (std::list<StatusEffect>::iterator statusEffectI = statusEffects.begin(); statusEffectI != statusEffects.end(); ++statusEffectI) {
+			for (int i = 0; i < STAT_COUNT; ++i) {
+				cachedStats[i] = (int)(cachedStats[i] * statusEffectI->statChanges[i]);
+			}
+			for (int i = 0; i < RES_COUNT; ++i) {
+				cachedResistances[i] = (int)(cachedResistances[i] * statusEffectI->resistanceChanges[i]);
+			}
+		}
+
+		if (arm) {
+			for (int i = 0; i < RES_COUNT; ++i) {
+				cachedResistances[i] += arm->Resistance(i);
+			}
+		}
+	}
+	std::copy(cachedStats, cachedStats + STAT_COUNT, effectiveStats);
+	std::copy(cachedResistances, cachedResistances + RES_COUNT, effectiveResistances);
+
+	++statusGraphicCounter;
+	for (std::list<StatusEffect>::iterator statusEffectI = statusEffects.begin(); statusEffectI != statusEffects.end();) {
+		//Remove the statuseffect if its cooldown has run out
+		if (statusEffectI->cooldown > 0 && --statusEffectI->cooldown == 0) {
+			if (statusEffectI == statusEffectIterator) {
+				++statusEffectIterator;
+				statusGraphicCounter = 0;
+			}
+			statusEffectI = statusEffects.erase(statusEffectI);
+			if (statusEffectIterator == statusEffects.end()) statusEffectIterator = statusEffects.begin();
+			statsChanged = true;
+		} else ++statusEffectI;
+	}
+	
+	if (statusGraphicCounter > 10) {
+		statusGraphicCounter = 0;
+		if (statusEffectIterator != statusEffects.end()) ++statusEffectIterator;
+		else statusEffectIterator = statusEffects.begin();
+
+		if (statusEffectIterator != statusEffects.end() && !statusEffectIterator->visible) {
+			std::list<StatusEffect>::iterator oldIterator = statusEffectIterator;
+			++statusEffectIterator;
+			while (statusEffectIterator != oldIterator) {
+				if (statusEffectIterator != statusEffects.end()) {
+					if (statusEffectIterator->visible) break;
+					++statusEffectIterator;
+				}
+				else statusEffectIterator = statusEffects.begin();
+			}
+			if (statusEffectIterator != statusEffects.end() && !statusEffectIterator->visible) statusEffectIterator = statusEffects.end();
 		}
+	}
+}
 
+//Effects that need to look for items or other NPCs
+void NPC::HandleStatusEffects() {
+	for (std::list<StatusEffect>::iterator statusEffectI = statusEffects.begin(); statusEffectI != statusEffects.end(); ++statusEffectI) {
 		if (factionPtr->IsFriendsWith(PLAYERFACTION) && statusEffectI->negative && !HasEffect(SLEEPING) && (statusEffectsChanged || Random::Generate(MONTH_LENGTH) == 0)) {
 			statusEffectsChanged = false;
 			bool removalJobFound = false;
@@ -531,44 +607,66 @@ void NPC::UpdateStatusEffects() {
 					}
 			}
 		}
+	}
+}
 
-		//Remove the statuseffect if its cooldown has run out
-		if (statusEffectI->cooldown > 0 && --statusEffectI->cooldown == 0) {
-			if (statusEffectI == statusEffectIterator) {
-				++statusEffectIterator;
-				statusGraphicCounter = 0;
-			}
-			statusEffectI = statusEffects.erase(statusEffectI);
-			if (statusEffectIterator == statusEffects.end()) statusEffectIterator = statusEffects.begin();
-		} else ++statusEffectI;
+//Damaging effects hurt on a timer instead of counting down every tick
+void NPC::ScheduleEffectDamage() {
+	effectTimersChanged = false;
+	for (std::list<StatusEffect>::iterator statusEffectI = statusEffects.begin(); statusEffectI != statusEffects.end(); ++statusEffectI) {
+		if (statusEffectI->damage.second != 0 && statusEffectI->damageTimer == 0) {
+			statusEffectI->damageTimer = ++lastEffectTimer;
+			Game::Inst()->Timers()->Schedule(statusEffectI->damage.first, boost::bind(&NPC::EffectDamage,
+				boost::weak_ptr<NPC>(boost::static_pointer_cast<NPC>(shared_from_this())), statusEffectI->type, statusEffectI->damageTimer));
+		}
 	}
-	
-	if (statusGraphicCounter > 10) {
-		statusGraphicCounter = 0;
-		if (statusEffectIterator != statusEffects.end()) ++statusEffectIterator;
-		else statusEffectIterator = statusEffects.begin();
+}
 
-		if (statusEffectIterator != statusEffects.end() && !statusEffectIterator->visible) {
-			std::list<StatusEffect>::iterator oldIterator = statusEffectIterator;
-			++statusEffectIterator;
-			while (statusEffectIterator != oldIterator) {
-				if (statusEffectIterator != statusEffects.end()) {
-					if (statusEffectIterator->visible) break;
-					++statusEffectIterator;
-				}
-				else statusEffectIterator = statusEffects.begin();
-			}
-			if (statusEffectIterator != statusEffects.end() && !statusEffectIterator->visible) statusEffectIterator = statusEffects.end();
+//If the effect is still there the timer is its own, a removed and added again effect has a new one
+void NPC::EffectDamage(boost::weak_ptr<NPC> wnpc, int effectType, int timer) {
+	boost::shared_ptr<NPC> npc = wnpc.lock();
+	if (!npc) return;
+	for (std::list<StatusEffect>::iterator statusEffectI = npc->statusEffects.begin(); statusEffectI != npc->statusEffects.end(); ++statusEffectI) {
+		if (statusEffectI->type == effectType && statusEffectI->damageTimer == timer) {
+			TCOD_dice_t dice;
+			dice.addsub = (float)statusEffectI->damage.second;
+			dice.multiplier = 1;
+			dice.nb_rolls = 1;
+			dice.nb_faces = std::max(1, (int)dice.addsub / 5);
+			Attack attack;
+			attack.Amount(dice);
+			attack.Type((DamageType)statusEffectI->damageType);
+			Game::Inst()->Timers()->Schedule(UPDATES_PER_SECOND, boost::bind(&NPC::EffectDamage, wnpc, effectType, timer));
+			npc->Damage(&attack);
+			return;
 		}
 	}
 }
 
+void NPC::ScheduleRandomEvents() {
+	randomEventsScheduled = true;
+	boost::weak_ptr<NPC> wnpc(boost::static_pointer_cast<NPC>(shared_from_this()));
+	Game::Inst()->Timers()->ScheduleRandom(MONTH_LENGTH, boost::bind(&NPC::FilthEvent, wnpc));
+	Game::Inst()->Timers()->ScheduleRandom(MONTH_LENGTH * 6 + 1, boost::bind(&NPC::CrackedSkullEvent, wnpc));
+}
+
+//Faction and traits can change, so they're checked when the event comes up instead of when it's scheduled
+bool NPC::FilthEvent(boost::weak_ptr<NPC> wnpc) {
+	boost::shared_ptr<NPC> npc = wnpc.lock();
+	if (!npc || npc->dead) return false;
+	if (npc->faction == PLAYERFACTION) Game::Inst()->CreateFilth(npc->Position());
+	return true;
+}
+
+bool NPC::CrackedSkullEvent(boost::weak_ptr<NPC> wnpc) {
+	boost::shared_ptr<NPC> npc = wnpc.lock();
+	if (!npc || npc->dead) return false;
+	if (npc->HasTrait(CRACKEDSKULL)) npc->GoBerserk();
+	return true;
+}
 
 //TODO split that monster into smaller chunks
 void NPC::Think() {
-	Coordinate tmpCoord;
-	int tmp;
-	
 	UpdateVelocity();
 
 	lastMoveResult = Move(lastMoveResult);
@@ -579,7 +677,17 @@ void NPC::Think() {
 		TaskFinished(TASKFAILFATAL, "Flying through the air");
 		JobManager::Inst()->NPCNotWaiting(uid);
 	}
-	
+}
+
+bool NPC::DecisionPending() const { return timeCount > UPDATES_PER_SECOND; }
+
+//The decisions made since the last call, or just one if catchUp is false
+void NPC::Decide(bool catchUp) {
+	Coordinate tmpCoord;
+	int tmp;
+
+	if (!catchUp) timeCount = std::min(timeCount, UPDATES_PER_SECOND + thinkSpeed);
+
 	while (timeCount > UPDATES_PER_SECOND) {
 		if (Random::GenerateBool()) React(boost::static_pointer_cast<NPC>(shared_from_this()));
 
@@ -1443,18 +1551,19 @@ TaskResult NPC::Move(TaskResult oldResult) {
 	}
 	while (nextMove > 100) {
 		nextMove -= 100;
-		boost::mutex::scoped_try_lock pathLock(pathMutex);
-		if (pathLock.owns_lock()) {
+		if (pathRequest && pathRequest->Collect(path, nopath, pathIsDangerous)) {
+			pathRequest.reset();
+			findPathWorking = false;
+		}
+		if (!findPathWorking) {
 			if (nopath) {nopath = false; return TASKFAILFATAL;}
-			if (pathIndex < path->size() && pathIndex >= 0) {
+			if (pathIndex < (signed int)path.size() && pathIndex >= 0) {
 				//Get next move
-				Coordinate move;
-				path->get(pathIndex, move.Xptr(), move.Yptr());
+				Coordinate move = path[pathIndex];
 
-				if (pathIndex != path->size()-1 && map->NPCList(move)->size() > 0) {
+				if (pathIndex != (signed int)path.size()-1 && map->NPCList(move)->size() > 0) {
 					//Our next move target has an npc on it, and it isn't our target
-					Coordinate next;
-					path->get(pathIndex+1, next.Xptr(), next.Yptr());
+					Coordinate next = path[pathIndex+1];
 					/*Find a new target that is adjacent to our current, next, and the next after targets
 					Effectively this makes the npc try and move around another npc, instead of walking onto
 					the same tile and slowing down*/
@@ -1476,47 +1585,50 @@ TaskResult NPC::Move(TaskResult oldResult) {
 					return TASKFAILNONFATAL;
 				}
 				return TASKCONTINUE; //Everything is ok
-			} else if (!findPathWorking) return PATHEMPTY; //No path
+			} else return PATHEMPTY; //No path
 		}
 	}
 	//Can't move yet, so the earlier result is still valid
 	return oldResult;
 }
 
-unsigned int NPC::pathingThreadCount = 0;
-boost::mutex NPC::threadCountMutex;
-void NPC::findPath(Coordinate target) {
-	pathMutex.lock();
+void NPC::findPath(Coordinate target, bool synchronous) {
+	//Any search still in flight is for an old target, the worker will just drop it
+	if (pathRequest) pathRequest->Cancel();
+
 	findPathWorking = true;
+	nopath = false;
 	pathIsDangerous = false;
 	pathIndex = 0;
-	
-	delete path;
-	path = new TCODPath(map->Width(), map->Height(), map, static_cast<void*>(this));
-
-	threadCountMutex.lock();
-	if (pathingThreadCount < 12) {
-		++pathingThreadCount;
-		threadCountMutex.unlock();
-		pathMutex.unlock();
-		boost::thread pathThread(boost::bind(tFindPath, path, pos.X(), pos.Y(), target.X(), target.Y(), this, true));
+	path.clear();
+
+	//No point in searching if the target is in a region we can't get to
+	if (!map->IsReachable(pos, target, static_cast<void*>(this))) {
+		pathRequest.reset();
+		nopath = true;
+		findPathWorking = false;
+		return;
+	}
+
+	pathRequest.reset(new PathRequest(this, pos, target));
+	if (synchronous) {
+		Pathfinder::Inst()->Compute(pathRequest);
+		pathRequest->Collect(path, nopath, pathIsDangerous);
+		pathRequest.reset();
+		findPathWorking = false;
 	} else {
-		threadCountMutex.unlock();
-		pathMutex.unlock();
-		tFindPath(path, pos.X(), pos.Y(), target.X(), target.Y(), this, false);
+		Pathfinder::Inst()->Submit(pathRequest);
 	}
 }
 
 bool NPC::IsPathWalkable() {
-	for (int i = 0; i < path->size(); i++) {
-		Coordinate p;
-		path->get(i, p.Xptr(), p.Yptr());
-		if (!map->IsWalkable(p, static_cast<void*>(this))) return false;
+	for (std::vector<Coordinate>::iterator p = path.begin(); p != path.end(); ++p) {
+		if (!map->IsWalkable(*p, static_cast<void*>(this))) return false;
 	}
 	return true;
 }
 
-void NPC::speed(unsigned int value) {baseStats[MOVESPEED]=value;}
+void NPC::speed(unsigned int value) {baseStats[MOVESPEED]=value; statsChanged = true;}
 unsigned int NPC::speed() const {return effectiveStats[MOVESPEED];}
 
 void NPC::Draw(Coordinate upleft, TCODConsole *console) {
@@ -1618,29 +1730,6 @@ boost::weak_ptr<Entity> NPC::currentEntity() const {
 }
 
 
-void tFindPath(TCODPath *path, int x0, int y0, int x1, int y1, NPC* npc, bool threaded) {
-	boost::mutex::scoped_lock pathLock(npc->pathMutex);
-	boost::shared_lock<boost::shared_mutex> readCacheLock(npc->map->cacheMutex);
-	npc->nopath = !path->compute(x0, y0, x1, y1);
-
-	//TODO factorize with path walkability test
-	for (int i = 0; i < path->size(); ++i) {
-		Coordinate p;
-		path->get(i, p.Xptr(), p.Yptr());
-		if (npc->map->IsDangerousCache(p, npc->faction)) {
-			npc->pathIsDangerous = true;
-			break;//One dangerous tile = whole path considered dangerous
-		}
-	}
-
-	npc->findPathWorking = false;
-	if (threaded) {
-		NPC::threadCountMutex.lock();
-		--NPC::pathingThreadCount;
-		NPC::threadCountMutex.unlock();
-	}
-}
-
 bool NPC::GetSquadJob(boost::shared_ptr<NPC> npc) {
 	if (boost::shared_ptr<Squad> squad = npc->MemberOf().lock()) {
 		JobManager::Inst()->NPCNotWaiting(npc->uid);
@@ -1908,8 +1997,11 @@ void NPC::AddEffect(StatusEffect effect) {
 		}
 	}
 
+	effect.damageTimer = 0; //Transmitted effects come with the old host's timer, this NPC schedules its own
 	statusEffects.push_back(effect);
 	statusEffectsChanged = true;
+	statsChanged = true;
+	if (effect.damage.second != 0) effectTimersChanged = true;
 }
 
 void NPC::RemoveEffect(StatusEffectType effect) {
@@ -1920,6 +2012,7 @@ void NPC::RemoveEffect(StatusEffectType effect) {
 			if (statusEffectIterator == statusEffectI) ++statusEffectIterator;
 			statusEffects.erase(statusEffectI);
 			if (statusEffectIterator == statusEffects.end()) statusEffectIterator = statusEffects.begin();
+			statsChanged = true;
 
 			if (statusEffectIterator != statusEffects.end() && !statusEffectIterator->visible) {
 				std::list<StatusEffect>::iterator oldIterator = statusEffectIterator;
@@ -2552,84 +2645,66 @@ void NPC::AbortJob(boost::weak_ptr<Job> wjob) {
 bool NPC::IsTunneler() const { return isTunneler; }
 
 void NPC::ScanSurroundings(bool onlyHostiles) {
-	/* The algorithm performs in the following, slightly wrong, way:
-
-	   - for each point B at the border of the rectangle at LOS_DISTANCE of the current position C
-	     - for each point P on a line from C to B (from the inside, outwards)
-		   - if there is a non-friend NPC on P, update the threat location
-
-	   This means that, depending on the order of traversal of the rectangle border, the final
-	   threatLocation may not be the closest non-friend NPC: on each line, the threat location was
-	   set to the farthest non-friend NPC.
-
-	   But that's ok, as 'gencontain' explains: « It's not like it matters that much anyway. What's
-	   important is that a cowardly npc runs away from some threat that it sees, not that they
-	   prioritize threats accurately. A goblin seeing a threat further away and running blindly into
-	   a closer one sounds like something a goblin would do. »
+	/* The field of view is shared with everyone standing nearby, NPCs are picked from the map's NPC
+	grid by it instead of walking lines of tiles out from here. Friendly factions are skipped as a
+	whole when only hostiles are of interest */
+	boost::shared_ptr<const FieldOfView> view = map->visibility->View(pos, GetHeight() >= ENTITYHEIGHT);
+	if (fovTimer <= 0 || view != fov) {
+		fov = view;
+		fovTimer = FOV_REFRESH;
+
+		//Constructions and fire don't move around, these can be reused along with the field of view
+		nearConstructions.clear();
+		fireLocation = undefined;
+		Coordinate low = map->Shrink(pos - LOS_DISTANCE);
+		Coordinate high = map->Shrink(pos + LOS_DISTANCE);
+		for (int y = low.Y(); y <= high.Y(); ++y) {
+			for (int x = low.X(); x <= high.X(); ++x) {
+				Coordinate p(x, y);
+				if (!fov->Visible(p)) continue;
+				int constructUid = map->GetConstruction(p);
+				if (constructUid >= 0) {
+					nearConstructions.push_back(Game::Inst()->GetConstruction(constructUid));
+				}
+				if (map->GetFire(p).lock() && (fireLocation == undefined || Distance(p, pos) < Distance(fireLocation, pos))) {
+					fireLocation = p;
+				}
+			}
+		}
+	}
 
-	   If you're not happy with that, just go play chess!
-	*/
 	adjacentNpcs.clear();
 	nearNpcs.clear();
-	nearConstructions.clear();
-	threatLocation = Coordinate(-1,-1);
+	threatLocation = undefined;
 	seenFire = false;
-	bool skipPosition = false; //We should skip checking this npc's position after the first time
-	Coordinate low = map->Shrink(pos - LOS_DISTANCE);
-	Coordinate high = map->Shrink(pos + LOS_DISTANCE);
-	for (int endx = low.X(); endx < high.X(); endx += 2) {
-		for (int endy = low.Y(); endy < high.Y(); endy += 2) {
-			Coordinate end(endx, endy);
-			if (end.onRectangleEdges(low, high)) {
-				int adjacent = 2; //We're going outwards, the first two iterations are considered adjacent to the starting point
-
-				Coordinate p = pos;
-				TCODLine::init(p.X(), p.Y(), end.X(), end.Y());
-
-				if (skipPosition) {
-					TCODLine::step(p.Xptr(), p.Yptr());
-					--adjacent;
-				}
-				skipPosition = true;
-
-				do {
-					/*Check constructions before checking for lightblockage because we can see a wall
-					  even though we can't see through it*/
-					int constructUid = map->GetConstruction(p);
-					if (constructUid >= 0) {
-						nearConstructions.push_back(Game::Inst()->GetConstruction(constructUid));
-					}
-					
-					//Stop moving along this line if our view is blocked
-					if (map->BlocksLight(p) && GetHeight() < ENTITYHEIGHT) break;
-					
-					//Add all the npcs on this tile, or only hostiles if that boolean is set
-					for (std::set<int>::iterator npci = map->NPCList(p)->begin(); npci != map->NPCList(p)->end(); ++npci) {
-						if (*npci != uid) {
-							boost::shared_ptr<NPC> npc = Game::Inst()->GetNPC(*npci);
-							if (!factionPtr->IsFriendsWith(npc->GetFaction())) threatLocation = Coordinate(p);
-							if (!onlyHostiles || !factionPtr->IsFriendsWith(npc->GetFaction())) {
-								nearNpcs.push_back(npc);
-								if (adjacent > 0)
-									adjacentNpcs.push_back(npc);
-							}
-						}
-					}
-					
-					//Only care about fire if we're not flying and/or not effectively immune
-					if (!HasEffect(FLYING) && map->GetFire(p).lock()) {
-						if (effectiveResistances[FIRE_RES] < 90) {
-							threatLocation = p;
-							seenFire = true;
-						}
-					}
-					
-					/*Stop if we already see many npcs, otherwise this can start to bog down in
-					  high traffic places*/
-					if (adjacent <= 0 && nearNpcs.size() > 16) break;
-					
-					--adjacent;
-				} while (!TCODLine::step(p.Xptr(), p.Yptr()));
+	int threatDistance = 0;
+
+	//Only care about fire if we're not flying and/or not effectively immune
+	if (fireLocation != undefined && !HasEffect(FLYING) && effectiveResistances[FIRE_RES] < 90) {
+		threatLocation = fireLocation;
+		threatDistance = Distance(fireLocation, pos);
+		seenFire = true;
+	}
+
+	std::vector<NPC*> found;
+	for (int i = 0; i < map->npcGrid->Factions(); ++i) {
+		bool friendly = factionPtr->IsFriendsWith(i);
+		if (onlyHostiles && friendly) continue;
+
+		found.clear();
+		map->npcGrid->Find(i, pos - LOS_DISTANCE, pos + LOS_DISTANCE, found);
+		for (std::vector<NPC*>::iterator npci = found.begin(); npci != found.end(); ++npci) {
+			if (*npci == this || !fov->Visible((*npci)->pos)) continue;
+
+			boost::shared_ptr<NPC> npc = boost::static_pointer_cast<NPC>((*npci)->shared_from_this());
+			nearNpcs.push_back(npc);
+			if (Game::Adjacent(pos, npc->pos)) adjacentNpcs.push_back(npc);
+
+			//The closest one is the threat
+			if (!friendly && (threatLocation == undefined || Distance(npc->pos, pos) < threatDistance)) {
+				threatLocation = npc->pos;
+				threatDistance = Distance(npc->pos, pos);
+				seenFire = false;
 			}
 		}
 	}
@@ -2851,6 +2926,7 @@ void NPC::SetFaction(int newFaction) {
 	if (newFaction >= 0 && newFaction < static_cast<int>(Faction::factions.size())) {
 		faction = newFaction;
 		factionPtr = Faction::factions[newFaction];
+		if (inGrid) FileInGrid(gridPos);
 	} else if (!Faction::factions.empty()) {
 		factionPtr = Faction::factions[0];
 	}
@@ -3220,4 +3296,10 @@ void NPC::load(InputArchive& ar, const unsigned int version) {
 	}
 	SetFaction(faction); //Required to initialize factionPtr
 	InitializeAIFunctions();
+
+	//Searches aren't saved, so an NPC that was waiting for one has to start its move over
+	if (findPathWorking) {
+		findPathWorking = false;
+		taskBegun = false;
+	}
 }
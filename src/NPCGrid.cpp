@@ -0,0 +1,66 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <algorithm>
+
+#include "NPCGrid.hpp"
+#include "NPC.hpp"
+
+const int NPCGrid::BUCKET_SIZE;
+
+void NPCGrid::Add(NPC* npc, const Coordinate& p, int faction) {
+	if (faction < 0) return;
+	if (faction >= static_cast<int>(factions.size())) factions.resize(faction + 1);
+	factions[faction][p / BUCKET_SIZE].push_back(npc);
+}
+
+void NPCGrid::Remove(NPC* npc, const Coordinate& p, int faction) {
+	if (faction < 0 || faction >= static_cast<int>(factions.size())) return;
+	Buckets::iterator bucket = factions[faction].find(p / BUCKET_SIZE);
+	if (bucket == factions[faction].end()) return;
+	std::vector<NPC*>::iterator npci = std::find(bucket->second.begin(), bucket->second.end(), npc);
+	if (npci != bucket->second.end()) {
+		*npci = bucket->second.back();
+		bucket->second.pop_back();
+	}
+	if (bucket->second.empty()) factions[faction].erase(bucket);
+}
+
+void NPCGrid::Move(NPC* npc, const Coordinate& from, int fromFaction, const Coordinate& to, int toFaction) {
+	if (fromFaction == toFaction && from / BUCKET_SIZE == to / BUCKET_SIZE) return;
+	Remove(npc, from, fromFaction);
+	Add(npc, to, toFaction);
+}
+
+int NPCGrid::Factions() const {
+	return static_cast<int>(factions.size());
+}
+
+void NPCGrid::Find(int faction, const Coordinate& low, const Coordinate& high, std::vector<NPC*>& result) const {
+	if (faction < 0 || faction >= static_cast<int>(factions.size()) || factions[faction].empty()) return;
+	Coordinate lowBucket = low / BUCKET_SIZE, highBucket = high / BUCKET_SIZE;
+	for (int y = lowBucket.Y(); y <= highBucket.Y(); ++y) {
+		for (int x = lowBucket.X(); x <= highBucket.X(); ++x) {
+			Buckets::const_iterator bucket = factions[faction].find(Coordinate(x, y));
+			if (bucket == factions[faction].end()) continue;
+			for (std::vector<NPC*>::const_iterator npci = bucket->second.begin(); npci != bucket->second.end(); ++npci) {
+				Coordinate p = (*npci)->Position();
+				if (p.X() >= low.X() && p.Y() >= low.Y() && p.X() <= high.X() && p.Y() <= high.Y()) result.push_back(*npci);
+			}
+		}
+	}
+}
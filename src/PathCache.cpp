@@ -0,0 +1,152 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+
+#include "PathCache.hpp"
+#include "PathGraph.hpp"
+#include "Map.hpp"
+#include "NPC.hpp"
+
+namespace {
+	const int SPLICE_MARGIN = 4; //Extra room around the spliced section for the local search
+}
+
+const int PathCache::REGION_SIZE;
+const int PathCache::SPLICE_AHEAD;
+const unsigned int PathCache::MIN_LENGTH;
+const unsigned int PathCache::CAPACITY;
+
+bool PathCache::Key::operator==(const Key& other) const {
+	return region == other.region && goal == other.goal && hands == other.hands && faction == other.faction;
+}
+
+std::size_t hash_value(const PathCache::Key& key) {
+	std::size_t seed = hash_value(key.region);
+	boost::hash_combine(seed, hash_value(key.goal));
+	boost::hash_combine(seed, key.hands);
+	boost::hash_combine(seed, key.faction);
+	return seed;
+}
+
+PathCache::PathCache(Map* map, int width, int height) : map(map), width(width), version(0),
+	hits(0), misses(0), stale(0) {
+	int clustersX = (width + PathGraph::CLUSTER_SIZE - 1) / PathGraph::CLUSTER_SIZE;
+	int clustersY = (height + PathGraph::CLUSTER_SIZE - 1) / PathGraph::CLUSTER_SIZE;
+	clusterVersion.assign(clustersX * clustersY, 0);
+}
+
+int PathCache::ClusterAt(const Coordinate& p) const {
+	int clustersX = (width + PathGraph::CLUSTER_SIZE - 1) / PathGraph::CLUSTER_SIZE;
+	return (p.Y() / PathGraph::CLUSTER_SIZE) * clustersX + p.X() / PathGraph::CLUSTER_SIZE;
+}
+
+PathCache::Key PathCache::MakeKey(const Coordinate& start, const Coordinate& goal, NPC* npc) const {
+	Key key = { start / REGION_SIZE, goal, npc->HasHands(), npc->GetFaction() };
+	return key;
+}
+
+void PathCache::TileChanged(const Coordinate& p) {
+	clusterVersion[ClusterAt(p)] = ++version;
+}
+
+bool PathCache::FindPath(const Coordinate& start, const Coordinate& goal, NPC* npc, std::vector<Coordinate>& path) {
+	Key key = MakeKey(start, goal, npc);
+	std::vector<Coordinate> cached;
+	{
+		boost::lock_guard<boost::mutex> lock(mutex);
+		boost::unordered_map<Key, std::list<Entry>::iterator>::iterator indexi = index.find(key);
+		if (indexi == index.end()) {
+			++misses;
+			return false;
+		}
+
+		std::list<Entry>::iterator entry = indexi->second;
+		for (std::vector<int>::iterator cluster = entry->clusters.begin(); cluster != entry->clusters.end(); ++cluster) {
+			if (clusterVersion[*cluster] > entry->version) {
+				entries.erase(entry);
+				index.erase(indexi);
+				++stale;
+				++misses;
+				return false;
+			}
+		}
+
+		entries.splice(entries.begin(), entries, entry);
+		cached = entry->path;
+	}
+
+	//Join the cached path a few steps in, with a search over the small rectangle around both
+	size_t join = std::min<size_t>(SPLICE_AHEAD, cached.size() - 1);
+	Coordinate low = start, high = start;
+	for (size_t i = 0; i <= join; ++i) {
+		for (int d = 0; d < 2; ++d) {
+			low[d] = std::min(low[d], cached[i][d]);
+			high[d] = std::max(high[d], cached[i][d]);
+		}
+	}
+	low = (low - SPLICE_MARGIN).shrinkExtent(zero, map->Extent());
+	high = (high + SPLICE_MARGIN).shrinkExtent(zero, map->Extent());
+
+	path.clear();
+	if (!map->pathGraph->LocalSearch(low, high - low + 1, start, cached[join], static_cast<void*>(npc), path)) {
+		boost::lock_guard<boost::mutex> lock(mutex);
+		++misses;
+		return false;
+	}
+	path.insert(path.end(), cached.begin() + join + 1, cached.end());
+
+	boost::lock_guard<boost::mutex> lock(mutex);
+	++hits;
+	return true;
+}
+
+void PathCache::Store(const Coordinate& start, const Coordinate& goal, NPC* npc, const std::vector<Coordinate>& path) {
+	if (path.size() < MIN_LENGTH || path.back() != goal) return;
+
+	Entry entry;
+	entry.key = MakeKey(start, goal, npc);
+	entry.path = path;
+	entry.version = version;
+	entry.clusters.push_back(ClusterAt(start));
+	for (std::vector<Coordinate>::const_iterator p = path.begin(); p != path.end(); ++p) {
+		int cluster = ClusterAt(*p);
+		if (cluster != entry.clusters.back()) entry.clusters.push_back(cluster);
+	}
+	std::sort(entry.clusters.begin(), entry.clusters.end());
+	entry.clusters.erase(std::unique(entry.clusters.begin(), entry.clusters.end()), entry.clusters.end());
+
+	boost::lock_guard<boost::mutex> lock(mutex);
+	boost::unordered_map<Key, std::list<Entry>::iterator>::iterator indexi = index.find(entry.key);
+	if (indexi != index.end()) {
+		entries.erase(indexi->second);
+		index.erase(indexi);
+	}
+	entries.push_front(entry);
+	index[entry.key] = entries.begin();
+	if (entries.size() > CAPACITY) {
+		index.erase(entries.back().key);
+		entries.pop_back();
+	}
+}
+
+PathCache::Stats PathCache::GetStats() {
+	boost::lock_guard<boost::mutex> lock(mutex);
+	Stats stats = { hits, misses, stale, static_cast<unsigned int>(entries.size()) };
+	return stats;
+}
@@ -0,0 +1,394 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <boost/unordered_map.hpp>
+
+#include "PathGraph.hpp"
+#include "Map.hpp"
+
+namespace {
+	const float UNREACHABLE = std::numeric_limits<float>::max();
+	const float DIAGONAL_COST = 1.41f; //Same as TCODPath's default
+	const int MAX_ENTRANCE_WIDTH = 6; //Wider openings get an entrance at both ends
+
+	typedef std::pair<float, int> OpenEntry;
+	typedef std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry> > OpenList;
+
+	inline float Octile(const Coordinate& a, const Coordinate& b) {
+		int dx = std::abs(a.X() - b.X()), dy = std::abs(a.Y() - b.Y());
+		return std::max(dx, dy) - std::min(dx, dy) + DIAGONAL_COST * std::min(dx, dy);
+	}
+}
+
+const int PathGraph::CLUSTER_SIZE;
+
+PathGraph::PathGraph(Map* map, int width, int height) : map(map), width(width), height(height),
+	dirty(true), linksDirty(true) {
+	clustersX = (width + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+	clustersY = (height + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+	clusters.resize(clustersX * clustersY);
+	eastBorders.resize(clusters.size());
+	southBorders.resize(clusters.size());
+	for (int cy = 0; cy < clustersY; ++cy) {
+		for (int cx = 0; cx < clustersX; ++cx) {
+			Cluster& cluster = clusters[cy * clustersX + cx];
+			cluster.origin = Coordinate(cx * CLUSTER_SIZE, cy * CLUSTER_SIZE);
+			cluster.extent = Coordinate(std::min(CLUSTER_SIZE, width - cx * CLUSTER_SIZE),
+				std::min(CLUSTER_SIZE, height - cy * CLUSTER_SIZE));
+			cluster.firstNode = 0;
+			//Nothing is computed until the first Update(), the map isn't generated yet at this point
+			cluster.dirty = true;
+		}
+	}
+}
+
+int PathGraph::ClusterAt(const Coordinate& p) const {
+	return (p.Y() / CLUSTER_SIZE) * clustersX + p.X() / CLUSTER_SIZE;
+}
+
+float PathGraph::Cost(const Coordinate& p, void* npc) const {
+	if (npc) return map->getWalkCost(p, p, npc);
+	return (float)map->cachedTile(p).GetMoveCost();
+}
+
+void PathGraph::TileChanged(const Coordinate& p) {
+	Cluster& cluster = clusters[ClusterAt(p)];
+	cluster.dirty = true;
+	dirty = true;
+	//Tiles on a cluster edge also carry the cost of crossing into the cluster
+	if (p.onExtentEdges(cluster.origin, cluster.extent)) linksDirty = true;
+}
+
+//Rescans the border between the cluster and its east or south neighbour, returns true if the entrances changed
+bool PathGraph::ScanBorder(int index, bool east) {
+	std::vector<Entrance>& border = east ? eastBorders[index] : southBorders[index];
+	const Cluster& cluster = clusters[index];
+	std::vector<Entrance> entrances;
+
+	bool hasNeighbour = east ? (index % clustersX) + 1 < clustersX : index / clustersX + 1 < clustersY;
+	if (hasNeighbour) {
+		//Walk along the border, d is the direction along it and n points across it
+		Coordinate d = east ? Coordinate(0, 1) : Coordinate(1, 0);
+		Coordinate n = east ? Coordinate(1, 0) : Coordinate(0, 1);
+		Coordinate first = east ? Coordinate(cluster.origin.X() + cluster.extent.X() - 1, cluster.origin.Y())
+			: Coordinate(cluster.origin.X(), cluster.origin.Y() + cluster.extent.Y() - 1);
+		int length = east ? cluster.extent.Y() : cluster.extent.X();
+
+		int runStart = -1;
+		for (int i = 0; i <= length; ++i) {
+			Coordinate p = first + d * i;
+			bool open = i < length && Cost(p) > 0 && Cost(p + n) > 0;
+			if (open && runStart < 0) runStart = i;
+			else if (!open && runStart >= 0) {
+				int runLength = i - runStart;
+				if (runLength < MAX_ENTRANCE_WIDTH) {
+					Coordinate mid = first + d * (runStart + runLength / 2);
+					Entrance entrance = { mid, mid + n };
+					entrances.push_back(entrance);
+				} else {
+					Coordinate low = first + d * runStart, high = first + d * (i - 1);
+					Entrance lowEntrance = { low, low + n }, highEntrance = { high, high + n };
+					entrances.push_back(lowEntrance);
+					entrances.push_back(highEntrance);
+				}
+				runStart = -1;
+			}
+		}
+	}
+
+	if (entrances == border) return false;
+	border.swap(entrances);
+	return true;
+}
+
+void PathGraph::GatherEntrances(int index) {
+	Cluster& cluster = clusters[index];
+	std::vector<Coordinate> entrances;
+
+	for (std::vector<Entrance>::iterator e = eastBorders[index].begin(); e != eastBorders[index].end(); ++e)
+		entrances.push_back(e->a);
+	for (std::vector<Entrance>::iterator e = southBorders[index].begin(); e != southBorders[index].end(); ++e)
+		entrances.push_back(e->a);
+	if (index % clustersX > 0) {
+		std::vector<Entrance>& west = eastBorders[index - 1];
+		for (std::vector<Entrance>::iterator e = west.begin(); e != west.end(); ++e) entrances.push_back(e->b);
+	}
+	if (index / clustersX > 0) {
+		std::vector<Entrance>& north = southBorders[index - clustersX];
+		for (std::vector<Entrance>::iterator e = north.begin(); e != north.end(); ++e) entrances.push_back(e->b);
+	}
+
+	//Corner tiles can be an entrance on two borders
+	std::sort(entrances.begin(), entrances.end());
+	entrances.erase(std::unique(entrances.begin(), entrances.end()), entrances.end());
+	cluster.entrances.swap(entrances);
+}
+
+void PathGraph::ComputeCosts(Cluster& cluster) {
+	size_t count = cluster.entrances.size();
+	cluster.costs.assign(count * count, UNREACHABLE);
+	std::vector<float> dist;
+	for (size_t i = 0; i < count; ++i) {
+		Flood(cluster, cluster.entrances[i], false, dist);
+		for (size_t j = 0; j < count; ++j) {
+			Coordinate local = cluster.entrances[j] - cluster.origin;
+			cluster.costs[i * count + j] = dist[local.Y() * cluster.extent.X() + local.X()];
+		}
+	}
+}
+
+void PathGraph::BuildNodes() {
+	nodes.clear();
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		clusters[c].firstNode = nodes.size();
+		for (size_t i = 0; i < clusters[c].entrances.size(); ++i) {
+			Node node;
+			node.pos = clusters[c].entrances[i];
+			node.cluster = c;
+			node.index = i;
+			nodes.push_back(node);
+		}
+	}
+
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		for (int east = 0; east < 2; ++east) {
+			std::vector<Entrance>& border = east ? eastBorders[c] : southBorders[c];
+			if (border.empty()) continue;
+			const Cluster& from = clusters[c];
+			const Cluster& to = clusters[east ? c + 1 : c + clustersX];
+			for (std::vector<Entrance>::iterator e = border.begin(); e != border.end(); ++e) {
+				int a = from.firstNode + (std::lower_bound(from.entrances.begin(), from.entrances.end(), e->a) - from.entrances.begin());
+				int b = to.firstNode + (std::lower_bound(to.entrances.begin(), to.entrances.end(), e->b) - to.entrances.begin());
+				Link ab = { b, Cost(e->b) }, ba = { a, Cost(e->a) };
+				nodes[a].links.push_back(ab);
+				nodes[b].links.push_back(ba);
+			}
+		}
+	}
+}
+
+//Repairs every cluster touched since the last call. Must be called with the cache write lock held
+void PathGraph::Update() {
+	if (!dirty) return;
+
+	std::vector<bool> recompute(clusters.size(), false);
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		if (!clusters[c].dirty) continue;
+		recompute[c] = true;
+		//A cluster shares a border with each of its neighbours, and the entrances on it depend on both sides
+		if (ScanBorder(c, true)) { recompute[c + 1] = true; linksDirty = true; }
+		if (ScanBorder(c, false)) { recompute[c + clustersX] = true; linksDirty = true; }
+		if (c % clustersX > 0 && ScanBorder(c - 1, true)) { recompute[c - 1] = true; linksDirty = true; }
+		if (c / clustersX > 0 && ScanBorder(c - clustersX, false)) { recompute[c - clustersX] = true; linksDirty = true; }
+		clusters[c].dirty = false;
+	}
+
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		if (recompute[c]) {
+			GatherEntrances(c);
+			ComputeCosts(clusters[c]);
+		}
+	}
+
+	if (linksDirty) BuildNodes();
+	dirty = linksDirty = false;
+}
+
+/* Dijkstra restricted to the cluster using the generic costs. With reverse the distances are
+to the given tile instead of from it, which is what the goal end of a search needs */
+void PathGraph::Flood(const Cluster& cluster, const Coordinate& origin, bool reverse, std::vector<float>& dist) const {
+	int w = cluster.extent.X(), h = cluster.extent.Y();
+	dist.assign(w * h, UNREACHABLE);
+
+	OpenList open;
+	Coordinate local = origin - cluster.origin;
+	dist[local.Y() * w + local.X()] = 0.0f;
+	open.push(OpenEntry(0.0f, local.Y() * w + local.X()));
+
+	while (!open.empty()) {
+		OpenEntry current = open.top();
+		open.pop();
+		if (current.first > dist[current.second]) continue;
+
+		Coordinate p = cluster.origin + Coordinate(current.second % w, current.second / w);
+		float stepCost = reverse ? Cost(p) : 0.0f; //Going backwards every step pays for the tile it leaves
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				if (dx == 0 && dy == 0) continue;
+				Coordinate next = p + Coordinate(dx, dy);
+				if (!next.insideExtent(cluster.origin, cluster.extent)) continue;
+				float cost = Cost(next);
+				if (cost <= 0) continue;
+				if (!reverse) stepCost = cost;
+				float nextDist = current.first + stepCost * (dx != 0 && dy != 0 ? DIAGONAL_COST : 1.0f);
+				int index = (next.Y() - cluster.origin.Y()) * w + next.X() - cluster.origin.X();
+				if (nextDist < dist[index]) {
+					dist[index] = nextDist;
+					open.push(OpenEntry(nextDist, index));
+				}
+			}
+		}
+	}
+}
+
+bool PathGraph::LocalSearch(const Coordinate& origin, const Coordinate& extent, const Coordinate& from, const Coordinate& to, void* npc, std::vector<Coordinate>& path) const {
+	if (from == to) return true;
+
+	int w = extent.X(), h = extent.Y();
+	std::vector<float> dist(w * h, UNREACHABLE);
+	std::vector<int> parent(w * h, -1);
+
+	OpenList open;
+	int start = (from.Y() - origin.Y()) * w + from.X() - origin.X();
+	int goal = (to.Y() - origin.Y()) * w + to.X() - origin.X();
+	dist[start] = 0.0f;
+	open.push(OpenEntry(Octile(from, to), start));
+
+	while (!open.empty()) {
+		OpenEntry current = open.top();
+		open.pop();
+		if (current.second == goal) break;
+
+		Coordinate p = origin + Coordinate(current.second % w, current.second / w);
+		if (current.first > dist[current.second] + Octile(p, to)) continue;
+
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				if (dx == 0 && dy == 0) continue;
+				Coordinate next = p + Coordinate(dx, dy);
+				if (!next.insideExtent(origin, extent)) continue;
+				float cost = Cost(next, npc);
+				if (cost <= 0) continue;
+				float nextDist = dist[current.second] + cost * (dx != 0 && dy != 0 ? DIAGONAL_COST : 1.0f);
+				int index = (next.Y() - origin.Y()) * w + next.X() - origin.X();
+				if (nextDist < dist[index]) {
+					dist[index] = nextDist;
+					parent[index] = current.second;
+					open.push(OpenEntry(nextDist + Octile(next, to), index));
+				}
+			}
+		}
+	}
+	if (parent[goal] < 0) return false;
+
+	size_t segmentStart = path.size();
+	for (int i = goal; i != start; i = parent[i]) {
+		path.push_back(origin + Coordinate(i % w, i / w));
+	}
+	std::reverse(path.begin() + segmentStart, path.end());
+	return true;
+}
+
+bool PathGraph::FindPath(const Coordinate& start, const Coordinate& goal, void* npc, std::vector<Coordinate>& path) const {
+	if (dirty || nodes.empty()) return false;
+	if (!start.insideExtent(zero, Coordinate(width, height)) || !goal.insideExtent(zero, Coordinate(width, height))) return false;
+	if (Cost(goal) <= 0) return false;
+
+	const int GOAL = nodes.size();
+	const int START = -1;
+	const Cluster& startCluster = clusters[ClusterAt(start)];
+	const Cluster& goalCluster = clusters[ClusterAt(goal)];
+
+	std::vector<float> fromStart, toGoal;
+	Flood(startCluster, start, false, fromStart);
+	Flood(goalCluster, goal, true, toGoal);
+
+	boost::unordered_map<int, float> g;
+	boost::unordered_map<int, int> parent;
+	OpenList open;
+
+	for (size_t i = 0; i < startCluster.entrances.size(); ++i) {
+		Coordinate local = startCluster.entrances[i] - startCluster.origin;
+		float cost = fromStart[local.Y() * startCluster.extent.X() + local.X()];
+		if (cost == UNREACHABLE) continue;
+		int node = startCluster.firstNode + i;
+		g[node] = cost;
+		parent[node] = START;
+		open.push(OpenEntry(cost + Octile(nodes[node].pos, goal), node));
+	}
+	if (&startCluster == &goalCluster) {
+		Coordinate local = goal - startCluster.origin;
+		float cost = fromStart[local.Y() * startCluster.extent.X() + local.X()];
+		if (cost != UNREACHABLE) {
+			g[GOAL] = cost;
+			parent[GOAL] = START;
+			open.push(OpenEntry(cost, GOAL));
+		}
+	}
+
+	bool found = false;
+	while (!open.empty()) {
+		OpenEntry current = open.top();
+		open.pop();
+		if (current.second == GOAL) { found = true; break; }
+
+		const Node& node = nodes[current.second];
+		float nodeG = g[current.second];
+		if (current.first > nodeG + Octile(node.pos, goal)) continue;
+
+		std::vector<std::pair<int, float> > edges;
+		if (&clusters[node.cluster] == &goalCluster) {
+			Coordinate local = node.pos - goalCluster.origin;
+			float cost = toGoal[local.Y() * goalCluster.extent.X() + local.X()];
+			if (cost != UNREACHABLE) edges.push_back(std::make_pair(GOAL, cost));
+		}
+		const Cluster& cluster = clusters[node.cluster];
+		size_t count = cluster.entrances.size();
+		for (size_t i = 0; i < count; ++i) {
+			float cost = cluster.costs[node.index * count + i];
+			if (cost != UNREACHABLE && (int)i != node.index) edges.push_back(std::make_pair(cluster.firstNode + (int)i, cost));
+		}
+		for (std::vector<Link>::const_iterator link = node.links.begin(); link != node.links.end(); ++link) {
+			edges.push_back(std::make_pair(link->node, link->cost));
+		}
+
+		for (std::vector<std::pair<int, float> >::iterator edge = edges.begin(); edge != edges.end(); ++edge) {
+			float nextG = nodeG + edge->second;
+			boost::unordered_map<int, float>::iterator old = g.find(edge->first);
+			if (old == g.end() || nextG < old->second) {
+				g[edge->first] = nextG;
+				parent[edge->first] = current.second;
+				open.push(OpenEntry(nextG + (edge->first == GOAL ? 0.0f : Octile(nodes[edge->first].pos, goal)), edge->first));
+			}
+		}
+	}
+	if (!found) return false;
+
+	std::vector<Coordinate> waypoints;
+	waypoints.push_back(goal);
+	for (int node = parent[GOAL]; node != START; node = parent[node]) {
+		waypoints.push_back(nodes[node].pos);
+	}
+	waypoints.push_back(start);
+	std::reverse(waypoints.begin(), waypoints.end());
+
+	path.clear();
+	for (size_t i = 1; i < waypoints.size(); ++i) {
+		int from = ClusterAt(waypoints[i-1]), to = ClusterAt(waypoints[i]);
+		if (from != to) {
+			path.push_back(waypoints[i]); //Crossing a border is always a single step
+		} else if (!LocalSearch(clusters[from].origin, clusters[from].extent, waypoints[i-1], waypoints[i], npc, path)) {
+			path.clear();
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,257 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <boost/bind.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <libtcod.hpp>
+
+#include "Pathfinder.hpp"
+#include "Map.hpp"
+#include "PathGraph.hpp"
+#include "FlowField.hpp"
+#include "PathCache.hpp"
+#include "NPC.hpp"
+#include "Logger.hpp"
+#include "data/Config.hpp"
+
+namespace {
+	/* TCODPath binds its user data at construction, so a reusable buffer can't be handed
+	a different NPC pointer for every search. Instead the buffer talks to this proxy,
+	which forwards to the map with whichever NPC the worker is currently pathing for. */
+	class PathCallback : public ITCODPathCallback {
+	public:
+		NPC* npc;
+		PathCallback() : npc(0) {}
+		float getWalkCost(int fx, int fy, int tx, int ty, void*) const {
+			return Map::Inst()->getWalkCost(fx, fy, tx, ty, static_cast<void*>(npc));
+		}
+	};
+
+	const unsigned int MAX_PATHING_THREADS = 8;
+}
+
+class PathWorker {
+public:
+	std::deque<boost::shared_ptr<PathRequest> > queue;
+	boost::mutex queueMutex;
+	PathCallback callback;
+	TCODPath* path;
+	int width, height;
+
+	PathWorker() : path(0), width(0), height(0) {}
+	~PathWorker() { delete path; }
+
+	void Compute(PathRequest* request);
+};
+
+PathRequest::PathRequest(NPC* npc, const Coordinate& start, const Coordinate& goal) :
+	npc(npc), start(start), goal(goal),
+	cancelled(false), done(false),
+	nopath(false), dangerous(false) {
+}
+
+void PathRequest::Cancel() {
+	boost::lock_guard<boost::mutex> lock(stateMutex);
+	cancelled = true;
+}
+
+void PathRequest::CancelAndWait() {
+	Cancel();
+	//A worker holds computeMutex for the whole search, and checks cancelled after taking it
+	boost::lock_guard<boost::mutex> wait(computeMutex);
+}
+
+bool PathRequest::Collect(std::vector<Coordinate>& path, bool& nopath, bool& dangerous) {
+	boost::lock_guard<boost::mutex> lock(stateMutex);
+	if (!done) return false;
+	path.swap(result);
+	result.clear();
+	nopath = this->nopath;
+	dangerous = this->dangerous;
+	return true;
+}
+
+void PathWorker::Compute(PathRequest* request) {
+	boost::lock_guard<boost::mutex> computeLock(request->computeMutex);
+	{
+		boost::lock_guard<boost::mutex> lock(request->stateMutex);
+		if (request->cancelled) return;
+	}
+
+	Map* map = Map::Inst();
+	if (!path || width != map->Width() || height != map->Height()) {
+		delete path;
+		width = map->Width();
+		height = map->Height();
+		path = new TCODPath(width, height, &callback, 0);
+	}
+	callback.npc = request->npc;
+
+	std::vector<Coordinate> result;
+	bool nopath, dangerous = false;
+	{
+		boost::shared_lock<boost::shared_mutex> readCacheLock(map->cacheMutex);
+
+		/* Popular destinations have a shared flow field, other long routes go through the cluster graph.
+		Flyers and tunnelers don't care about the walls those are built around, so they (and anything
+		that can't be routed otherwise) get a full search */
+		bool walker = !request->npc->IsFlying() && !request->npc->IsTunneler();
+		bool hierarchical = walker &&
+			std::max(std::abs(request->start.X() - request->goal.X()), std::abs(request->start.Y() - request->goal.Y())) > PathGraph::CLUSTER_SIZE * 2;
+		if (walker && map->flowFields->FindPath(request->start, request->goal, request->npc, result)) {
+			nopath = false;
+		} else if (walker && map->pathCache->FindPath(request->start, request->goal, request->npc, result)) {
+			nopath = false;
+		} else if (hierarchical && map->pathGraph->FindPath(request->start, request->goal, request->npc, result)) {
+			nopath = false;
+			map->pathCache->Store(request->start, request->goal, request->npc, result);
+		} else {
+			nopath = !path->compute(request->start.X(), request->start.Y(), request->goal.X(), request->goal.Y());
+			result.reserve(path->size());
+			for (int i = 0; i < path->size(); ++i) {
+				Coordinate p;
+				path->get(i, p.Xptr(), p.Yptr());
+				result.push_back(p);
+			}
+			if (walker && !nopath) map->pathCache->Store(request->start, request->goal, request->npc, result);
+		}
+
+		for (std::vector<Coordinate>::iterator p = result.begin(); p != result.end(); ++p) {
+			//One dangerous tile = whole path considered dangerous
+			if (map->IsDangerousCache(*p, request->npc->GetFaction())) {
+				dangerous = true;
+				break;
+			}
+		}
+	}
+	callback.npc = 0;
+
+	boost::lock_guard<boost::mutex> lock(request->stateMutex);
+	request->result.swap(result);
+	request->nopath = nopath;
+	request->dangerous = dangerous;
+	request->done = true;
+}
+
+Pathfinder* Pathfinder::instance = 0;
+
+Pathfinder* Pathfinder::Inst() {
+	if (!instance) instance = new Pathfinder();
+	return instance;
+}
+
+Pathfinder::Pathfinder() : gameThreadWorker(new PathWorker()), pending(0), nextWorker(0), stopping(false) {
+	unsigned int count = std::max(0, Config::GetCVar<int>("pathingThreads"));
+	if (count == 0) {
+		//Leave one core for the game thread
+		count = std::max(1U, boost::thread::hardware_concurrency()) - 1;
+		count = std::max(1U, std::min(count, MAX_PATHING_THREADS));
+	}
+	LOG("Starting " << count << " pathing threads");
+
+	for (unsigned int i = 0; i < count; ++i) {
+		workers.push_back(new PathWorker());
+	}
+	for (unsigned int i = 0; i < count; ++i) {
+		threads.create_thread(boost::bind(&Pathfinder::Run, this, i));
+	}
+}
+
+Pathfinder::~Pathfinder() {
+	{
+		boost::lock_guard<boost::mutex> lock(wakeMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	threads.join_all();
+	for (size_t i = 0; i < workers.size(); ++i) delete workers[i];
+	delete gameThreadWorker;
+}
+
+void Pathfinder::Submit(boost::shared_ptr<PathRequest> request) {
+	{
+		boost::lock_guard<boost::mutex> lock(wakeMutex);
+		nextWorker = (nextWorker + 1) % workers.size();
+		++pending;
+	}
+	{
+		PathWorker* worker = workers[nextWorker];
+		boost::lock_guard<boost::mutex> lock(worker->queueMutex);
+		worker->queue.push_back(request);
+	}
+	wake.notify_one();
+}
+
+void Pathfinder::Compute(boost::shared_ptr<PathRequest> request) {
+	gameThreadWorker->Compute(request.get());
+}
+
+boost::shared_ptr<PathRequest> Pathfinder::Steal(unsigned int thief) {
+	//Own queue is worked front to back, victims are robbed from the back
+	{
+		PathWorker* own = workers[thief];
+		boost::lock_guard<boost::mutex> lock(own->queueMutex);
+		if (!own->queue.empty()) {
+			boost::shared_ptr<PathRequest> request = own->queue.front();
+			own->queue.pop_front();
+			return request;
+		}
+	}
+	for (size_t i = 1; i < workers.size(); ++i) {
+		PathWorker* victim = workers[(thief + i) % workers.size()];
+		boost::lock_guard<boost::mutex> lock(victim->queueMutex);
+		if (!victim->queue.empty()) {
+			boost::shared_ptr<PathRequest> request = victim->queue.back();
+			victim->queue.pop_back();
+			return request;
+		}
+	}
+	return boost::shared_ptr<PathRequest>();
+}
+
+void Pathfinder::Run(unsigned int index) {
+	PathWorker* worker = workers[index];
+	while (true) {
+		{
+			boost::unique_lock<boost::mutex> lock(wakeMutex);
+			while (pending == 0 && !stopping) wake.wait(lock);
+			if (stopping) return;
+		}
+
+		if (boost::shared_ptr<PathRequest> request = Steal(index)) {
+			{
+				boost::lock_guard<boost::mutex> lock(wakeMutex);
+				--pending;
+			}
+			worker->Compute(request.get());
+		} else {
+			/*pending was bumped before the request was queued, so there's a short window
+			where it's nonzero but there's nothing to steal yet*/
+			boost::this_thread::yield();
+		}
+	}
+}
+
+unsigned int Pathfinder::WorkerCount() const { return workers.size(); }
+
+unsigned int Pathfinder::Pending() {
+	boost::lock_guard<boost::mutex> lock(wakeMutex);
+	return pending;
+}
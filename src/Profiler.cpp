@@ -0,0 +1,109 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <boost/format.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "Profiler.hpp"
+
+namespace {
+	typedef std::pair<boost::posix_time::time_duration, std::size_t> Ranking; //Total time, subsystem
+
+	boost::posix_time::ptime Now() {
+		return boost::posix_time::microsec_clock::universal_time();
+	}
+
+	double Milliseconds(const boost::posix_time::time_duration& duration) {
+		return duration.total_microseconds() / 1000.0;
+	}
+
+	bool MoreTime(const Ranking& a, const Ranking& b) {
+		return a.first > b.first;
+	}
+}
+
+Profiler* Profiler::instance = 0;
+
+Profiler* Profiler::Inst() {
+	if (!instance) instance = new Profiler();
+	return instance;
+}
+
+Profiler::Profiler() : enabled(false), ticks(0) {}
+
+void Profiler::Enable(bool value) { enabled = value; }
+bool Profiler::Enabled() const { return enabled; }
+
+void Profiler::StartTick() {
+	if (!enabled) return;
+	if (ticks > 0) {
+		boost::posix_time::time_duration tick = lapStart - tickStart;
+		total += tick;
+		if (tick > longestTick) longestTick = tick;
+	}
+	++ticks;
+	tickStart = lapStart = Now();
+}
+
+void Profiler::Lap(const char* subsystem) {
+	if (!enabled || ticks == 0) return;
+	boost::posix_time::ptime now = Now();
+
+	std::vector<Subsystem>::iterator subi = subsystems.begin();
+	while (subi != subsystems.end() && std::strcmp(subi->name, subsystem) != 0) ++subi;
+	if (subi == subsystems.end()) {
+		Subsystem added;
+		added.name = subsystem;
+		subi = subsystems.insert(subsystems.end(), added);
+	}
+
+	boost::posix_time::time_duration lap = now - lapStart;
+	subi->total += lap;
+	if (lap > subi->longest) subi->longest = lap;
+	lapStart = now;
+}
+
+void Profiler::Report(std::ostream& out) const {
+	//The tick in progress has had its laps counted, so count it as well
+	boost::posix_time::time_duration allTicks = total, longest = longestTick;
+	if (ticks > 0) {
+		allTicks += lapStart - tickStart;
+		longest = std::max(longest, lapStart - tickStart);
+	}
+	unsigned int count = std::max(ticks, 1U);
+
+	out << boost::format("%d ticks in %.1f ms, %.3f ms per tick, longest %.3f ms\n")
+		% ticks % Milliseconds(allTicks) % (Milliseconds(allTicks) / count) % Milliseconds(longest);
+	out << boost::format("%-16s %12s %12s %12s %7s\n") % "subsystem" % "total ms" % "mean ms" % "longest ms" % "share";
+
+	std::vector<Ranking> order;
+	for (std::size_t i = 0; i < subsystems.size(); ++i) {
+		order.push_back(std::make_pair(subsystems[i].total, i));
+	}
+	std::stable_sort(order.begin(), order.end(), MoreTime);
+
+	for (std::size_t i = 0; i < order.size(); ++i) {
+		const Subsystem& subsystem = subsystems[order[i].second];
+		double share = allTicks.total_microseconds() > 0 ?
+			100.0 * subsystem.total.total_microseconds() / allTicks.total_microseconds() : 0.0;
+		out << boost::format("%-16s %12.1f %12.3f %12.3f %6.1f%%\n") % subsystem.name
+			% Milliseconds(subsystem.total) % (Milliseconds(subsystem.total) / count)
+			% Milliseconds(subsystem.longest) % share;
+	}
+}
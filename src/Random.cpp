@@ -19,6 +19,7 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include <ctime>
 #include <cmath>
 #include <algorithm>
+#include <climits>
 
 #include "Random.hpp"
 #include "Logger.hpp"
@@ -194,6 +195,20 @@ namespace Random {
 		return InternalGenerate(generator, boost::uniform_01<>());
 	}
 	
+	/**
+		Generates the number of tries until the first success, when each try succeeds with
+		a chance of one in chance. Equivalent to rolling <tt>Generate(chance - 1) == 0</tt>
+		repeatedly and counting the rolls, but only needs one random number.
+		
+		\param[in] chance The odds of a single try succeeding, 1 in chance.
+		\returns          A number of tries, at least 1.
+	*/
+	int Generator::Geometric(int chance) {
+		if (chance <= 1) return 1;
+		double tries = std::floor(std::log(1.0 - Generate()) / std::log(1.0 - 1.0 / chance)) + 1.0;
+		return static_cast<int>(std::min(tries, static_cast<double>(INT_MAX / 2)));
+	}
+	
 	/**
 		Generates a random boolean.
 		
@@ -262,9 +277,11 @@ namespace Random {
 
 	/**
 		Initialises the PRNG.
+		
+		\param[in] seed Seed to use. If 0, then the current time is used.
 	*/
-	void Init() {
-		unsigned int seed = GetStandardSeed();
+	void Init(unsigned int seed) {
+		if (seed == 0) seed = GetStandardSeed();
 		LOG("Seeding global random generator with " << seed);
 		Globals::generator.SetSeed(seed);
 	}
@@ -284,6 +301,11 @@ namespace Random {
 		return Globals::generator.Generate();
 	}
 	
+	/** \copydoc Generator::Geometric */
+	int Geometric(int chance) {
+		return Globals::generator.Geometric(chance);
+	}
+	
 	/** \copydoc Generator::GenerateBool */
 	bool GenerateBool() {
 		return Globals::generator.GenerateBool();
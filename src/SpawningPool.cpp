@@ -204,7 +204,7 @@ void SpawningPool::Expand(bool message) {
 
 		//Swallow nature objects
 		if (map->GetNatureObject(location) >= 0) {
-			Game::Inst()->RemoveNatureObject(Game::Inst()->natureList[map->GetNatureObject(location)]);
+			Game::Inst()->RemoveNatureObject(Game::Inst()->natureList.Get(map->GetNatureObject(location)));
 		}
 		//Destroy buildings
 		if (map->GetConstruction(location) >= 0) {
@@ -30,6 +30,7 @@ graphic(g),
 	color(col),
 	type(typeval),
 	damageType(DAMAGE_BLUNT),
+	damageTimer(0),
 	visible(true),
 	negative(true),
 	contagionChance(0),
@@ -27,6 +27,9 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include "Camp.hpp"
 #include "Stats.hpp"
 #include "JobManager.hpp"
+#include "ItemIndex.hpp"
+#include "StockpileDirectory.hpp"
+#include "StockpileQueue.hpp"
 
 //find a tile adjacent to p which belongs to Stockpile uid
 static bool FindAdjacentTo(const Coordinate& p, int uid, Coordinate *out);
@@ -59,6 +62,8 @@ Stockpile::Stockpile(ConstructionType type, int newSymbol, Coordinate target) :
 }
 
 Stockpile::~Stockpile() {
+	StockpileDirectory::Inst()->Remove(uid);
+
 	//Loop through all the containers
 	for (std::map<Coordinate, boost::shared_ptr<Container> >::iterator conti = containers.begin(); conti != containers.end(); ++conti) {
 		//Loop through all the items in the containers
@@ -320,6 +325,7 @@ int Stockpile::Expand(Coordinate from, Coordinate to) {
 			}
 		}
 	}
+	if (expansion > 0) StockpileDirectory::Inst()->Refile(this);
 	return expansion;
 }
 
@@ -461,6 +467,11 @@ Coordinate Stockpile::FreePosition() {
 
 void Stockpile::ReserveSpot(Coordinate pos, bool val, ItemType type) { 
 	reserved[pos] = val;
+	StockpileDirectory::Inst()->Changed(uid);
+	if (!val) {
+		std::map<Coordinate, boost::shared_ptr<Container> >::iterator conti = containers.find(pos);
+		if (conti != containers.end() && conti->second->empty()) StockpileQueue::Inst()->Wake(this);
+	}
 
 	/*Update amounts based on reserves if limits exist for the item
 	This is necessary to stop too many stockpilation jobs being queued up
@@ -511,6 +522,7 @@ void Stockpile::SwitchAllowed(ItemCategory cat, bool childrenAlso, bool countPar
 			}
 		}
 	}
+	StockpileDirectory::Inst()->Refile(this);
 	Game::Inst()->RefreshStockpiles();
 }
 
@@ -518,11 +530,15 @@ void Stockpile::SetAllAllowed(bool nallowed) {
 	for(unsigned int i = 0; i < Item::Categories.size(); i++) {
 		allowed[i] = nallowed;
 	}
+	StockpileDirectory::Inst()->Refile(this);
 	Game::Inst()->RefreshStockpiles();
 }
 
 void Stockpile::ItemAdded(boost::weak_ptr<Item> witem) {
 	if (boost::shared_ptr<Item> item = witem.lock()) {
+		if (!farmplot) ItemIndex::Inst()->Add(item);
+		StockpileDirectory::Inst()->Changed(uid);
+
 		std::set<ItemCategory> categories = Item::Presets[item->Type()].categories;
 		for(std::set<ItemCategory>::iterator it = categories.begin(); it != categories.end(); it++) {
 			amount[*it] = amount[*it] + 1;
@@ -566,6 +582,9 @@ void Stockpile::ItemAdded(boost::weak_ptr<Item> witem) {
 
 void Stockpile::ItemRemoved(boost::weak_ptr<Item> witem) {
 	if (boost::shared_ptr<Item> item = witem.lock()) {
+		ItemIndex::Inst()->Remove(item);
+		StockpileDirectory::Inst()->Changed(uid);
+		StockpileQueue::Inst()->Wake(this);
 
 		//"Remove" each item inside a container
 		if(item->IsCategory(Item::StringToItemCategory("Container"))) {
@@ -649,11 +668,27 @@ void Stockpile::TranslateInternalContainerListeners() {
 		it != containers.end(); ++it) {
 			it->second->TranslateContainerListeners();
 	}
+
+	//The item index isn't saved, put back what ItemAdded would have filed
+	if (farmplot) return;
+	for (std::map<Coordinate, boost::shared_ptr<Container> >::iterator conti = containers.begin(); conti != containers.end(); ++conti) {
+		for (std::set<boost::weak_ptr<Item> >::iterator itemi = conti->second->begin(); itemi != conti->second->end(); ++itemi) {
+			boost::shared_ptr<Item> item = itemi->lock();
+			if (!item) continue;
+			ItemIndex::Inst()->Add(item);
+			if (boost::shared_ptr<Container> container = boost::dynamic_pointer_cast<Container>(item)) {
+				for (std::set<boost::weak_ptr<Item> >::iterator inneri = container->begin(); inneri != container->end(); ++inneri) {
+					if (boost::shared_ptr<Item> inner = inneri->lock()) ItemIndex::Inst()->Add(inner);
+				}
+			}
+		}
+	}
 }
 
 void Stockpile::AdjustLimit(ItemCategory category, int amount) {
 	if (amount > 0 && !allowed[category]) allowed[category] = true;
 	else if (amount == 0 && allowed[category]) allowed[category] = false;
+	StockpileDirectory::Inst()->Refile(this);
 
 	if (limits.find(category) != limits.end()) {
 		limits[category] = amount;
@@ -679,6 +714,7 @@ void Stockpile::Erase(const Coordinate& p) {
 		reserved.erase(p);
 		containers.erase(p);
 		colors.erase(p);
+		StockpileDirectory::Inst()->Changed(uid);
 	}
 	
 }
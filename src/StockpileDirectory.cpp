@@ -0,0 +1,164 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include "StockpileDirectory.hpp"
+#include "Stockpile.hpp"
+#include "Item.hpp"
+#include "Game.hpp"
+#include "GCamp.hpp"
+
+StockpileDirectory* StockpileDirectory::instance = 0;
+const int StockpileDirectory::BUCKET_SIZE;
+
+StockpileDirectory* StockpileDirectory::Inst() {
+	if (!instance) instance = new StockpileDirectory();
+	return instance;
+}
+
+void StockpileDirectory::Reset() {
+	delete instance;
+	instance = new StockpileDirectory();
+}
+
+StockpileDirectory::StockpileDirectory() {}
+
+void StockpileDirectory::File(int uid, Entry& entry, Stockpile* stockpile) {
+	entry.bucket = stockpile->Center() / BUCKET_SIZE;
+	entry.categories.clear();
+	entry.fullSince.clear();
+	for (ItemCategory category = 0; category < static_cast<int>(Item::Categories.size()); ++category) {
+		if (stockpile->Allowed(category)) {
+			if (static_cast<int>(categories.size()) <= category) categories.resize(category + 1);
+			categories[category][entry.bucket][uid] = entry.stockpile;
+			entry.categories.push_back(category);
+		}
+	}
+}
+
+void StockpileDirectory::Unfile(int uid, Entry& entry) {
+	for (std::vector<ItemCategory>::iterator cati = entry.categories.begin(); cati != entry.categories.end(); ++cati) {
+		Buckets::iterator bucketi = categories[*cati].find(entry.bucket);
+		if (bucketi != categories[*cati].end()) {
+			bucketi->second.erase(uid);
+			if (bucketi->second.empty()) categories[*cati].erase(bucketi);
+		}
+	}
+	entry.categories.clear();
+}
+
+void StockpileDirectory::Add(const boost::shared_ptr<Stockpile>& stockpile) {
+	int uid = stockpile->Uid();
+	Entry& entry = entries[uid];
+	Unfile(uid, entry);
+	entry.stockpile = stockpile;
+	File(uid, entry, stockpile.get());
+}
+
+void StockpileDirectory::Remove(int uid) {
+	boost::unordered_map<int, Entry>::iterator entryi = entries.find(uid);
+	if (entryi == entries.end()) return;
+	Unfile(uid, entryi->second);
+	entries.erase(entryi);
+}
+
+void StockpileDirectory::Refile(Stockpile* stockpile) {
+	int uid = stockpile->Uid();
+	boost::unordered_map<int, Entry>::iterator entryi = entries.find(uid);
+	if (entryi == entries.end()) return; //Still being set up, it'll be filed when it's added
+	Unfile(uid, entryi->second);
+	File(uid, entryi->second, stockpile);
+}
+
+void StockpileDirectory::Changed(int uid) {
+	boost::unordered_map<int, Entry>::iterator entryi = entries.find(uid);
+	if (entryi != entries.end()) entryi->second.fullSince.clear();
+}
+
+bool StockpileDirectory::Full(Entry& entry, Stockpile* stockpile, ItemType type) {
+	int now = Game::Inst()->Timers()->Now();
+	std::map<ItemType, int>::iterator fulli = entry.fullSince.find(type);
+	//Tiles next to the stockpile can become available for it without it hearing about it
+	if (fulli != entry.fullSince.end() && now - fulli->second < UPDATES_PER_SECOND) return true;
+	if (!stockpile->Full(type)) return false;
+	entry.fullSince[type] = now;
+	return true;
+}
+
+boost::shared_ptr<Stockpile> StockpileDirectory::FindNearest(ItemType type, const Coordinate& target) {
+	boost::shared_ptr<Stockpile> nearest;
+	int nearestDistance = std::numeric_limits<int>::max();
+
+	const std::set<ItemCategory>& itemCategories = Item::Presets[type].specificCategories;
+	for (std::set<ItemCategory>::const_iterator cati = itemCategories.begin(); cati != itemCategories.end(); ++cati) {
+		if (*cati < 0 || *cati >= static_cast<int>(categories.size())) continue;
+
+		//Closest a stockpile in each bucket could possibly be, nearest buckets first
+		std::vector<std::pair<int, Bucket*> > order;
+		order.reserve(categories[*cati].size());
+		for (Buckets::iterator bucketi = categories[*cati].begin(); bucketi != categories[*cati].end(); ++bucketi) {
+			Coordinate low = bucketi->first * BUCKET_SIZE;
+			Coordinate high = low + (BUCKET_SIZE - 1);
+			int bound = 0;
+			for (int d = 0; d < 2; ++d) {
+				bound += std::max(0, std::max(low[d] - target[d], target[d] - high[d]));
+			}
+			order.push_back(std::make_pair(bound, &bucketi->second));
+		}
+		std::sort(order.begin(), order.end());
+
+		for (std::vector<std::pair<int, Bucket*> >::iterator bucketi = order.begin(); bucketi != order.end(); ++bucketi) {
+			if (bucketi->first >= nearestDistance) break;
+			for (Bucket::iterator spi = bucketi->second->begin(); spi != bucketi->second->end(); ++spi) {
+				boost::shared_ptr<Stockpile> stockpile = spi->second.lock();
+				if (!stockpile) continue;
+				int distance = Distance(stockpile->Center(), target);
+				if (distance >= nearestDistance || Full(entries[spi->first], stockpile.get(), type)) continue;
+				nearestDistance = distance;
+				nearest = stockpile;
+			}
+		}
+	}
+	return nearest;
+}
+
+boost::shared_ptr<Stockpile> StockpileDirectory::FindByDemand(ItemType type, ItemCategory demandCategory, const Coordinate& target) {
+	boost::shared_ptr<Stockpile> best;
+	int bestDemand = std::numeric_limits<int>::min(), bestDistance = std::numeric_limits<int>::max();
+
+	const std::set<ItemCategory>& itemCategories = Item::Presets[type].specificCategories;
+	for (std::set<ItemCategory>::const_iterator cati = itemCategories.begin(); cati != itemCategories.end(); ++cati) {
+		if (*cati < 0 || *cati >= static_cast<int>(categories.size())) continue;
+		for (Buckets::iterator bucketi = categories[*cati].begin(); bucketi != categories[*cati].end(); ++bucketi) {
+			for (Bucket::iterator spi = bucketi->second.begin(); spi != bucketi->second.end(); ++spi) {
+				boost::shared_ptr<Stockpile> stockpile = spi->second.lock();
+				if (!stockpile) continue;
+				int demand = stockpile->GetDemand(demandCategory);
+				if (demand < bestDemand) continue;
+				int distance = Distance(stockpile->Center(), target);
+				if (demand == bestDemand && distance >= bestDistance) continue;
+				if (Full(entries[spi->first], stockpile.get(), type)) continue;
+				best = stockpile;
+				bestDemand = demand;
+				bestDistance = distance;
+			}
+		}
+	}
+	return best;
+}
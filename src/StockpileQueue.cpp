@@ -0,0 +1,160 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <algorithm>
+#include <vector>
+#include <boost/bind.hpp>
+
+#include "StockpileQueue.hpp"
+#include "Stockpile.hpp"
+#include "Item.hpp"
+#include "Container.hpp"
+#include "Game.hpp"
+#include "GCamp.hpp"
+#include "Faction.hpp"
+
+namespace {
+	const unsigned int ITEMS_PER_TICK = 32;
+	const int FIRST_RETRY = UPDATES_PER_SECOND * 5;
+	const int MAX_RETRY = UPDATES_PER_SECOND * 60;
+}
+
+StockpileQueue* StockpileQueue::instance = 0;
+
+StockpileQueue* StockpileQueue::Inst() {
+	if (!instance) instance = new StockpileQueue();
+	return instance;
+}
+
+void StockpileQueue::Reset() {
+	delete instance;
+	instance = new StockpileQueue();
+}
+
+StockpileQueue::StockpileQueue() : tickets(0) {}
+
+void StockpileQueue::Push(const boost::shared_ptr<Item>& item) {
+	int uid = item->Uid();
+	if (entries.find(uid) != entries.end()) return; //Already waiting one way or the other
+
+	Entry& entry = entries[uid];
+	entry.item = item;
+	entry.attempts = 0;
+	entry.parked = false;
+	entry.ticket = 0;
+	ready.push_back(uid);
+}
+
+void StockpileQueue::PushLater(const boost::shared_ptr<Item>& item) {
+	int uid = item->Uid();
+	if (entries.find(uid) != entries.end()) return;
+
+	Entry& entry = entries[uid];
+	entry.item = item;
+	entry.attempts = 0;
+	Park(uid, entry, item);
+}
+
+void StockpileQueue::Update() {
+	for (unsigned int i = 0; i < ITEMS_PER_TICK && !ready.empty(); ++i) {
+		int uid = ready.front();
+		ready.pop_front();
+		boost::unordered_map<int, Entry>::iterator entryi = entries.find(uid);
+		if (entryi == entries.end()) continue;
+
+		boost::shared_ptr<Item> item = entryi->second.item.lock();
+		//Anything that happens to these later queues them again
+		if (!item || item->Reserved() || item->GetFaction() != PLAYERFACTION || item->GetVelocity() != 0 || item->ContainedIn().lock()) {
+			entries.erase(entryi);
+			continue;
+		}
+
+		Game::Inst()->StockpileItem(item);
+		if (item->Reserved()) entries.erase(entryi); //A hauling job has it now
+		else Park(uid, entryi->second, item);
+	}
+}
+
+void StockpileQueue::Park(int uid, Entry& entry, const boost::shared_ptr<Item>& item) {
+	//Same as Game::StockpileItem, containers go where the items inside them would go
+	ItemType type = item->Type();
+	if (boost::shared_ptr<Container> container = boost::dynamic_pointer_cast<Container>(item)) {
+		if (boost::shared_ptr<Item> inner = container->GetFirstItem().lock()) type = inner->Type();
+	}
+	//A stockpile taking any one of the categories may have room for it
+	entry.categories = Item::Presets[type].specificCategories;
+	if (entry.categories.empty()) entry.categories.insert(-1);
+	entry.parked = true;
+	entry.ticket = ++tickets;
+	for (std::set<ItemCategory>::iterator cati = entry.categories.begin(); cati != entry.categories.end(); ++cati) {
+		parked[*cati].insert(uid);
+	}
+
+	int delay = FIRST_RETRY;
+	for (int i = 0; i < entry.attempts && delay < MAX_RETRY; ++i) delay *= 2;
+	++entry.attempts;
+	Game::Inst()->Timers()->Schedule(std::min(delay, MAX_RETRY), boost::bind(&StockpileQueue::Retry, uid, entry.ticket));
+}
+
+void StockpileQueue::Unpark(int uid) {
+	boost::unordered_map<int, Entry>::iterator entryi = entries.find(uid);
+	if (entryi == entries.end() || !entryi->second.parked) return;
+
+	const std::set<ItemCategory>& categories = entryi->second.categories;
+	for (std::set<ItemCategory>::const_iterator cati = categories.begin(); cati != categories.end(); ++cati) {
+		std::map<ItemCategory, std::set<int> >::iterator parkedi = parked.find(*cati);
+		if (parkedi != parked.end()) {
+			parkedi->second.erase(uid);
+			if (parkedi->second.empty()) parked.erase(parkedi);
+		}
+	}
+	entryi->second.parked = false;
+	ready.push_back(uid);
+}
+
+//Goes through Inst() instead of binding the queue, the timer might outlive it
+void StockpileQueue::Retry(int uid, unsigned int ticket) {
+	StockpileQueue* queue = Inst();
+	boost::unordered_map<int, Entry>::iterator entryi = queue->entries.find(uid);
+	if (entryi == queue->entries.end() || !entryi->second.parked || entryi->second.ticket != ticket) return;
+	queue->Unpark(uid);
+}
+
+void StockpileQueue::Wake(Stockpile* stockpile) {
+	//Unparking takes items out of the map, so gather them first
+	std::vector<int> waking;
+	for (std::map<ItemCategory, std::set<int> >::iterator parkedi = parked.begin(); parkedi != parked.end(); ++parkedi) {
+		if (parkedi->first >= 0 && stockpile->Allowed(parkedi->first)) {
+			waking.insert(waking.end(), parkedi->second.begin(), parkedi->second.end());
+		}
+	}
+	for (std::vector<int>::iterator uidi = waking.begin(); uidi != waking.end(); ++uidi) {
+		Unpark(*uidi);
+	}
+}
+
+void StockpileQueue::WakeAll() {
+	for (std::map<ItemCategory, std::set<int> >::iterator parkedi = parked.begin(); parkedi != parked.end(); ++parkedi) {
+		for (std::set<int>::iterator uidi = parkedi->second.begin(); uidi != parkedi->second.end(); ++uidi) {
+			boost::unordered_map<int, Entry>::iterator entryi = entries.find(*uidi);
+			if (entryi == entries.end() || !entryi->second.parked) continue;
+			entryi->second.parked = false;
+			ready.push_back(*uidi);
+		}
+	}
+	parked.clear();
+}
@@ -97,7 +97,7 @@ void TCODMapRenderer::DrawMap(Map* map, float focusX, float focusY, int viewport
 					}
 					int natNum = map->GetNatureObject(xy);
 					if (natNum >= 0) {
-						Game::Inst()->natureList[natNum]->Draw(upleft,&minimap);
+						Game::Inst()->natureList.Get(natNum)->Draw(upleft,&minimap);
 					}
 				}
 				if (map->GetOverlayFlags() & TERRITORY_OVERLAY) {
@@ -114,9 +114,9 @@ void TCODMapRenderer::DrawMap(Map* map, float focusX, float focusY, int viewport
 		InternalDrawMapItems("static constructions",  Game::Inst()->staticConstructionList, upleft, &minimap);
 		InternalDrawMapItems("dynamic constructions", Game::Inst()->dynamicConstructionList, upleft, &minimap);
 		//TODO: Make this consistent
-		for (std::map<int,boost::shared_ptr<Item> >::iterator itemi = Game::Inst()->itemList.begin(); itemi != Game::Inst()->itemList.end();) {
+		for (EntityMap<Item>::iterator itemi = Game::Inst()->itemList.begin(); itemi != Game::Inst()->itemList.end();) {
 			if (!itemi->second) {
-				std::map<int,boost::shared_ptr<Item> >::iterator tmp = itemi;
+				EntityMap<Item>::iterator tmp = itemi;
 				++itemi;
 				Game::Inst()->itemList.erase(tmp);
 				continue;
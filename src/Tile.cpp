@@ -18,6 +18,7 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include <string>
 #include <queue>
 #include <set>
+#include <climits>
 #ifdef DEBUG
 #include <iostream>
 #endif
@@ -382,38 +383,46 @@ void Tile::load(InputArchive& ar, const unsigned int version) {
 	ar & flow;
 }
 
-CacheTile::CacheTile() : walkable(true), moveCost(1), construction(false),
-	door(false), trap(false), bridge(false), moveSpeedModifier(0),
-	waterDepth(0), npcCount(0), fire(false), x(0), y(0) {}
+CacheTile::CacheTile() : moveCost(1), flags(WALKABLE) {}
 
 CacheTile& CacheTile::operator=(const Tile& tile) {
-	walkable = tile.walkable;
-	moveCost = tile.moveCost;
+	flags = 0;
+	bool bridge = false;
+	int moveSpeedModifier = 0;
 	boost::shared_ptr<Construction> construct = Game::Inst()->GetConstruction(tile.construction).lock();
 	if (construct) {
-		construction = true;
-		door = construct->HasTag(DOOR);
-		trap = construct->HasTag(TRAP);
-		bridge = construct->HasTag(BRIDGE);
+		flags |= CONSTRUCTION;
+		if (construct->HasTag(::DOOR)) flags |= DOOR;
+		if (construct->HasTag(::TRAP)) flags |= TRAP;
+		bridge = construct->HasTag(::BRIDGE);
 		moveSpeedModifier = construct->GetMoveSpeedModifier();
-	} else {
-		construction = false;
-		door = false;
-		trap = false;
-		bridge = false;
-		moveSpeedModifier = 0;
 	}
+	if (tile.fire) flags |= FIRE;
 
-	if (tile.water) waterDepth = tile.water->Depth();
-	else waterDepth = 0;
+	if (!tile.walkable) {
+		moveCost = 0;
+		return *this;
+	}
+	flags |= WALKABLE;
+
+	int cost = tile.moveCost;
+	if (flags & FIRE) cost += 500; //Walking through fire... not such a good idea.
+
+	//If a construction exists here take it into consideration
+	if (bridge) {
+		cost -= (tile.moveCost-1); //Disregard terrain in case of a bridge
+	}
+	cost += moveSpeedModifier;
 
-	npcCount = tile.npcList.size();
-	fire = bool(tile.fire);
+	if (!bridge && tile.water) { //If no built bridge here take water depth into account
+		cost += std::min(20, tile.water->Depth());
+	}
 
+	moveCost = static_cast<short>(std::max<int>(SHRT_MIN, std::min<int>(SHRT_MAX, cost)));
 	return *this;
 }
 
-int CacheTile::GetMoveCost(void* ptr) const {
+int CacheTile::GetMoveCost(const Coordinate& p, void* ptr) const {
 	int cost = GetMoveCost();
 
 	if (cost < 100) { //If we're over 100 then it's clear enough that walking here is not a good choice
@@ -421,36 +430,23 @@ int CacheTile::GetMoveCost(void* ptr) const {
 		NPC* npc = static_cast<NPC*>(ptr);
 
 		if (npc) {
-			if (door && !npc->HasHands()) {
+			if ((flags & DOOR) && !npc->HasHands()) {
 				cost += 50;
 			}
-			if (trap) { 
-				cost = Faction::factions[npc->GetFaction()]->IsTrapVisible(Coordinate(x,y)) ? 
+			if (flags & TRAP) { 
+				cost = Faction::factions[npc->GetFaction()]->IsTrapVisible(p) ? 
 					100 : 1;
 			}
 
 			//cost == 0 normally means unwalkable, but tunnellers can, surprise surprise, tunnel through
-			if (cost == 0 && construction && npc->IsTunneler()) cost = 50;
+			if (cost == 0 && (flags & CONSTRUCTION) && npc->IsTunneler()) cost = 50;
 		}
 	}
 	return cost;
 }
 
-int CacheTile::GetMoveCost() const {
-	if (!walkable) return 0;
-	int cost = moveCost;
-
-	if (fire) cost += 500; //Walking through fire... not such a good idea.
-
-	//If a construction exists here take it into consideration
-	if (bridge) {
-		cost -= (moveCost-1); //Disregard terrain in case of a bridge
-	}
-	cost += moveSpeedModifier;
-	
-	if (!bridge) { //If no built bridge here take water depth into account
-		cost += std::min(20, waterDepth);
-	}
-
-	return cost;
-}
+int CacheTile::GetMoveCost() const { return moveCost; }
+bool CacheTile::IsWalkable() const { return (flags & WALKABLE) != 0; }
+bool CacheTile::HasDoor() const { return (flags & DOOR) != 0; }
+bool CacheTile::HasTrap() const { return (flags & TRAP) != 0; }
+bool CacheTile::OnFire() const { return (flags & FIRE) != 0; }
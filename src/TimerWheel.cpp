@@ -0,0 +1,96 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <algorithm>
+#include <boost/bind.hpp>
+
+#include "TimerWheel.hpp"
+#include "Random.hpp"
+
+bool TimerWheel::Timer::operator<(const Timer& other) const { return sequence < other.sequence; }
+
+TimerWheel::TimerWheel() : ticks(SLOTS), laps(SLOTS), now(0), count(0), sequence(0) {}
+
+void TimerWheel::Place(const Timer& timer) {
+	if (timer.due - now < SLOTS) {
+		ticks[timer.due % SLOTS].push_back(timer);
+	} else if (timer.due / SLOTS - now / SLOTS < SLOTS) {
+		laps[(timer.due / SLOTS) % SLOTS].push_back(timer);
+	} else {
+		overflow.push_back(timer);
+	}
+}
+
+void TimerWheel::Schedule(int delay, const Callback& callback) {
+	Timer timer;
+	timer.due = now + std::max(1, delay);
+	timer.sequence = sequence++;
+	timer.callback = callback;
+	Place(timer);
+	++count;
+}
+
+void TimerWheel::ScheduleRandom(int chance, const Recurring& callback) {
+	Schedule(Random::Geometric(chance), boost::bind(&TimerWheel::FireRandom, this, chance, callback));
+}
+
+void TimerWheel::FireRandom(int chance, Recurring callback) {
+	if (callback()) ScheduleRandom(chance, callback);
+}
+
+void TimerWheel::Advance() {
+	++now;
+	if (now % SLOTS == 0) {
+		int lap = now / SLOTS;
+		if (lap % SLOTS == 0) {
+			std::vector<Timer> waiting;
+			waiting.swap(overflow);
+			for (std::vector<Timer>::iterator timeri = waiting.begin(); timeri != waiting.end(); ++timeri) {
+				Place(*timeri);
+			}
+		}
+		std::vector<Timer> arriving;
+		arriving.swap(laps[lap % SLOTS]);
+		for (std::vector<Timer>::iterator timeri = arriving.begin(); timeri != arriving.end(); ++timeri) {
+			ticks[timeri->due % SLOTS].push_back(*timeri);
+		}
+	}
+
+	std::vector<Timer> current;
+	current.swap(ticks[now % SLOTS]);
+	if (current.empty()) return;
+
+	//Timers moved down from the coarse ring end up after ones scheduled later directly into this slot
+	std::sort(current.begin(), current.end());
+	count -= current.size();
+	//Callbacks may schedule new timers, but never for this tick
+	for (std::vector<Timer>::iterator timeri = current.begin(); timeri != current.end(); ++timeri) {
+		timeri->callback();
+	}
+}
+
+void TimerWheel::Clear() {
+	for (int i = 0; i < SLOTS; ++i) {
+		ticks[i].clear();
+		laps[i].clear();
+	}
+	overflow.clear();
+	count = 0;
+}
+
+int TimerWheel::Now() const { return now; }
+unsigned int TimerWheel::Size() const { return count; }
@@ -23,6 +23,8 @@ along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include "GCamp.hpp"
 #include "JobManager.hpp"
 #include "Faction.hpp"
+#include "Map.hpp"
+#include "Visibility.hpp"
 
 Trap::Trap(ConstructionType vtype, Coordinate pos) : Construction(vtype, pos),
 ready(true){
@@ -38,6 +40,11 @@ void Trap::Update() {
 				graphic[1] = 62;
 				npc->Damage(&Construction::Presets[type].trapAttack);
 				Faction::factions[npc->GetFaction()]->TrapDiscovered(Position());
+				//Anyone watching now knows about it too
+				for (size_t i = 0; i < Faction::factions.size(); ++i) {
+					if (!Faction::factions[i]->IsTrapVisible(Position()) && map->visibility->FactionSees(i, Position()))
+						Faction::factions[i]->TrapDiscovered(Position(), false);
+				}
 			}
 		}
 	}
@@ -782,14 +782,14 @@ boost::weak_ptr<Entity> UI::GetEntity(const Coordinate& pos) {
 
 		std::set<int> *itemList = Map::Inst()->ItemList(pos);
 		if (!itemList->empty()) {
-			std::set<boost::weak_ptr<Item> >::iterator itemi = Game::Inst()->freeItems.find(Game::Inst()->itemList[*itemList->begin()]);
+			std::set<boost::weak_ptr<Item> >::iterator itemi = Game::Inst()->freeItems.find(Game::Inst()->itemList.Get(*itemList->begin()));
 			if (itemi != Game::Inst()->freeItems.end()) {
 				return *itemi;
 			}
 		}
 
 		int entity = Map::Inst()->GetNatureObject(pos);
-		if (entity > -1) return (Game::Inst()->natureList[entity]);
+		if (entity > -1) return (Game::Inst()->natureList.Get(entity));
 
 		entity = Map::Inst()->GetConstruction(pos);
 		if (entity > -1) return Game::Inst()->GetConstruction(entity);
@@ -811,13 +811,13 @@ void UI::HandleUnderCursor(const Coordinate& pos, std::list<boost::weak_ptr<Enti
 		std::set<int> *itemList = Map::Inst()->ItemList(pos);
 		if (!itemList->empty()) {
 			for (std::set<int>::iterator itemi = itemList->begin(); itemi != itemList->end(); ++itemi) {
-				result->push_back(Game::Inst()->itemList[*itemi]);
+				result->push_back(Game::Inst()->itemList.Get(*itemi));
 			}
 		}
 
 		int entity = Map::Inst()->GetNatureObject(pos);
 		if (entity > -1) {
-			result->push_back(Game::Inst()->natureList[entity]);
+			result->push_back(Game::Inst()->natureList.Get(entity));
 		}
 
 		entity = Map::Inst()->GetConstruction(pos);
@@ -36,7 +36,7 @@ Dialog* NPCDialog::NPCListDialog() {
 
 NPCDialog::NPCDialog(): UIContainer(std::vector<Drawable*>(), 0, 0, Game::Inst()->ScreenWidth() - 20, Game::Inst()->ScreenHeight() - 20) {
 	AddComponent(new ScrollPanel(0, 0, width, height, 
-								 new UIList<std::pair<int, boost::shared_ptr<NPC> >, std::map<int, boost::shared_ptr<NPC> > >(&(Game::Inst()->npcList), 0, 0, width - 2, height, NPCDialog::DrawNPC), false));
+								 new UIList<std::pair<int, boost::shared_ptr<NPC> >, EntityMap<NPC> >(&(Game::Inst()->npcList), 0, 0, width - 2, height, NPCDialog::DrawNPC), false));
 }
 
 void NPCDialog::DrawNPC(std::pair<int, boost::shared_ptr<NPC> > npci, int i, int x, int y, int width, bool selected, TCODConsole* console) {
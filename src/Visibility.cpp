@@ -0,0 +1,86 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <cstdlib>
+#include <boost/unordered_set.hpp>
+
+#include "Visibility.hpp"
+#include "Map.hpp"
+#include "NPC.hpp"
+#include "NPCGrid.hpp"
+
+namespace {
+	const int VIEW_RADIUS = LOS_DISTANCE + Visibility::CELL_SIZE / 2;
+}
+
+const int Visibility::CELL_SIZE;
+
+Visibility::Visibility(Map* map) : map(map) {}
+
+boost::shared_ptr<const FieldOfView> Visibility::View(const Coordinate& p, bool seeOverWalls) {
+	Coordinate cell = p / CELL_SIZE;
+	Coordinate centre = map->Shrink(cell * CELL_SIZE + CELL_SIZE / 2);
+	boost::shared_ptr<FieldOfView>& view = views[seeOverWalls ? 1 : 0][cell];
+	if (!view) {
+		view.reset(new FieldOfView());
+		view->Compute(map, centre, VIEW_RADIUS, seeOverWalls);
+	}
+
+	//Sight is symmetric, so if p is visible from the centre the centre is visible from p
+	if (seeOverWalls || (!map->BlocksLight(centre) && view->Visible(p))) return view;
+
+	//A wall in the way, the cell's view would see past it
+	boost::shared_ptr<FieldOfView>& own = ownViews[p];
+	if (!own) {
+		own.reset(new FieldOfView());
+		own->Compute(map, p, LOS_DISTANCE, false);
+	}
+	return own;
+}
+
+bool Visibility::FactionSees(int faction, const Coordinate& p) {
+	std::vector<NPC*> observers;
+	map->npcGrid->Find(faction, p - LOS_DISTANCE, p + LOS_DISTANCE, observers);
+	boost::unordered_set<const FieldOfView*> checked;
+	for (std::vector<NPC*>::iterator npci = observers.begin(); npci != observers.end(); ++npci) {
+		if ((*npci)->Dead()) continue;
+		bool tall = (*npci)->GetHeight() >= ENTITYHEIGHT;
+		boost::shared_ptr<const FieldOfView> view = View((*npci)->Position(), tall);
+		if (!checked.insert(view.get()).second) continue;
+		if (view->Visible(p)) return true;
+	}
+	return false;
+}
+
+void Visibility::TileChanged(const Coordinate& p) {
+	//Views of a single tile only reach LOS_DISTANCE
+	for (Views::iterator viewi = ownViews.begin(); viewi != ownViews.end();) {
+		if (std::abs(viewi->first.X() - p.X()) <= LOS_DISTANCE && std::abs(viewi->first.Y() - p.Y()) <= LOS_DISTANCE) {
+			viewi = ownViews.erase(viewi);
+		} else ++viewi;
+	}
+
+	//Views seeing over walls never change
+	if (views[0].empty()) return;
+	Coordinate low = map->Shrink(p - VIEW_RADIUS) / CELL_SIZE;
+	Coordinate high = map->Shrink(p + VIEW_RADIUS) / CELL_SIZE;
+	for (int y = low.Y(); y <= high.Y(); ++y) {
+		for (int x = low.X(); x <= high.X(); ++x) {
+			views[0].erase(Coordinate(x, y));
+		}
+	}
+}
@@ -72,8 +72,11 @@ bool WaterNode::Update() {
 	}
 
 	if (!inert || inertCounter > (UPDATES_PER_SECOND*1)) {
+		Map* map = Map::Inst();
+		unsigned char terrain = map->WaterTerrain(pos);
+		bool low = (terrain & Map::WATER_LOW) != 0;
 
-		if (Map::Inst()->GetType(pos) == TILERIVERBED) {
+		if (terrain & Map::WATER_RIVERBED) {
 			timeFromRiverBed = 1000;
 			if (depth < RIVERDEPTH) depth = RIVERDEPTH;
 		}
@@ -85,18 +88,18 @@ bool WaterNode::Update() {
 			if (timeFromRiverBed == 0 && Random::Generate(100) == 0) depth -= 1; //Evaporation
 			if (timeFromRiverBed > 0 && depth < RIVERDEPTH) depth += 10; //Water rushing from the river
 
-			std::vector<boost::weak_ptr<WaterNode> > waterList;
+			std::vector<WaterNode*> waterList;
 			std::vector<Coordinate> coordList;
 			int depthSum = 0;
 
 			//Check if any of the surrounding tiles are low, this only matters if this tile is not low
 			bool onlyLowTiles = false;
-			if (!Map::Inst()->IsLow(pos)) {
+			if (!low) {
 				for (int ix = pos.X()-1; ix <= pos.X()+1; ++ix) {
 					for (int iy = pos.Y()-1; iy <= pos.Y()+1; ++iy) {
 						Coordinate p(ix,iy);
-						if (Map::Inst()->IsInside(p)) {
-							if (p != pos && Map::Inst()->IsLow(p)) { 
+						if (map->IsInside(p)) {
+							if (p != pos && (map->WaterTerrain(p) & Map::WATER_LOW)) { 
 								onlyLowTiles = true;
 								break;
 							}
@@ -111,24 +114,21 @@ bool WaterNode::Update() {
 			for (int ix = pos.X()-1; ix <= pos.X()+1; ++ix) {
 				for (int iy = pos.Y()-1; iy <= pos.Y()+1; ++iy) {
 					Coordinate p(ix,iy);
-					if (Map::Inst()->IsInside(p)) {
-						if (!coastal) {
-							TileType tile = Map::Inst()->GetType(p);
-							if (tile != TILENONE && tile != TILEDITCH && tile != TILERIVERBED) coastal = true;
-							if (Map::Inst()->GetNatureObject(p) >= 0) coastal = true;
-						}
+					if (map->IsInside(p)) {
+						unsigned char neighbour = map->WaterTerrain(p);
+						bool neighbourLow = (neighbour & Map::WATER_LOW) != 0;
+						if (neighbour & Map::WATER_SHORE) coastal = true;
 						/*Choose the surrounding tiles that:
 						Are the same height or low
 						or in case of [onlyLowTiles] are low
 						depth > RIVERDEPTH*3 at which point it can overflow upwards*/
-						if (((!onlyLowTiles && Map::Inst()->IsLow(pos) == Map::Inst()->IsLow(p))
-							  || depth > RIVERDEPTH*3 || Map::Inst()->IsLow(p))
-							&& !Map::Inst()->BlocksWater(p)) {
+						if (((!onlyLowTiles && low == neighbourLow) || depth > RIVERDEPTH*3 || neighbourLow)
+							&& !(neighbour & Map::WATER_BLOCKED)) {
 							//If we're choosing only low tiles, then this tile should be ignored completely
 							if (!onlyLowTiles || p != pos) {
-								waterList.push_back(Map::Inst()->GetWater(p));
+								waterList.push_back(map->WaterAt(p));
 								coordList.push_back(p);
-								if (waterList.back().lock()) depthSum += waterList.back().lock()->depth;
+								if (waterList.back()) depthSum += waterList.back()->depth;
 							}
 						}
 					}
@@ -139,13 +139,13 @@ bool WaterNode::Update() {
 			divided = ((double)depthSum/waterList.size());
 
 			boost::shared_ptr<Item> item;
-			if (!Map::Inst()->ItemList(pos)->empty())
-				item = Game::Inst()->GetItem(*Map::Inst()->ItemList(pos)->begin()).lock();
+			if (!map->ItemList(pos)->empty())
+				item = Game::Inst()->GetItem(*map->ItemList(pos)->begin()).lock();
 
 			//Filth and items flow off the map
-			Direction flow = Map::Inst()->GetFlow(pos);
+			Direction flow = map->GetFlow(pos);
 			Coordinate flowTarget = Coordinate::DirectionToCoordinate(flow) + pos;
-			if (!(Map::Inst()->IsInside(flowTarget))) {
+			if (!(map->IsInside(flowTarget))) {
 					if (filth > 0) {
 						Stats::Inst()->FilthFlowsOffEdge(std::min(filth, 10));
 						filth -= std::min(filth, 10);
@@ -158,7 +158,7 @@ bool WaterNode::Update() {
 
 			//Loop through neighbouring waternodes
 			for (unsigned int i = 0; i < waterList.size(); ++i) {
-				if (boost::shared_ptr<WaterNode> water = waterList[i].lock()) {
+				if (WaterNode* water = waterList[i]) {
 					water->depth = (int)divided;
 					water->timeFromRiverBed = timeFromRiverBed;
 					water->UpdateGraphic();
@@ -293,7 +293,7 @@ bool WaterNode::Update() {
 
 		} else {
 			int soakage = 500;
-			TileType type = Map::Inst()->GetType(pos);
+			TileType type = map->GetType(pos);
 			if (type == TILEGRASS) soakage = 10;
 			else if (type == TILEBOG) soakage = 0;
 			if (Random::Generate(soakage) == 0) {
@@ -0,0 +1,135 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <cstdlib>
+
+#include "WaterChunks.hpp"
+#include "Water.hpp"
+#include "Map.hpp"
+#include "Game.hpp"
+
+WaterChunks::WaterChunks(int width, int height) : width(width), height(height),
+	chunksX((width + CHUNK_SIZE - 1) / CHUNK_SIZE), chunksY((height + CHUNK_SIZE - 1) / CHUNK_SIZE),
+	chunks(chunksX * chunksY), schedule(UPDATE_INTERVAL), tick(0) {
+	for (std::vector<Chunk>::iterator chunk = chunks.begin(); chunk != chunks.end(); ++chunk) {
+		chunk->awake = false;
+		chunk->scheduled = false;
+		chunk->quiet = 0;
+	}
+}
+
+int WaterChunks::ChunkAt(const Coordinate& p) const {
+	return (p.Y() / CHUNK_SIZE) * chunksX + p.X() / CHUNK_SIZE;
+}
+
+void WaterChunks::Add(boost::shared_ptr<WaterNode> water) {
+	int chunk = ChunkAt(water->Position());
+	chunks[chunk].nodes.push_back(water);
+	WakeChunk(chunk);
+}
+
+void WaterChunks::Wake(const Coordinate& p) {
+	int x0 = std::max(0, p.X() - 1) / CHUNK_SIZE, x1 = std::min(width - 1, p.X() + 1) / CHUNK_SIZE;
+	int y0 = std::max(0, p.Y() - 1) / CHUNK_SIZE, y1 = std::min(height - 1, p.Y() + 1) / CHUNK_SIZE;
+	for (int y = y0; y <= y1; ++y) {
+		for (int x = x0; x <= x1; ++x) {
+			WakeChunk(y * chunksX + x);
+		}
+	}
+}
+
+void WaterChunks::WakeChunk(int index) {
+	Chunk& chunk = chunks[index];
+	if (chunk.nodes.empty()) return;
+	chunk.awake = true;
+	chunk.quiet = 0;
+	if (!chunk.scheduled) {
+		schedule[index % UPDATE_INTERVAL].push_back(index);
+		chunk.scheduled = true;
+	}
+}
+
+void WaterChunks::Update() {
+	std::vector<int>& due = schedule[tick % UPDATE_INTERVAL];
+	unsigned int round = tick / UPDATE_INTERVAL;
+	for (size_t i = 0; i < due.size();) {
+		int index = due[i];
+		if (chunks[index].awake || (round + index / UPDATE_INTERVAL) % SLEEP_INTERVAL == 0) {
+			UpdateChunk(index);
+		}
+		if (chunks[index].nodes.empty()) {
+			chunks[index].scheduled = false;
+			chunks[index].awake = false;
+			due[i] = due.back();
+			due.pop_back();
+		} else {
+			++i;
+		}
+	}
+	++tick;
+}
+
+void WaterChunks::UpdateChunk(int index) {
+	std::vector<boost::shared_ptr<WaterNode> > nodes;
+	std::vector<int> depths, filths;
+	size_t listed = chunks[index].nodes.size();
+	for (std::vector<boost::weak_ptr<WaterNode> >::iterator nodei = chunks[index].nodes.begin(); nodei != chunks[index].nodes.end(); ++nodei) {
+		if (boost::shared_ptr<WaterNode> water = nodei->lock()) {
+			nodes.push_back(water);
+			depths.push_back(water->Depth());
+			filths.push_back(water->GetFilth());
+		}
+	}
+
+	for (std::vector<boost::shared_ptr<WaterNode> >::iterator water = nodes.begin(); water != nodes.end(); ++water) {
+		if (Map::Inst()->GetWater((*water)->Position()).lock() != *water) continue; //Removed by an earlier update
+		if ((*water)->Update()) {
+			Game::Inst()->RemoveWater((*water)->Position(), false);
+		}
+	}
+
+	/* Any water that moved keeps the chunk awake, and wakes up the neighbouring chunk if it's on the edge.
+	Depth changing by 1 is shallow water jittering and doesn't count. Only terrain changes wake chunks
+	from outside (Map::UpdateWaterTerrain), depth changes don't, so settled shallow water can sleep */
+	bool changed = chunks[index].nodes.size() != listed;
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		Coordinate pos = nodes[i]->Position();
+		if (Map::Inst()->GetWater(pos).lock() != nodes[i] || std::abs(nodes[i]->Depth() - depths[i]) > 1
+			|| std::abs(nodes[i]->GetFilth() - filths[i]) > 1 || !Map::Inst()->ItemList(pos)->empty()) {
+			changed = true;
+			if (pos.X() % CHUNK_SIZE == 0 || pos.X() % CHUNK_SIZE == CHUNK_SIZE - 1
+				|| pos.Y() % CHUNK_SIZE == 0 || pos.Y() % CHUNK_SIZE == CHUNK_SIZE - 1) {
+				Wake(pos);
+			}
+		}
+	}
+
+	nodes.clear(); //Lets the ones that dried up go
+	Chunk& chunk = chunks[index];
+	size_t kept = 0;
+	for (size_t i = 0; i < chunk.nodes.size(); ++i) {
+		if (!chunk.nodes[i].expired()) chunk.nodes[kept++] = chunk.nodes[i];
+	}
+	chunk.nodes.resize(kept);
+
+	if (changed) {
+		chunk.awake = true;
+		chunk.quiet = 0;
+	} else if (++chunk.quiet >= QUIET_UPDATES) {
+		chunk.awake = false;
+	}
+}
@@ -15,6 +15,8 @@ You should have received a copy of the GNU General Public License
 along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
 #include "stdafx.hpp"
 
+#include <boost/bind.hpp>
+
 #include "Weather.hpp"
 #include "Random.hpp"
 #include "Game.hpp"
@@ -24,7 +26,7 @@ Weather::Weather(Map* vmap) : map(vmap), windDirection(NORTH),
 	prevailingWindDirection(NORTH), currentWeather(NORMALWEATHER), 
 	tileChange(false),
 	changeAll(false), tileChangeRate(0), changePosition(0),
-	currentSeason(-1) {
+	currentSeason(-1), scheduled(false) {
 }
 
 Direction Weather::GetWindDirection() { return windDirection; }
@@ -75,11 +77,12 @@ std::string Weather::GetWindAbbreviation() {
 }
 
 void Weather::Update() {
-	if (Random::Generate(MONTH_LENGTH) == 0) ShiftWind();
-	if (Random::Generate(MONTH_LENGTH) == 0) {
-		if (Random::Generate(2) < 2) {
-			currentWeather = NORMALWEATHER;
-		} else currentWeather = RAIN;
+	/*Scheduled on the first update rather than on construction, a loaded game replaces
+	the weather the map was created with*/
+	if (!scheduled) {
+		Game::Inst()->Timers()->ScheduleRandom(MONTH_LENGTH + 1, boost::bind(&Weather::WindEvent, this));
+		Game::Inst()->Timers()->ScheduleRandom(MONTH_LENGTH + 1, boost::bind(&Weather::WeatherEvent, this));
+		scheduled = true;
 	}
 	if (!tileChange && currentTemperature >= 0 && currentWeather == RAIN) Game::Inst()->CreateWater(Coordinate(Random::Generate(map->Width()-1),Random::Generate(map->Height()-1)),1);
 
@@ -102,8 +105,8 @@ void Weather::Update() {
 					}
 				} else if (currentTemperature > 0) {
 					if (map->GetNatureObject(r) >= 0) {
-						if (Game::Inst()->natureList[map->GetNatureObject(r)]->IsIce()) {
-							Game::Inst()->RemoveNatureObject(Game::Inst()->natureList[map->GetNatureObject(r)]);
+						if (Game::Inst()->natureList.Get(map->GetNatureObject(r))->IsIce()) {
+							Game::Inst()->RemoveNatureObject(Game::Inst()->natureList.Get(map->GetNatureObject(r)));
 						}
 					}
 				}
@@ -123,8 +126,8 @@ void Weather::Update() {
 						}
 					} else if (currentTemperature > 0) {
 						if (map->GetNatureObject(p) >= 0) {
-							if (Game::Inst()->natureList[map->GetNatureObject(p)]->IsIce()) {
-								Game::Inst()->RemoveNatureObject(Game::Inst()->natureList[map->GetNatureObject(p)]);
+							if (Game::Inst()->natureList.Get(map->GetNatureObject(p))->IsIce()) {
+								Game::Inst()->RemoveNatureObject(Game::Inst()->natureList.Get(map->GetNatureObject(p)));
 							}
 						}
 					}
@@ -141,6 +144,18 @@ void Weather::Update() {
 	}
 }
 
+bool Weather::WindEvent() {
+	ShiftWind();
+	return true;
+}
+
+bool Weather::WeatherEvent() {
+	if (Random::Generate(2) < 2) {
+		currentWeather = NORMALWEATHER;
+	} else currentWeather = RAIN;
+	return true;
+}
+
 void Weather::ChangeWeather(WeatherType newWeather) {
 	currentWeather = newWeather;
 }
@@ -0,0 +1,107 @@
+/* Copyright 2010-2011 Ilkka Halila
+This file is part of Goblin Camp.
+
+Goblin Camp is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Goblin Camp is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Goblin Camp. If not, see <http://www.gnu.org/licenses/>.*/
+#include "stdafx.hpp"
+
+#include <algorithm>
+#include <boost/bind.hpp>
+
+#include "WorkerPool.hpp"
+#include "Logger.hpp"
+#include "data/Config.hpp"
+
+namespace {
+	const unsigned int MAX_THREADS = 16;
+}
+
+WorkerPool* WorkerPool::instance = 0;
+
+WorkerPool* WorkerPool::Inst() {
+	if (!instance) instance = new WorkerPool();
+	return instance;
+}
+
+WorkerPool::WorkerPool() : parts(0), nextPart(0), unfinished(0), generation(0), stopping(false) {
+	unsigned int count = std::max(0, Config::GetCVar<int>("updateThreads"));
+	if (count == 0) count = std::min(std::max(1U, boost::thread::hardware_concurrency()), MAX_THREADS);
+	threadCount = count;
+	LOG("Starting " << threadCount - 1 << " update threads");
+
+	//The calling thread is one of the workers
+	for (unsigned int i = 1; i < threadCount; ++i) {
+		threads.create_thread(boost::bind(&WorkerPool::Loop, this));
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		boost::lock_guard<boost::mutex> lock(mutex);
+		stopping = true;
+		wake.notify_all();
+	}
+	threads.join_all();
+}
+
+unsigned int WorkerPool::Threads() const { return threadCount; }
+
+void WorkerPool::Run(const boost::function<void(unsigned int)>& newJob, unsigned int newParts) {
+	if (newParts == 0) return;
+
+	boost::unique_lock<boost::mutex> lock(mutex);
+	job = newJob;
+	parts = newParts;
+	nextPart = 0;
+	unfinished = newParts;
+	++generation;
+	wake.notify_all();
+
+	Work(lock);
+	while (unfinished > 0) done.wait(lock);
+
+	if (failure) {
+		std::exception_ptr error = failure;
+		failure = std::exception_ptr();
+		lock.unlock();
+		std::rethrow_exception(error);
+	}
+}
+
+void WorkerPool::Loop() {
+	unsigned int seen = 0;
+	boost::unique_lock<boost::mutex> lock(mutex);
+	while (true) {
+		while (generation == seen && !stopping) wake.wait(lock);
+		if (stopping) return;
+		seen = generation;
+		Work(lock);
+	}
+}
+
+//Takes parts until there are none left, the lock is only released while a part is being worked on
+void WorkerPool::Work(boost::unique_lock<boost::mutex>& lock) {
+	while (nextPart < parts) {
+		unsigned int part = nextPart++;
+		lock.unlock();
+		std::exception_ptr error;
+		try {
+			job(part);
+		} catch (...) {
+			error = std::current_exception();
+		}
+		lock.lock();
+		if (error && !failure) failure = error;
+		if (--unfinished == 0) done.notify_all();
+	}
+}
@@ -87,7 +87,11 @@ namespace Config {
 			("compressSaves","0")
 			("translucentUI","0")
 			("autosave","1")
+			("journalAutosaves","1")
 			("pauseOnDanger","0")
+			("pathingThreads","0")
+			("aiBudget",     "10000")
+			("updateThreads","0")
 		;
 		
 		insert(Globals::keys)
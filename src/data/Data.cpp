@@ -127,6 +127,39 @@ namespace {
 		}
 	}
 	
+	/**
+		Called once a background save has finished. Emits onGameSaved scripting event
+		if it succeeded.
+		
+		\param[in] file    Full path to the save.
+		\param[in] done    Function to pass the result on to.
+		\param[in] success Boolean indicating success or failure.
+	*/
+	void BackgroundSaveDone(std::string file, boost::function<void(bool)> done, bool success) {
+		if (success) {
+			Script::Event::GameSaved(file);
+		}
+		if (done) done(success);
+	}
+	
+	/**
+		Turns a save name into the full path of its file.
+		
+		\bug If sanitized filename is empty, will use @c _ instead. Should tell the user.
+		
+		\param[in] save Save filename.
+		\returns        Full path to the save.
+	*/
+	std::string SavePath(const std::string& save) {
+		std::string file = SanitizeFilename(save);
+		
+		if (file.size() == 0) {
+			file = "_";
+		}
+		
+		return (Paths::Get(Paths::Saves) / file).string() + ".sav";
+	}
+	
 	/**
 		Checks whether given file exists in the user's personal directory, and if not,
 		tries to copy it from the global data directory.
@@ -190,7 +223,8 @@ namespace {
 }
 
 namespace Data {
-	Save::Save(const std::string& filename, std::uintmax_t size, time_t timestamp) : filename(filename), timestamp(timestamp) {
+	Save::Save(const std::string& filename, std::uintmax_t size, time_t timestamp, const std::string& summary) :
+		filename(filename), summary(summary), timestamp(timestamp) {
 		FormatFileSize(size, this->size);
 		FormatTimestamp(timestamp, this->date);
 	}
@@ -210,7 +244,8 @@ namespace Data {
 			list.push_back(Save(
 				save.filename().string(),
 				fs::file_size(it->path()),
-				fs::last_write_time(it->path())
+				fs::last_write_time(it->path()),
+				Game::SaveSummary(it->path().string())
 			));
 		}
 	}
@@ -246,20 +281,13 @@ namespace Data {
 		Saves the game to given file. If it exists, prompts the user whether to override.
 		
 		\see DoSave
-		\bug If sanitized filename is empty, will use @c _ instead. Should tell the user.
 		
 		\param[in] save    Save filename.
 		\param[in] confirm Boolean indicating whether to confirm overwriting an existing save
 		\returns           Boolean indicating success or failure.
 	*/
 	bool SaveGame(const std::string& save, bool confirm) {
-		std::string file = SanitizeFilename(save);
-		
-		if (file.size() == 0) {
-			file = "_";
-		}
-		
-		file = (Paths::Get(Paths::Saves) / file).string() + ".sav";
+		std::string file = SavePath(save);
 		
 		bool result = false;
 		
@@ -274,6 +302,22 @@ namespace Data {
 		return result;
 	}
 	
+	/**
+		Saves the game to given file without stopping the game, overwriting any existing save.
+		
+		\see Game::SaveGameInBackground
+		
+		\param[in] save    Save filename.
+		\param[in] journal Whether to only append what changed to an existing save.
+		\param[in] done    Called with a boolean indicating success or failure once the save is written.
+	*/
+	void SaveGameInBackground(const std::string& save, bool journal, boost::function<void(bool)> done) {
+		std::string file = SavePath(save);
+		
+		LOG_FUNC("Saving game to " << file << " in the background", "SaveGameInBackground");
+		Game::SaveGameInBackground(file, journal, boost::bind(BackgroundSaveDone, file, done, _1));
+	}
+	
 	/**
 		Executes the user's configuration file.
 	*/
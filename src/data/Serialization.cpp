@@ -30,6 +30,15 @@ and I couldn't come up with a coherent answer just by googling. */
 
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/filesystem.hpp>
+
+#ifndef WINDOWS
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 namespace io = boost::iostreams;
 
@@ -43,6 +52,7 @@ namespace io = boost::iostreams;
 #include "Camp.hpp"
 #include "StockManager.hpp"
 #include "Map.hpp"
+#include "WorkerPool.hpp"
 
 // IMPORTANT
 // Implementing class versioning properly is an effort towards backward compatibility for saves,
@@ -73,7 +83,8 @@ namespace io = boost::iostreams;
 //        This value represents overall file format, as defined here.
 //        It should be incremented when file format changes so much that maintaining backward 
 //        compatibility is not possible or feasible. Parser MUST NOT attempt any further decoding
-//        if file format version is different than build's fileFormatConst.
+//        if file format version is different than build's fileFormatConst
+//        (or one of the older versions that are still loaded, see below).
 //        
 //        File format version of 0xFF is reserved for experimental file formats,
 //        and should never be used in production branches.
@@ -85,18 +96,49 @@ namespace io = boost::iostreams;
 //           0x01 = zlib deflate
 //        Other values are invalid and MUST be rejected.
 //    - 0x00 (uint8_t,  reserved, little endian)
+//    - 0x00 (uint16_t, reserved, little endian)
 //    - 0x00 (uint32_t, reserved, little endian)
-//    - 0x00 (uint64_t, reserved, little endian)
-//    - 0x00 (uint64_t, reserved, little endian)
-//    - 0x00 (uint64_t, reserved, little endian)
-//    - actual serialised payload, defined and processed by Boost.Serialization machinery
+//    - metadata offset (uint64_t, little endian)
+//    - table of contents offset (uint64_t, little endian)
+//    - payload size, uncompressed (uint64_t, little endian)
+//    - metadata, so that the save list doesn't have to read the payload:
+//        - size of the rest of the metadata (uint32_t), fields may be added at the end
+//        - age (uint32_t)
+//        - season (uint8_t)
+//        - orc count (uint32_t)
+//        - goblin count (uint32_t)
+//    - table of contents:
+//        - chunk count (uint32_t)
+//        - for each chunk:
+//            - section (uint8_t): game, jobs, camp, stock, map
+//            - offset in the file (uint64_t)
+//            - stored size (uint32_t)
+//            - uncompressed size (uint32_t)
+//            - FNV-1a hash of the uncompressed chunk (uint64_t)
+//    - chunks, each compressed on its own with the algorithm above
+//
+//  The chunks put together in order make up the serialised payload, defined and processed by
+//  Boost.Serialization machinery. It's a single archive, because object tracking spans all
+//  sections, so sections can be decompressed on their own but not deserialised.
+//
+//  The header, metadata and table of contents don't have to come first, and chunks may be shared
+//  between saves: a journaled save appends the chunks that changed, then new metadata and a new
+//  table of contents, and points the header at them last. Anything the table of contents doesn't
+//  refer to is left over from earlier saves, and is dropped by the next full rewrite.
+//
+//  File format 0x02 had no chunk hashes, and cut chunks at fixed 1MB offsets.
+//  File format 0x01 had the payload right after the header, compressed as a whole, and all
+//  of the fields after the compression flag were reserved and 0.
 
 // Magic constant: reversed fourcc 'GCMP'
 // (so you can see it actually spelled like this when hex-viewing the save).
 const std::uint32_t saveMagicConst = 0x47434d50;
 
 // File format version (8-bit, because it should not change too often).
-const std::uint8_t fileFormatConst = 0x01;
+const std::uint8_t fileFormatConst = 0x03;
+// Previous file format versions, which can still be loaded but aren't written anymore.
+const std::uint8_t chunkedFileFormatConst = 0x02;
+const std::uint8_t streamFileFormatConst = 0x01;
 
 //
 // Save/load entry points
@@ -147,14 +189,137 @@ namespace {
 		stream.put(static_cast<char>(value));
 	}
 	
-	void WritePayload(io::filtering_ostream& ofs) {
-		boost::archive::binary_oarchive oarch(ofs);
+	enum Section {
+		GameSection, //Entity::uids and Game
+		JobSection,
+		CampSection,
+		StockSection,
+		MapSection,
+		SectionCount
+	};
+	
+	// Sections are cut into chunks where their content says so rather than at fixed offsets, so a
+	// change only alters the chunks around it instead of shifting every chunk after it. That's
+	// what lets a journaled save find the chunks that are already in the file. Every chunk gets
+	// compressed on its own, so they can be worked on in parallel.
+	const std::size_t minChunkSizeConst = 16 << 10;
+	const std::size_t maxChunkSizeConst = 256 << 10;
+	// A chunk ends where the top 16 bits of the rolling hash are 0, about every 64 kB.
+	const std::uint64_t chunkMaskConst = 0xFFFF000000000000ULL;
+	// Chunk size limit in file format 0x02.
+	const std::size_t oldChunkSizeConst = 1 << 20;
+	
+	// Header, up to and including the payload size.
+	const std::uint64_t headerSizeConst = 4 + 1 + 1 + 1 + 2 + 4 + 8 + 8 + 8;
+	// Table of contents entry: section, offset, stored size, size, hash.
+	const std::uint64_t tocEntrySizeConst = 1 + 8 + 4 + 4 + 8;
+	// Metadata block, not counting its own size field.
+	const std::uint32_t metadataSizeConst = 4 + 1 + 4 + 4;
+	
+	typedef std::vector<char> Buffer;
+	
+	struct Chunk {
+		std::uint8_t section;
+		std::uint64_t offset; // in the file
+		std::size_t begin, size; // range in the uncompressed payload
+		std::uint64_t hash; // of the uncompressed data
+		std::uint32_t storedSize;
+		Buffer stored; // as it is in the file, empty if it's already there
+		bool inFile; // journaled saves refer to chunks that earlier saves already wrote
+		bool failed;
+		
+		Chunk() : section(0), offset(0), begin(0), size(0), hash(0), storedSize(0), inFile(false), failed(false) { }
+	};
+	
+	// Random values for the rolling hash that finds chunk boundaries.
+	struct GearTable {
+		std::uint64_t values[256];
+		
+		GearTable() {
+			// splitmix64, so the table is the same in every build
+			std::uint64_t state = 0;
+			for (int i = 0; i < 256; ++i) {
+				std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+				values[i] = z ^ (z >> 31);
+			}
+		}
+	};
+	const GearTable gear;
+	
+	// FNV-1a, used to recognise chunks that are already in the file and to check them on load.
+	std::uint64_t HashChunk(const char* data, std::size_t size) {
+		std::uint64_t hash = 0xCBF29CE484222325ULL;
+		for (std::size_t i = 0; i < size; ++i) {
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= 0x100000001B3ULL;
+		}
+		return hash;
+	}
+	
+	/**
+		Cuts the payload into chunks, never across a section boundary.
+		
+		\param[in]  payload     The serialised game.
+		\param[in]  sectionEnds Where each section ends in the payload.
+		\param[out] chunks      The chunks, hashed but not compressed yet.
+	*/
+	void CutChunks(const Buffer& payload, const std::vector<std::size_t>& sectionEnds, std::vector<Chunk>& chunks) {
+		std::size_t begin = 0;
+		for (std::size_t section = 0; section < sectionEnds.size(); ++section) {
+			const std::size_t end = sectionEnds[section];
+			while (begin < end) {
+				const std::size_t limit = std::min(end, begin + maxChunkSizeConst);
+				std::size_t cut = std::min(end, begin + minChunkSizeConst);
+				std::uint64_t rolling = 0;
+				while (cut < limit) {
+					rolling = (rolling << 1) + gear.values[static_cast<unsigned char>(payload[cut++])];
+					if ((rolling & chunkMaskConst) == 0) break;
+				}
+				
+				Chunk chunk;
+				chunk.section = static_cast<std::uint8_t>(section);
+				chunk.begin = begin;
+				chunk.size = cut - begin;
+				chunk.hash = HashChunk(&payload[begin], chunk.size);
+				chunks.push_back(chunk);
+				begin = cut;
+			}
+		}
+	}
+	
+	/**
+		Serialises the game into memory. The archive is one stream across all sections, because
+		Boost.Serialization tracks shared pointers across all of it.
+		
+		\param[out] payload     The serialised game.
+		\param[out] sectionEnds Where each section ends in the payload.
+	*/
+	void WritePayload(Buffer& payload, std::vector<std::size_t>& sectionEnds) {
+		io::filtering_ostream stream(io::back_inserter(payload));
+		boost::archive::binary_oarchive oarch(stream);
+		
 		oarch << Entity::uids;
 		oarch << *Game::Inst();
+		stream.flush();
+		sectionEnds.push_back(payload.size());
+		
 		oarch << *JobManager::Inst();
+		stream.flush();
+		sectionEnds.push_back(payload.size());
+		
 		oarch << *Camp::Inst();
+		stream.flush();
+		sectionEnds.push_back(payload.size());
+		
 		oarch << *StockManager::Inst();
+		stream.flush();
+		sectionEnds.push_back(payload.size());
+		
 		oarch << *Map::Inst();
+		stream.flush();
+		sectionEnds.push_back(payload.size());
 	}
 	
 	void ReadPayload(io::filtering_istream& ifs) {
@@ -166,18 +331,86 @@ namespace {
 		iarch >> *StockManager::Inst();
 		iarch >> *Map::Inst();
 	}
-}
-
-bool Game::SaveGame(const std::string& filename) {
-	try {
-		std::ofstream rawStream(filename.c_str(), std::ios::binary);
-		io::filtering_ostream stream;
+	
+	void ReadPayloadFromMemory(const Buffer& payload) {
+		io::filtering_istream stream;
+		stream.push(io::array_source(payload.empty() ? 0 : &payload[0], payload.size()));
+		ReadPayload(stream);
+	}
+	
+	// These run on the worker pool, so they must not throw.
+	void CompressChunk(std::vector<Chunk>& chunks, const Buffer& payload, bool compress, unsigned int i) {
+		Chunk& chunk = chunks[i];
+		if (chunk.inFile || !chunk.stored.empty()) return;
+		const char* data = &payload[chunk.begin];
+		
+		try {
+			if (!compress) {
+				chunk.stored.assign(data, data + chunk.size);
+			} else {
+				io::filtering_ostream stream;
+				stream.push(io::zlib_compressor(io::zlib_params(6)));
+				stream.push(io::back_inserter(chunk.stored));
+				stream.write(data, chunk.size);
+				stream.reset();
+			}
+			chunk.storedSize = static_cast<std::uint32_t>(chunk.stored.size());
+		} catch (const std::exception&) {
+			chunk.failed = true;
+		}
+	}
+	
+	void DecompressChunk(std::vector<Chunk>& chunks, Buffer& payload, bool compressed, bool hashed, unsigned int i) {
+		Chunk& chunk = chunks[i];
+		char* data = &payload[chunk.begin];
+		
+		try {
+			if (!compressed) {
+				if (chunk.stored.size() != chunk.size) {
+					chunk.failed = true;
+					return;
+				}
+				std::copy(chunk.stored.begin(), chunk.stored.end(), data);
+			} else {
+				if (chunk.stored.empty()) {
+					chunk.failed = true;
+					return;
+				}
+				
+				io::filtering_istream stream;
+				stream.push(io::zlib_decompressor());
+				stream.push(io::array_source(&chunk.stored[0], chunk.stored.size()));
+				stream.read(data, chunk.size);
+				if (static_cast<std::size_t>(stream.gcount()) != chunk.size) {
+					chunk.failed = true;
+					return;
+				}
+			}
+			
+			chunk.failed = hashed && HashChunk(data, chunk.size) != chunk.hash;
+		} catch (const std::exception&) {
+			chunk.failed = true;
+		}
+	}
+	
+	void RunOnChunks(const boost::function<void(unsigned int)>& job, std::vector<Chunk>& chunks, bool parallel) {
+		if (parallel) {
+			WorkerPool::Inst()->Run(job, chunks.size());
+		} else {
+			for (unsigned int i = 0; i < chunks.size(); ++i) job(i);
+		}
 		
-		// Write the file header
+		for (std::size_t i = 0; i < chunks.size(); ++i) {
+			if (chunks[i].failed) {
+				throw std::runtime_error((boost::format("Chunk %d is broken.") % i).str());
+			}
+		}
+	}
+	
+	void WriteHeader(std::ostream& rawStream, bool compress, std::uint64_t metadataOffset, std::uint64_t tocOffset, std::uint64_t payloadSize) {
 		WriteUInt<std::uint32_t>(rawStream, saveMagicConst);
 		WriteUInt<std::uint8_t> (rawStream, fileFormatConst);
 		
-		bool compress = Config::GetCVar<bool>("compressSaves");
 		// compression flag
 		WriteUInt<std::uint8_t>(rawStream, (compress ? 0x01 : 0x00));
 		
@@ -185,42 +418,118 @@ bool Game::SaveGame(const std::string& filename) {
 		WriteUInt<std::uint8_t> (rawStream, 0x00U);
 		WriteUInt<std::uint16_t>(rawStream, 0x00U);
 		WriteUInt<std::uint32_t>(rawStream, 0x00UL);
-		WriteUInt<std::uint64_t>(rawStream, 0x00ULL);
-		WriteUInt<std::uint64_t>(rawStream, 0x00ULL);
-		WriteUInt<std::uint64_t>(rawStream, 0x00ULL);
 		
-		// Write the payload
-		if (compress) {
-			io::zlib_params params(6); // level
-			stream.push(io::zlib_compressor(params));
+		WriteUInt<std::uint64_t>(rawStream, metadataOffset);
+		WriteUInt<std::uint64_t>(rawStream, tocOffset);
+		WriteUInt<std::uint64_t>(rawStream, payloadSize);
+	}
+	
+	void WriteMetadata(std::ostream& rawStream) {
+		WriteUInt<std::uint32_t>(rawStream, metadataSizeConst);
+		WriteUInt<std::uint32_t>(rawStream, Game::Inst()->GetAge());
+		WriteUInt<std::uint8_t> (rawStream, Game::Inst()->CurrentSeason());
+		WriteUInt<std::uint32_t>(rawStream, Game::Inst()->OrcCount());
+		WriteUInt<std::uint32_t>(rawStream, Game::Inst()->GoblinCount());
+	}
+	
+	void WriteToc(std::ostream& rawStream, const std::vector<Chunk>& chunks) {
+		WriteUInt<std::uint32_t>(rawStream, chunks.size());
+		for (std::size_t i = 0; i < chunks.size(); ++i) {
+			WriteUInt<std::uint8_t> (rawStream, chunks[i].section);
+			WriteUInt<std::uint64_t>(rawStream, chunks[i].offset);
+			WriteUInt<std::uint32_t>(rawStream, chunks[i].storedSize);
+			WriteUInt<std::uint32_t>(rawStream, chunks[i].size);
+			WriteUInt<std::uint64_t>(rawStream, chunks[i].hash);
+		}
+	}
+	
+	void WriteChunks(std::ostream& rawStream, const std::vector<Chunk>& chunks) {
+		for (std::size_t i = 0; i < chunks.size(); ++i) {
+			if (!chunks[i].inFile) {
+				rawStream.write(&chunks[i].stored[0], chunks[i].stored.size());
+			}
+		}
+	}
+	
+	/**
+		Writes a complete save. It goes to a temporary file first, which is only moved over the old
+		save once it's complete, so a save that fails halfway doesn't take the previous one with it.
+	*/
+	void WriteFullSave(const std::string& filename, std::vector<Chunk>& chunks, std::uint64_t payloadSize, bool compress) {
+		const std::uint64_t metadataOffset = headerSizeConst;
+		const std::uint64_t tocOffset = metadataOffset + 4 + metadataSizeConst;
+		std::uint64_t offset = tocOffset + 4 + tocEntrySizeConst * chunks.size();
+		for (std::size_t i = 0; i < chunks.size(); ++i) {
+			chunks[i].offset = offset;
+			offset += chunks[i].storedSize;
 		}
 		
-		stream.push(rawStream);
-		Game::SavingScreen(std::bind(&WritePayload, std::ref(stream)));
-		
-		return true;
-	} catch (const std::exception& e) {
-		LOG("std::exception while trying to save the game: " << e.what());
-		return false;
+		const std::string partial = filename + ".part";
+		{
+			std::ofstream rawStream(partial.c_str(), std::ios::binary);
+			WriteHeader(rawStream, compress, metadataOffset, tocOffset, payloadSize);
+			WriteMetadata(rawStream);
+			WriteToc(rawStream, chunks);
+			WriteChunks(rawStream, chunks);
+			
+			rawStream.close();
+			if (rawStream.fail()) {
+				throw std::runtime_error("Could not write " + partial);
+			}
+		}
+		boost::filesystem::rename(partial, filename);
 	}
-}
-
-bool Game::LoadGame(const std::string& filename) {
-	try {
-		std::ifstream rawStream(filename.c_str(), std::ios::binary);
-		io::filtering_istream stream;
+	
+	/**
+		Appends the chunks that aren't in the save yet, followed by new metadata and a new table of
+		contents. The header is pointed at them last, so until then the file still holds the
+		previous save intact.
+	*/
+	void AppendSave(const std::string& filename, std::vector<Chunk>& chunks, std::uint64_t payloadSize, bool compress) {
+		std::fstream rawStream(filename.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+		rawStream.seekp(0, std::ios::end);
+		std::uint64_t offset = static_cast<std::uint64_t>(rawStream.tellp());
 		
-		// Read and verify the file header
-		if (ReadUInt<std::uint32_t>(rawStream) != saveMagicConst) {
-			throw std::runtime_error("Invalid magic value.");
+		for (std::size_t i = 0; i < chunks.size(); ++i) {
+			if (!chunks[i].inFile) {
+				chunks[i].offset = offset;
+				offset += chunks[i].storedSize;
+			}
 		}
+		WriteChunks(rawStream, chunks);
 		
-		if (ReadUInt<std::uint8_t>(rawStream) != fileFormatConst) {
-			throw std::runtime_error("Invalid file format value.");
+		const std::uint64_t metadataOffset = offset;
+		WriteMetadata(rawStream);
+		const std::uint64_t tocOffset = metadataOffset + 4 + metadataSizeConst;
+		WriteToc(rawStream, chunks);
+		
+		rawStream.flush();
+		if (rawStream.fail()) {
+			throw std::runtime_error("Could not append to " + filename);
+		}
+		
+		rawStream.seekp(0);
+		WriteHeader(rawStream, compress, metadataOffset, tocOffset, payloadSize);
+		rawStream.close();
+		if (rawStream.fail()) {
+			throw std::runtime_error("Could not update the header of " + filename);
 		}
+	}
+	
+	/**
+		Reads the header fields that come after the file format version.
 		
+		\param[in]  rawStream      The save, positioned after the file format version.
+		\param[in]  fileFormat     The save's file format version.
+		\param[out] compressed     Compression algorithm.
+		\param[out] metadataOffset Where the metadata block is, 0 if the save has none.
+		\param[out] tocOffset      Where the table of contents is, 0 if the save has none.
+		\param[out] payloadSize    Size of the uncompressed payload, 0 if unknown.
+	*/
+	void ReadHeader(std::istream& rawStream, std::uint8_t fileFormat, std::uint8_t& compressed,
+		std::uint64_t& metadataOffset, std::uint64_t& tocOffset, std::uint64_t& payloadSize) {
 		// compression
-		std::uint8_t compressed = ReadUInt<std::uint8_t>(rawStream);
+		compressed = ReadUInt<std::uint8_t>(rawStream);
 		
 		if (compressed > 1) {
 			throw std::runtime_error("Invalid compression algorithm.");
@@ -236,25 +545,308 @@ bool Game::LoadGame(const std::string& filename) {
 		if (ReadUInt<std::uint32_t>(rawStream) != 0) {
 			throw std::runtime_error("Forward compatibility: reserved value #3 not 0x00000000.");
 		}
-		if (ReadUInt<std::uint64_t>(rawStream) != 0) {
-			throw std::runtime_error("Forward compatibility: reserved value #4 not 0x0000000000000000.");
+		
+		metadataOffset = ReadUInt<std::uint64_t>(rawStream);
+		tocOffset      = ReadUInt<std::uint64_t>(rawStream);
+		payloadSize    = ReadUInt<std::uint64_t>(rawStream);
+		
+		if (fileFormat == streamFileFormatConst) {
+			if (metadataOffset != 0) {
+				throw std::runtime_error("Forward compatibility: reserved value #4 not 0x0000000000000000.");
+			}
+			if (tocOffset != 0) {
+				throw std::runtime_error("Forward compatibility: reserved value #5 not 0x0000000000000000.");
+			}
+			if (payloadSize != 0) {
+				throw std::runtime_error("Forward compatibility: reserved value #6 not 0x0000000000000000.");
+			}
+		}
+		
+		if (!rawStream) {
+			throw std::runtime_error("Truncated header.");
+		}
+	}
+	
+	/**
+		Reads the table of contents.
+		
+		\param[in]  rawStream   The save.
+		\param[in]  fileFormat  The save's file format version, which decides whether chunks are hashed.
+		\param[in]  tocOffset   Where the table of contents is.
+		\param[in]  payloadSize Size of the uncompressed payload.
+		\param[out] chunks      The chunks, with nothing read into them yet.
+	*/
+	void ReadToc(std::istream& rawStream, std::uint8_t fileFormat, std::uint64_t tocOffset, std::uint64_t payloadSize, std::vector<Chunk>& chunks) {
+		rawStream.seekg(tocOffset);
+		std::uint32_t count = ReadUInt<std::uint32_t>(rawStream);
+		if (!rawStream) {
+			throw std::runtime_error("Truncated table of contents.");
+		}
+		
+		const std::size_t maxSize = (fileFormat == chunkedFileFormatConst ? oldChunkSizeConst : maxChunkSizeConst);
+		chunks.resize(count);
+		std::uint64_t begin = 0;
+		for (std::uint32_t i = 0; i < count; ++i) {
+			chunks[i].section    = ReadUInt<std::uint8_t>(rawStream);
+			chunks[i].offset     = ReadUInt<std::uint64_t>(rawStream);
+			chunks[i].storedSize = ReadUInt<std::uint32_t>(rawStream);
+			chunks[i].size       = ReadUInt<std::uint32_t>(rawStream);
+			if (fileFormat != chunkedFileFormatConst) {
+				chunks[i].hash   = ReadUInt<std::uint64_t>(rawStream);
+			}
+			chunks[i].begin      = begin;
+			begin += chunks[i].size;
+			
+			if (chunks[i].section >= SectionCount || chunks[i].size > maxSize) {
+				throw std::runtime_error("Invalid table of contents.");
+			}
+		}
+		if (!rawStream) {
+			throw std::runtime_error("Truncated table of contents.");
+		}
+		if (begin != payloadSize) {
+			throw std::runtime_error("Table of contents doesn't add up to the payload size.");
+		}
+	}
+	
+	/**
+		Reads the chunks listed in the table of contents and decompresses them on the worker pool.
+		
+		\param[in]  rawStream   The save.
+		\param[in]  fileFormat  The save's file format version.
+		\param[in]  compressed  Compression algorithm.
+		\param[in]  tocOffset   Where the table of contents is.
+		\param[in]  payloadSize Size of the uncompressed payload.
+		\param[out] payload     The uncompressed payload.
+	*/
+	void ReadChunks(std::istream& rawStream, std::uint8_t fileFormat, bool compressed, std::uint64_t tocOffset, std::uint64_t payloadSize, Buffer& payload) {
+		std::vector<Chunk> chunks;
+		ReadToc(rawStream, fileFormat, tocOffset, payloadSize, chunks);
+		
+		for (std::size_t i = 0; i < chunks.size(); ++i) {
+			chunks[i].stored.resize(chunks[i].storedSize);
+			if (chunks[i].stored.empty()) continue;
+			rawStream.seekg(chunks[i].offset);
+			rawStream.read(&chunks[i].stored[0], chunks[i].stored.size());
+		}
+		if (!rawStream) {
+			throw std::runtime_error("Truncated chunk.");
+		}
+		
+		payload.resize(payloadSize);
+		bool hashed = fileFormat != chunkedFileFormatConst;
+		RunOnChunks(boost::bind(&DecompressChunk, boost::ref(chunks), boost::ref(payload), compressed, hashed, _1), chunks, true);
+	}
+	
+	/**
+		Finds the chunks that an existing save already holds, so that a journaled save can refer to
+		them instead of writing them again.
+		
+		\param[in]  filename The save.
+		\param[in]  compress Whether the new save is compressed, the old one has to match.
+		\param[in]  chunks   The new save's chunks. Those that are in the file get marked as such.
+		\param[out] fileSize Size of the existing file.
+		\returns             False if there's no usable save to append to.
+	*/
+	bool FindChunksInFile(const std::string& filename, bool compress, std::vector<Chunk>& chunks, std::uint64_t& fileSize) {
+		try {
+			std::ifstream rawStream(filename.c_str(), std::ios::binary);
+			if (ReadUInt<std::uint32_t>(rawStream) != saveMagicConst) return false;
+			std::uint8_t fileFormat = ReadUInt<std::uint8_t>(rawStream);
+			if (fileFormat != fileFormatConst) return false;
+			
+			std::uint8_t compressed;
+			std::uint64_t metadataOffset, tocOffset, payloadSize;
+			ReadHeader(rawStream, fileFormat, compressed, metadataOffset, tocOffset, payloadSize);
+			if ((compressed != 0) != compress) return false;
+			
+			std::vector<Chunk> existing;
+			ReadToc(rawStream, fileFormat, tocOffset, payloadSize, existing);
+			rawStream.seekg(0, std::ios::end);
+			fileSize = static_cast<std::uint64_t>(rawStream.tellg());
+			
+			std::map<std::pair<std::uint64_t, std::size_t>, const Chunk*> known;
+			for (std::size_t i = 0; i < existing.size(); ++i) {
+				known[std::make_pair(existing[i].hash, existing[i].size)] = &existing[i];
+			}
+			for (std::size_t i = 0; i < chunks.size(); ++i) {
+				std::map<std::pair<std::uint64_t, std::size_t>, const Chunk*>::const_iterator found =
+					known.find(std::make_pair(chunks[i].hash, chunks[i].size));
+				if (found != known.end()) {
+					chunks[i].inFile = true;
+					chunks[i].offset = found->second->offset;
+					chunks[i].storedSize = found->second->storedSize;
+				}
+			}
+			return true;
+		} catch (const std::exception&) {
+			return false;
+		}
+	}
+	
+	/**
+		Writes the save.
+		
+		\param[in] filename   Full path to the save.
+		\param[in] foreground Whether to show the saving screen and compress on the worker pool,
+		                      which a background save can't use.
+		\param[in] journal    Whether to append only what changed to the existing save, if possible.
+	*/
+	void WriteSave(const std::string& filename, bool foreground, bool journal) {
+		Buffer payload;
+		std::vector<std::size_t> sectionEnds;
+		if (foreground) {
+			Game::SavingScreen(boost::bind(&WritePayload, boost::ref(payload), boost::ref(sectionEnds)));
+		} else {
+			WritePayload(payload, sectionEnds);
+		}
+		
+		std::vector<Chunk> chunks;
+		CutChunks(payload, sectionEnds, chunks);
+		
+		bool compress = Config::GetCVar<bool>("compressSaves");
+		std::uint64_t fileSize = 0;
+		bool append = journal && FindChunksInFile(filename, compress, chunks, fileSize);
+		RunOnChunks(boost::bind(&CompressChunk, boost::ref(chunks), boost::cref(payload), compress, _1), chunks, foreground);
+		
+		if (append) {
+			// Start over with a full save once more than half of the file would be left unused
+			std::uint64_t used = headerSizeConst + 4 + metadataSizeConst + 4 + tocEntrySizeConst * chunks.size();
+			std::uint64_t added = used - headerSizeConst;
+			for (std::size_t i = 0; i < chunks.size(); ++i) {
+				used += chunks[i].storedSize;
+				if (!chunks[i].inFile) added += chunks[i].storedSize;
+			}
+			append = fileSize + added <= 2 * used;
+		}
+		
+		if (append) {
+			AppendSave(filename, chunks, payload.size(), compress);
+		} else {
+			for (std::size_t i = 0; i < chunks.size(); ++i) {
+				chunks[i].inFile = false;
+			}
+			RunOnChunks(boost::bind(&CompressChunk, boost::ref(chunks), boost::cref(payload), compress, _1), chunks, foreground);
+			WriteFullSave(filename, chunks, payload.size(), compress);
+		}
+	}
+	
+#ifndef WINDOWS
+	pid_t backgroundSave = 0;
+	std::string backgroundSaveFile;
+	boost::function<void(bool)> backgroundSaveDone;
+	
+	//Returns false if the save is still running
+	bool ReapBackgroundSave(bool wait) {
+		int status = 0;
+		pid_t result = waitpid(backgroundSave, &status, wait ? 0 : WNOHANG);
+		if (result == 0) return false;
+		
+		backgroundSave = 0;
+		bool success = result > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		if (!success) {
+			LOG("Background save to " << backgroundSaveFile << " failed");
+		}
+		
+		boost::function<void(bool)> done;
+		done.swap(backgroundSaveDone);
+		if (done) done(success);
+		return true;
+	}
+	
+	void PollBackgroundSave() {
+		if (backgroundSave && !ReapBackgroundSave(false)) {
+			Game::Inst()->Timers()->Schedule(UPDATES_PER_SECOND / 4, &PollBackgroundSave);
 		}
-		if (ReadUInt<std::uint64_t>(rawStream) != 0) {
-			throw std::runtime_error("Forward compatibility: reserved value #5 not 0x0000000000000000.");
+	}
+#endif
+}
+
+bool Game::SaveGame(const std::string& filename) {
+	try {
+		WriteSave(filename, true, false);
+		return true;
+	} catch (const std::exception& e) {
+		LOG("std::exception while trying to save the game: " << e.what());
+		return false;
+	}
+}
+
+/* The save is written by a fork()ed child, which gets a copy-on-write snapshot of the whole world
+as it was at that tick. The game keeps running in the parent, and done() is called on the game
+thread once the child exits. Platforms without fork() save in the foreground instead.
+A journaled save only appends what changed since the last save to the same file */
+void Game::SaveGameInBackground(const std::string& filename, bool journal, boost::function<void(bool)> done) {
+#ifdef WINDOWS
+	bool success = SaveGame(filename);
+	if (done) done(success);
+#else
+	if (backgroundSave) ReapBackgroundSave(true); //One at a time
+	
+	Logger::log.flush(); //Otherwise the child would write out whatever is buffered a second time
+	pid_t pid = fork();
+	if (pid == 0) {
+		int status = 0;
+		try {
+			WriteSave(filename, false, journal);
+		} catch (const std::exception& e) {
+			LOG("std::exception while trying to save the game in the background: " << e.what());
+			Logger::log.flush();
+			status = 1;
 		}
-		if (ReadUInt<std::uint64_t>(rawStream) != 0) {
-			throw std::runtime_error("Forward compatibility: reserved value #6 not 0x0000000000000000.");
+		_exit(status); //Skip atexit handlers and destructors, they belong to the parent
+	} else if (pid < 0) {
+		LOG("fork() failed, saving in the foreground");
+		bool success = SaveGame(filename);
+		if (done) done(success);
+		return;
+	}
+	
+	backgroundSave = pid;
+	backgroundSaveFile = filename;
+	backgroundSaveDone = done;
+	Game::Inst()->Timers()->Schedule(UPDATES_PER_SECOND / 4, &PollBackgroundSave);
+#endif
+}
+
+bool Game::LoadGame(const std::string& filename) {
+	try {
+		std::ifstream rawStream(filename.c_str(), std::ios::binary);
+		io::filtering_istream stream;
+		
+		// Read and verify the file header
+		if (ReadUInt<std::uint32_t>(rawStream) != saveMagicConst) {
+			throw std::runtime_error("Invalid magic value.");
+		}
+		
+		std::uint8_t fileFormat = ReadUInt<std::uint8_t>(rawStream);
+		if (fileFormat != fileFormatConst && fileFormat != chunkedFileFormatConst && fileFormat != streamFileFormatConst) {
+			throw std::runtime_error("Invalid file format value.");
+		}
+		
+		std::uint8_t compressed;
+		std::uint64_t metadataOffset, tocOffset, payloadSize;
+		ReadHeader(rawStream, fileFormat, compressed, metadataOffset, tocOffset, payloadSize);
+		
+		// Broken chunks are found before the current game is thrown away
+		Buffer payload;
+		if (fileFormat != streamFileFormatConst) {
+			ReadChunks(rawStream, fileFormat, compressed != 0, tocOffset, payloadSize, payload);
 		}
 		
 		Game::Inst()->Reset();
 		
 		// Read the payload
-		if (compressed) {
-			stream.push(io::zlib_decompressor());
+		if (fileFormat != streamFileFormatConst) {
+			Game::LoadingScreen(boost::bind(&ReadPayloadFromMemory, boost::cref(payload)));
+		} else {
+			if (compressed) {
+				stream.push(io::zlib_decompressor());
+			}
+			
+			stream.push(rawStream);
+			Game::LoadingScreen(boost::bind(&ReadPayload, boost::ref(stream)));
 		}
-		
-		stream.push(rawStream);
-		Game::LoadingScreen(boost::bind(&ReadPayload, boost::ref(stream)));
 		Game::Inst()->TranslateContainerListeners();
 		Game::Inst()->ProvideMap();
 		Game::Inst()->Pause();
@@ -266,4 +858,32 @@ bool Game::LoadGame(const std::string& filename) {
 	}
 }
 
+std::string Game::SaveSummary(const std::string& filename) {
+	try {
+		std::ifstream rawStream(filename.c_str(), std::ios::binary);
+		
+		if (ReadUInt<std::uint32_t>(rawStream) != saveMagicConst) return "";
+		// Older saves have no metadata
+		std::uint8_t fileFormat = ReadUInt<std::uint8_t>(rawStream);
+		if (fileFormat != fileFormatConst && fileFormat != chunkedFileFormatConst) return "";
+		
+		std::uint8_t compressed;
+		std::uint64_t metadataOffset, tocOffset, payloadSize;
+		ReadHeader(rawStream, fileFormat, compressed, metadataOffset, tocOffset, payloadSize);
+		
+		rawStream.seekg(metadataOffset);
+		if (ReadUInt<std::uint32_t>(rawStream) < metadataSizeConst) return "";
+		std::uint32_t age     = ReadUInt<std::uint32_t>(rawStream);
+		std::uint8_t season   = ReadUInt<std::uint8_t>(rawStream);
+		std::uint32_t orcs    = ReadUInt<std::uint32_t>(rawStream);
+		std::uint32_t goblins = ReadUInt<std::uint32_t>(rawStream);
+		if (!rawStream || season > LateWinter) return "";
+		
+		return (boost::format("Year %d, %s, %d orcs, %d goblins") % age
+			% Game::Inst()->SeasonToString(static_cast<Season>(season)) % orcs % goblins).str();
+	} catch (const std::exception&) {
+		return "";
+	}
+}
+
 #pragma warning(pop)
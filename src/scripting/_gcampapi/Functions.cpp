@@ -29,6 +29,8 @@ namespace py = boost::python;
 #include "Construction.hpp"
 #include "NatureObject.hpp"
 #include "Logger.hpp"
+#include "Map.hpp"
+#include "PathCache.hpp"
 
 namespace Script { namespace API {
 	void Announce(const std::string& str) {
@@ -64,6 +66,30 @@ namespace Script { namespace API {
 		Game::Inst()->AddDelay(delay, function);
 	}
 	
+	bool CallRandomEvent(py::object function) {
+		//Only an explicit False stops it, so a callback without a return value keeps coming back
+		return function().ptr() != Py_False;
+	}
+	
+	void ScheduleRandom(int chance, PyObject* callback) {
+		if (!PyCallable_Check(callback)) {
+			LOG("WARNING: Attempted to schedule an uncallable object");
+			return;
+		}
+		py::object function(py::handle<>(py::borrowed(callback)));
+		Game::Inst()->AddRandomEvent(chance, boost::bind(&CallRandomEvent, function));
+	}
+	
+	py::dict GetPathCacheStats() {
+		PathCache::Stats stats = Map::Inst()->pathCache->GetStats();
+		py::dict result;
+		result["hits"]    = stats.hits;
+		result["misses"]  = stats.misses;
+		result["stale"]   = stats.stale;
+		result["entries"] = stats.entries;
+		return result;
+	}
+	
 	enum EntityType {
 		EConstr, EItem, ENPC, EPlant
 	};
@@ -120,7 +146,9 @@ namespace Script { namespace API {
 		py::def("isDevMode",        &IsDevMode);
 		py::def("messageBox",       &MessageBox);
 		py::def("delay",            &Delay);
+		py::def("scheduleRandom",   &ScheduleRandom);
 		py::def("spawnEntity",      &SpawnEntity);
+		py::def("getPathCacheStats", &GetPathCacheStats);
 		
 		py::enum_<EntityType>("EntityType").
 			value("ENTITY_BUILDING", EConstr).
@@ -74,7 +74,7 @@ namespace {
 			return true;
 		int natNum = -1;
 		if ((natNum = map->GetNatureObject(coord)) >= 0) {
-			return Game::Inst()->natureList[natNum]->IsIce();
+			return Game::Inst()->natureList.Get(natNum)->IsIce();
 		}
 		return false;
 	}
@@ -102,7 +102,7 @@ namespace {
 			return (water->Depth() > 0) ? 1 : 0;
 		}
 		else if ((natNum = map->GetNatureObject(coord)) >= 0) {
-			return (Game::Inst()->natureList[natNum]->IsIce()) ? 2 : 0;
+			return (Game::Inst()->natureList.Get(natNum)->IsIce()) ? 2 : 0;
 		}
 		return 0;
 	}
@@ -242,7 +242,7 @@ void TilesetRenderer::DrawMap(Map* mapToDraw, float focusX, float focusY, int vi
 
 					int natNum = map->GetNatureObject(pos);
 					if (natNum >= 0) {
-						boost::shared_ptr<NatureObject> natureObj = Game::Inst()->natureList[natNum];
+						boost::shared_ptr<NatureObject> natureObj = Game::Inst()->natureList.Get(natNum);
 						if (natureObj->Marked()) {
 							tileSet->DrawMarkedOverlay(x, y);
 						}
@@ -327,7 +327,7 @@ void TilesetRenderer::DrawCursor(const Coordinate& start, const Coordinate& end,
 
 //TODO factorize all those DrawFoo
 void TilesetRenderer::DrawItems() const {
-	for (std::map<int,boost::shared_ptr<Item> >::iterator itemi = Game::Inst()->itemList.begin(); itemi != Game::Inst()->itemList.end(); ++itemi) {
+	for (EntityMap<Item>::iterator itemi = Game::Inst()->itemList.begin(); itemi != Game::Inst()->itemList.end(); ++itemi) {
       if (itemi->second == 0) { // should not be here. but it happens. null pointer
           itemi = Game::Inst()->itemList.erase(itemi); // delete this shit
           if ( itemi == Game::Inst()->itemList.end() )break;
@@ -344,7 +344,7 @@ void TilesetRenderer::DrawItems() const {
 }
 
 void TilesetRenderer::DrawNPCs() const {
-	for (std::map<int,boost::shared_ptr<NPC> >::iterator npci = Game::Inst()->npcList.begin(); npci != Game::Inst()->npcList.end(); ++npci) {
+	for (EntityMap<NPC>::iterator npci = Game::Inst()->npcList.begin(); npci != Game::Inst()->npcList.end(); ++npci) {
 		Coordinate npcPos = npci->second->Position();
 		Coordinate start(startTileX,startTileY), extent(tilesX,tilesY);
 		if (npcPos.insideExtent(start, extent))
@@ -419,7 +419,7 @@ void TilesetRenderer::DrawTerrain(int screenX, int screenY, Coordinate pos) cons
 		}
 		int natNum = -1;
 		if ((natNum = map->GetNatureObject(pos)) >= 0) {
-			if (Game::Inst()->natureList[natNum]->IsIce()) {
+			if (Game::Inst()->natureList.Get(natNum)->IsIce()) {
 				tileSet->DrawIce(screenX, screenY, boost::bind(&WaterConnectionTest, map, pos, _1));
 			}
 		}